@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ingest.h"
+#include "sample.h"
+#include "textproc.h"
+
+/* ========================================================
+ *  PER-CHANNEL INTERVAL STATISTICS
+ *  Streaming min / max / mean / standard deviation for every
+ *  depth of every ingest record type, in fixed memory.
+ *  Values are fixed-point hundredths (centi-°C, centi-%);
+ *  the variance uses sums of deviations from the first value
+ *  so 64-bit sums never overflow over a day of samples.
+ * ======================================================== */
+
+#define AGG_DEPTHS_MAX  SAMPLE_DEPTHS_MAX
+
+enum AggStat : uint8_t {
+    AGG_MEAN = 0,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_SD,
+    AGG_STAT_COUNT,
+};
+
+extern const char* const AGG_STAT_NAME[AGG_STAT_COUNT];    // "avg", "min", …
+
+class Aggregator {
+public:
+    Aggregator() { reset(); }
+
+    /* Fold one type's per-depth values (hundredths) into its channels */
+    bool add(uint8_t type, const int32_t* v, uint8_t n);
+    void sampleDone() { if (samples < 0xFFFF) samples++; }
+
+    uint16_t count() const { return samples; }
+    uint8_t  depths(uint8_t type) const { return type < INGEST_TYPES_MAX ? nDepths[type] : 0; }
+
+    /* Comma list of one statistic over the type's depths */
+    bool format(uint8_t type, AggStat stat, TextBuf& out) const;
+    void reset();
+
+private:
+    struct Channel {
+        int32_t  min, max;
+        int32_t  base;          // first value: sums are of x - base
+        int64_t  sum, sumSq;
+        uint16_t n;
+    };
+
+    int32_t stat(const Channel& c, AggStat s) const;
+
+    Channel  ch[INGEST_TYPES_MAX][AGG_DEPTHS_MAX];
+    uint8_t  nDepths[INGEST_TYPES_MAX];
+    uint16_t samples;
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "textproc.h"
+
+/* ========================================================
+ *  RUNTIME CONFIGURATION
+ *  Tunables that used to be compile-time constants. A blob
+ *  pulled from the TalkBack command queue after an upload
+ *  looks like
+ *      v1;si=900;cy=4;ub=120;bs=50;pp=1;ag=3600;tr=1;rl=15;apn=fast.t-mobile.com
+ *  Keys left out keep their current value. The whole blob is
+ *  rejected if any key is unknown or any value out of range.
+ *  The accepted config is kept CRC-framed in CONFIG.TXT.
+ * ======================================================== */
+
+#define CONFIG_APN_MAX  32
+#define CONFIG_BLOB_MAX 160
+
+enum Transport : uint8_t {
+    TR_AT_HTTP = 0,     // AT+HTTPACTION, one request per row
+    TR_TCP,             // own socket, HTTP/1.1 keep-alive + pipelining
+    TR_MQTT,            // CMQTT publish (needs MQTT_* in secrets.h); at MQTT_QOS 0,
+                        // the ThingSpeak default, delivery is at most once
+    TR_TLS,             // HTTPS on the CCH SSL socket, session held open
+};
+
+enum PowerPolicy : uint8_t {
+    PWR_MODEM_ON = 0,   // modem stays registered between cycles
+    PWR_MODEM_OFF,      // modem powered down after each upload phase
+};
+
+struct GatewayConfig {
+    uint32_t sampleIntervalS;   // si: idle wait between wake-ups
+    uint8_t  cycleWaits;        // cy: idle waits per sample + upload cycle
+    uint16_t uploadBudgetS;     // ub: airtime for draining the backlog
+    uint16_t batchRows;         // bs: backlog rows per cycle, 0 = budget only
+    uint8_t  powerPolicy;       // pp: PowerPolicy
+    uint32_t aggIntervalS;      // ag: summary interval, 0 = raw rows
+    uint8_t  transport;         // tr: Transport
+    uint16_t ratePeriodS;       // rl: min seconds between ThingSpeak requests, 0 = unpaced
+    char     apn[CONFIG_APN_MAX];
+};
+
+extern GatewayConfig config;
+
+void configDefaults(GatewayConfig& c);
+bool configParse(const char* blob, GatewayConfig& c);   // c untouched on error
+bool configFormat(const GatewayConfig& c, TextBuf& out);
+bool configLoad();                                      // CONFIG.TXT → config
+bool configSave();
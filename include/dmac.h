@@ -0,0 +1,30 @@
+#pragma once
+#include <stdint.h>
+#include "dmaring.h"
+
+/* ========================================================
+ *  DMAC CHANNELS
+ *  One descriptor table for the whole firmware; each user
+ *  owns a fixed channel. A channel runs one descriptor, or
+ *  with loop the same one over and over (circular RX). The
+ *  block-end interrupt, if asked for, calls back into the
+ *  owner from DMAC_Handler. SAMD21 only.
+ * ======================================================== */
+
+enum DmaChannel : uint8_t {
+    DMA_CH_MODEM_RX = 0,
+    DMA_CH_MODEM_TX,
+    DMA_CH_SD_RX,
+    DMA_CH_SD_TX,
+    DMA_CH_COUNT
+};
+
+typedef void (*DmaDoneFn)();
+
+void     dmacBegin();                           // clocks, table, controller on; once
+/* (Re)start ch on desc, moved one beat per trigger (a SERCOMn_DMAC_ID_*) */
+void     dmacStart(uint8_t ch, const DmaDesc& desc, uint8_t trigger, bool loop,
+                   DmaDoneFn done = nullptr);
+void     dmacStop(uint8_t ch);
+bool     dmacBusy(uint8_t ch);                  // false once a one-shot block is done
+uint16_t dmacRemaining(uint8_t ch);             // beats left in the current block
@@ -0,0 +1,66 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================
+ *  DMA DESCRIPTORS AND THE CIRCULAR RX RING
+ *  The part of the DMA UART that is plain arithmetic: the
+ *  SAMD21 DMAC transfer descriptor, built for a peripheral
+ *  register on one side and RAM on the other, and the
+ *  reader of a receive buffer the DMAC writes round and
+ *  round. No Arduino headers, so it compiles on the host
+ *  and the wrap / overrun cases can be driven from there.
+ * ======================================================== */
+
+/* DMAC BTCTRL bits (SAMD21 datasheet, 20.10.1) */
+#define DMA_BT_VALID     0x0001
+#define DMA_BT_BLOCKINT  0x0008     // BLOCKACT = INT: channel interrupt at block end
+#define DMA_BT_BEAT8     0x0000     // BEATSIZE = byte
+#define DMA_BT_SRCINC    0x0400
+#define DMA_BT_DSTINC    0x0800
+
+/* Same layout as the DMAC's DmacDescriptor; 16 bytes, 16-aligned in the table */
+struct DmaDesc {
+    uint16_t btctrl;
+    uint16_t btcnt;
+    uint32_t srcaddr;       // with SRCINC: one past the last byte
+    uint32_t dstaddr;       // with DSTINC: one past the last byte
+    uint32_t descaddr;      // next descriptor, 0 = stop after this block
+};
+
+/* RAM → peripheral register (TX): n bytes, source increments */
+DmaDesc dmaDescToPeriph(const void* src, uint16_t n, uint32_t periphReg);
+/* Peripheral register → RAM (RX): n bytes, destination increments */
+DmaDesc dmaDescFromPeriph(uint32_t periphReg, void* dst, uint16_t n);
+/* The same byte n times into the register (SPI clocking a read) */
+DmaDesc dmaDescFill(const uint8_t* byte, uint16_t n, uint32_t periphReg);
+/* n bytes out of the register, dropped into one byte (SPI RX during a send) */
+DmaDesc dmaDescDrain(uint32_t periphReg, uint8_t* sink, uint16_t n);
+
+/* --- Reader side of a circular RX buffer ---
+ * All the CPU learns from the DMAC is how many beats are left in
+ * the current block (BTCNT) and, from the block interrupt, how many
+ * times the block has completed. sync() turns that into a byte
+ * count; if the DMAC has lapped the reader the oldest bytes are
+ * gone, counted as overruns, and reading resumes at the oldest byte
+ * still in the buffer. size must be a power of two so the running
+ * counts stay aligned with the buffer when they wrap. */
+class DmaRxRing {
+public:
+    DmaRxRing(uint8_t* buf, uint16_t size);
+
+    void     reset();                           // DMAC restarted at the buffer start
+    void     sync(uint32_t laps, uint16_t left);
+    uint16_t available() const { return (uint16_t)(written - taken); }
+    int      peek() const;
+    int      read();
+    size_t   read(uint8_t* out, size_t n);
+    uint32_t overruns() const { return lost; }  // bytes overwritten before they were read
+
+private:
+    uint8_t* buf;
+    uint16_t size;
+    uint32_t written;       // bytes the DMAC has stored, since reset()
+    uint32_t taken;         // bytes read
+    uint32_t lost;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+/* ========================================================
+ *  DMA SPI FOR THE SD CARD
+ *  SdFat's user SPI driver (SPI_DRIVER_SELECT 3) on the
+ *  board SPI (SERCOM4). Single bytes go through SPI.transfer;
+ *  sector runs are moved by two DMAC channels at once, RX
+ *  into the buffer while TX clocks out 0xFF (read) or the
+ *  data (write), so the CPU waits on one flag per block
+ *  instead of a register per byte. SAMD21 only.
+ * ======================================================== */
+
+#if defined(ARDUINO_ARCH_SAMD) && SPI_DRIVER_SELECT == 3
+#include <SdFat.h>
+
+#define DMASPI_MIN_BYTES 16         // shorter runs are cheaper byte by byte
+
+class DmaSpi : public SdSpiBaseClass {
+public:
+    void    begin(SdSpiConfig config) override;
+    void    activate() override;
+    void    deactivate() override;
+    void    end() override;
+    uint8_t receive() override;
+    uint8_t receive(uint8_t* buf, size_t n) override;   // 0: ok
+    void    send(uint8_t b) override;
+    void    send(const uint8_t* buf, size_t n) override;
+    void    setSckSpeed(uint32_t maxSck) override;
+
+private:
+    void    run(const uint8_t* tx, uint8_t* rx, uint16_t n);
+
+    uint32_t sck = 0;
+};
+#endif
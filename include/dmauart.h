@@ -0,0 +1,72 @@
+#pragma once
+#include <Arduino.h>
+
+/* ========================================================
+ *  DMA UART FOR THE MODEM
+ *  The core's Uart takes an interrupt per byte into a 64 B
+ *  ring; at 921600 baud an AT+HTTPREAD or CIPSEND burst is
+ *  thousands of interrupts and overruns while the CPU is on
+ *  SD. Here the DMAC moves the bytes:
+ *   - RX: one descriptor looping over DMAUART_RX_BYTES; the
+ *         only interrupt is once per lap of the buffer
+ *   - TX: a block per write(), from two alternating buffers
+ *         so the next one fills while the last is on the wire
+ *  The SERCOM is set up through the core's SERCOM object
+ *  with its interrupts left off. One instance, on the
+ *  DMA_CH_MODEM_* channels. SAMD21 only.
+ * ======================================================== */
+
+#ifdef ARDUINO_ARCH_SAMD
+#include "dmaring.h"
+
+#ifndef DMAUART_RX_BYTES
+#define DMAUART_RX_BYTES 2048       // ~22 ms of a continuous burst at 921600
+#endif
+#define DMAUART_TX_BYTES 256
+
+class DmaUart : public HardwareSerial {
+public:
+    DmaUart(SERCOM* sercom, Sercom* regs, uint8_t rxTrigger, uint8_t txTrigger,
+            uint8_t rxPin, uint8_t txPin, SercomRXPad rxPad, SercomUartTXPad txPad);
+
+    void   begin(unsigned long baud) override;
+    void   begin(unsigned long baud, uint16_t config) override;
+    void   end() override;
+    int    available() override;
+    int    peek() override;
+    int    read() override;
+    size_t read(uint8_t* out, size_t n);
+    void   flush() override;                    // wait until the last byte is on the wire
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* p, size_t n) override;
+    using Print::write;
+    operator bool() override { return true; }
+
+    uint32_t overruns() const { return rx.overruns(); }
+
+private:
+    static void rxLap();
+    static void txDone();
+    void txKick();                              // interrupts off
+    void rxSync();
+
+    SERCOM*         sercom;
+    Sercom*         regs;
+    uint8_t         rxTrigger, txTrigger;
+    uint8_t         rxPin, txPin;
+    SercomRXPad     rxPad;
+    SercomUartTXPad txPad;
+
+    uint8_t         rxBuf[DMAUART_RX_BYTES];
+    DmaRxRing       rx;
+    volatile uint32_t laps;
+
+    uint8_t           txBuf[2][DMAUART_TX_BYTES];
+    volatile uint16_t txLen[2];
+    volatile uint8_t  txFill;                   // buffer being filled; the other may be on the air
+    volatile bool     txBusy;
+    bool              txSent;                   // something went out since the last flush()
+
+    static DmaUart* self;                       // for the DMAC callbacks
+};
+#endif
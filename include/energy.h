@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+
+/* ========================================================
+ *  ENERGY ACCOUNTING
+ *  Time spent in each subsystem is charged to the innermost
+ *  active state, then weighted by that state's current draw
+ *  to estimate the charge used per cycle.
+ * ======================================================== */
+
+enum EnergyState : uint8_t {
+    EN_AWAKE = 0,   // MCU running, nothing else attributed
+    EN_LTE,         // ltePowerSequence()
+    EN_UPLOAD,      // uploadData()
+    EN_SAMPLE,      // sampleData()
+    EN_GPS,         // getGPSData()
+    EN_SD,          // SD card operations
+    EN_SLEEP,       // waiting between samples
+    EN_COUNT
+};
+
+/* --- ONE CYCLE, AS STORED IN THE SD RING (40 bytes) --- */
+struct EnergyRecord {
+    uint32_t seq;               // cycle number since first boot of the ring
+    uint32_t ms[EN_COUNT];      // exclusive time per state
+    uint32_t uAh;               // estimated charge for the cycle
+};
+
+/* Per-state current draw in µA. Defaults are bench estimates for the
+ * Maduino Zero 4G; override at runtime with energySetCurrent(). */
+extern uint32_t energyCurrent_uA[EN_COUNT];
+
+void     energyBegin();
+void     energySetCurrent(EnergyState s, uint32_t uA);
+void     energyEnter(EnergyState s);
+void     energyExit();
+uint32_t energyCycleEnd();                       // closes the cycle, logs it, returns µAh
+const EnergyRecord& energyLastCycle();
+bool     energyStatus(char* out, size_t len);    // "E=12.345mAh LTE=..." or false if none
+
+/* --- RAII helper: charges the enclosing scope to one state --- */
+class EnergyScope {
+public:
+    explicit EnergyScope(EnergyState s) { energyEnter(s); }
+    ~EnergyScope() { energyExit(); }
+    EnergyScope(const EnergyScope&) = delete;
+    EnergyScope& operator=(const EnergyScope&) = delete;
+};
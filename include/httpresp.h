@@ -0,0 +1,72 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* ========================================================
+ *  MODEM SOCKET STREAM PARSERS
+ *  IpdDemux  splits the SIM7600 UART into socket payload
+ *            ("+IPD<len>\r\n" then <len> raw bytes; the prefix
+ *            is "+CCHRECV: DATA,0," for SSL sessions) and
+ *            ordinary result / URC lines.
+ *  HttpResponse  incremental HTTP/1.1 response parser for
+ *            pipelined replies: Content-Length and chunked
+ *            bodies, only the first HTTP_BODY_MAX-1 body
+ *            bytes kept.
+ *  Byte at a time, allocation-free, no Arduino headers.
+ * ======================================================== */
+
+#define IPD_LINE_MAX   96
+#define HTTP_BODY_MAX  32
+
+class IpdDemux {
+public:
+    enum Kind : uint8_t {
+        NONE = 0,       // byte consumed, nothing to report yet
+        PAYLOAD,        // *out is a socket payload byte
+        LINE,           // a complete non-payload line is in line()
+        PROMPT,         // the "> " send prompt
+    };
+
+    explicit IpdDemux(const char* prefix = "+IPD")
+        : pre(prefix), preLen((uint8_t)strlen(prefix)) { reset(); }
+    void reset();
+    Kind feed(uint8_t b, uint8_t* out);
+    const char* line() const { return buf; }
+
+private:
+    enum State : uint8_t { TEXT, LEN, LEN_LF, DATA };
+    const char* pre;
+    uint8_t  preLen;
+    State    st;
+    uint32_t remain;
+    uint8_t  n;
+    char     buf[IPD_LINE_MAX];
+};
+
+class HttpResponse {
+public:
+    HttpResponse() { reset(); }
+    void reset();
+
+    bool feed(uint8_t b);               // true on the byte that ends a response
+    bool done() const { return st == DONE; }
+    uint16_t status() const { return code; }
+    const char* body() const { return bodyBuf; }
+    bool closing() const { return connClose; }  // "Connection: close"
+
+private:
+    enum State : uint8_t { STATUS, HEADER, BODY, CHUNK_SIZE, CHUNK_DATA, CHUNK_END, TRAILER, DONE };
+
+    void header();
+    void keep(uint8_t b);
+
+    State    st;
+    uint16_t code;
+    bool     chunked, connClose, haveLen;
+    uint32_t remain;
+    uint8_t  n;
+    char     lineBuf[64];
+    uint8_t  bodyLen;
+    char     bodyBuf[HTTP_BODY_MAX];
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================
+ *  TABLE-DRIVEN I²C INGEST
+ *  The EnviroPro sends each record type as a block that
+ *  starts with "<tag>," and spans several I²C packets; a
+ *  packet shorter than INGEST_END_LEN closes the block.
+ *  Record types come from a caller-supplied table, and the
+ *  table order is the column order of the stored row.
+ *  Fixed buffers only: feed() is safe to call from the
+ *  Wire receive ISR. No Arduino headers.
+ * ======================================================== */
+
+#define INGEST_TYPES_MAX  4
+#define INGEST_BUF_MAX    128           // values of one block, NUL included
+#define INGEST_END_LEN    15            // shorter packet = last of the block
+
+struct IngestType {
+    const char* tag;                    // "Moist" → block starts "Moist,"
+    bool        required;               // a sample waits for this block
+};
+
+enum IngestEvent : uint8_t {
+    ING_IGNORED = 0,    // not part of any block
+    ING_START,          // header of a new block
+    ING_MORE,           // continuation
+    ING_DONE,           // block complete
+    ING_OVERFLOW,       // block too long, dropped
+};
+
+class Ingest {
+public:
+    Ingest(const IngestType* types, uint8_t n);
+
+    IngestEvent feed(const char* p, size_t n);
+
+    bool        busy() const  { return assembling; }
+    bool        ready() const;                      // every required block complete
+    uint8_t     types() const { return nTypes; }
+    const IngestType& type(uint8_t i) const { return table[i]; }
+    int8_t      current() const { return cur; }     // type of the last block touched
+    bool        has(uint8_t i) const { return slot[i].done; }
+    const char* values(uint8_t i) const { return slot[i].done ? slot[i].buf : ""; }
+    void        clear();
+
+private:
+    struct Slot {
+        char    buf[INGEST_BUF_MAX];
+        uint8_t len;
+        bool    done;
+    };
+
+    bool append(const char* p, size_t n);
+
+    const IngestType* table;
+    uint8_t           nTypes;
+    Slot              slot[INGEST_TYPES_MAX];
+    volatile int8_t   cur;
+    volatile bool     assembling;
+};
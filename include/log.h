@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* ========================================================
+ *  LEVELLED LOGGING
+ *  LOG_LEVEL is fixed at compile time (platformio.ini build
+ *  flag). Calls above it expand to ((void)0): no format
+ *  string in flash, no argument evaluation, no cycles.
+ * ======================================================== */
+
+#define LOG_LVL_NONE   0
+#define LOG_LVL_ERROR  1
+#define LOG_LVL_WARN   2
+#define LOG_LVL_INFO   3
+#define LOG_LVL_DEBUG  4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LVL_INFO
+#endif
+
+/* Binary trace ring, flushed to TRACE.BIN by traceFlush() */
+#ifndef LOG_TRACE
+#define LOG_TRACE 0
+#endif
+
+#define LOG_ON(lvl) (LOG_LEVEL >= (lvl))
+
+/* printf-style into a static buffer; lines longer than LOG_LINE_MAX are cut */
+#define LOG_LINE_MAX 160
+void logWrite(uint8_t lvl, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void logRaw(const char* s, size_t n);          // verbatim, e.g. modem replies
+
+#if LOG_ON(LOG_LVL_ERROR)
+#define LOG_ERROR(...) logWrite(LOG_LVL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if LOG_ON(LOG_LVL_WARN)
+#define LOG_WARN(...)  logWrite(LOG_LVL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...)  ((void)0)
+#endif
+
+#if LOG_ON(LOG_LVL_INFO)
+#define LOG_INFO(...)  logWrite(LOG_LVL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)  ((void)0)
+#endif
+
+#if LOG_ON(LOG_LVL_DEBUG)
+#define LOG_DEBUG(...) logWrite(LOG_LVL_DEBUG, __VA_ARGS__)
+#define LOG_DEBUG_RAW(s, n) logRaw((s), (n))
+#else
+#define LOG_DEBUG(...) ((void)0)
+#define LOG_DEBUG_RAW(s, n) ((void)0)
+#endif
+
+/* --- TRACE POINTS: 8 bytes each, safe to call from an ISR --- */
+enum TraceId : uint16_t {
+    TR_BOOT = 1,
+    TR_STATE,           // arg = new state
+    TR_CHUNK,           // arg = chunk length
+    TR_BLOCK_DONE,      // arg = record type
+    TR_SAMPLE,          // arg = 1 ok / 0 cancelled
+    TR_UPLOAD,          // arg = 1 ok / 0 failed
+    TR_SD_FAIL,
+    TR_TRIGGER,         // arg = rule index
+    TR_RESET,           // arg = ResetCause << 8 | WdTask at the last checkpoint
+};
+
+#if LOG_TRACE
+void tracePoint(uint16_t id, uint16_t arg);
+void traceFlush();                              // append ring to SD, then clear
+#define TRACE(id, arg) tracePoint((id), (uint16_t)(arg))
+#else
+#define TRACE(id, arg) ((void)0)
+inline void traceFlush() {}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+#include "lorasched.h"
+
+/* ========================================================
+ *  LoRa INGEST (RYLR993 on SERCOM3, pins 2 = RX / 3 = TX)
+ *  Field nodes send NodeFrame payloads; the gateway turns
+ *  them into TSV rows in the backlog lane so they go out in
+ *  the same LTE drain as local EnviroPro samples.
+ * ======================================================== */
+
+#define LORA_BAUD          9600
+#define LORA_GATEWAY_ADDR  1        // AT+ADDRESS of this gateway
+#define LORA_BROADCAST     0
+
+/* --- TDMA defaults: 15 min superframe, 1 s slots (40 B @ SF9 ≈ 0.3 s airtime) --- */
+#define LORA_PERIOD_MS     900000UL
+#define LORA_BEACON_MS     600
+#define LORA_SLOT_MS       1000
+#define LORA_GUARD_MS      150
+
+bool    loraBegin();                    // SERCOM3 UART + module address
+void    loraAttach(Stream& port);       // replace the radio, e.g. with a host stand-in
+String  loraAT(const String& cmd, uint32_t to = 2000, bool dbg = true);
+bool    loraOn();                       // AT+MODE=0
+void    loraOff();                      // AT+MODE=1 (µA sleep)
+bool    loraSendWake(uint16_t addr, uint8_t window = 10);
+bool    loraSend(uint16_t addr, const uint8_t* data, uint8_t len);   // binary-safe AT+SEND
+uint8_t loraService();                  // parse +RCV= frames, decode and queue; returns rows queued
+
+/* --- TDMA polling (see lorasched.h) --- */
+void    loraSchedBegin(const uint16_t* nodes, uint8_t n);
+void    loraSchedService();             // call often; drives beacon/listen/sleep
+const TdmaStats& loraSchedStats();
@@ -0,0 +1,84 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================
+ *  TDMA SCHEDULE FOR LoRa FIELD NODES
+ *  One superframe per period:
+ *
+ *    | beacon | slot 0 | slot 1 | ... | slot n-1 |  radio asleep  |
+ *
+ *  The beacon carries the slot table and the time to the next
+ *  beacon; node i only transmits inside slot i. The gateway
+ *  listens from guard ms before each slot until its node has
+ *  reported or the slot ends, and keeps the radio in MODE=1
+ *  the rest of the time.
+ *
+ *  Beacon payload, little-endian:
+ *    [0] TDMA_BEACON_V1  [1..4] gateway seconds of day
+ *    [5..8] ms to next beacon  [9..10] slotMs  [11..12] beaconMs
+ *    [13] node count n  [14..] uint16 address per slot
+ *
+ *  Pure timing logic (no radio I/O) so a host harness can run
+ *  it against virtual nodes.
+ * ======================================================== */
+
+#define TDMA_MAX_NODES   16
+#define TDMA_BEACON_V1   0xB1
+#define TDMA_BEACON_MAX  (14 + 2 * TDMA_MAX_NODES)
+
+struct TdmaConfig {
+    uint32_t periodMs;      // beacon to beacon
+    uint16_t beaconMs;      // time reserved for the beacon itself
+    uint16_t slotMs;        // per node: frame airtime + processing
+    uint16_t guardMs;       // listen this early to absorb node clock drift
+};
+
+struct TdmaStats {
+    uint32_t radioOnMs;     // gateway receive/transmit time
+    uint32_t superframes;
+    uint32_t frames;        // frames received from the slot owner
+    uint32_t strays;        // frames from anyone else inside a slot (collisions)
+    uint32_t misses;        // slots that closed with nothing heard
+};
+
+class TdmaSchedule {
+public:
+    enum Action : uint8_t {
+        TDMA_SLEEP = 0,     // radio off until `until`
+        TDMA_BEACON,        // send the beacon now, then call beaconSent()
+        TDMA_LISTEN,        // radio on until `until`
+    };
+
+    explicit TdmaSchedule(const TdmaConfig& c);
+
+    bool     addNode(uint16_t addr);             // false when full
+    int8_t   slotOf(uint16_t addr) const;        // -1 if unknown
+    uint8_t  nodes() const { return count; }
+
+    void     start(uint32_t now);
+    Action   step(uint32_t now, uint32_t& until);
+    void     beaconSent(uint32_t now);
+    void     frameSeen(uint16_t from, uint32_t now);
+    void     radio(bool on, uint32_t now);       // report radio state for the on-time stats
+
+    size_t   beacon(uint8_t* out, size_t cap, uint32_t secOfDay, uint32_t now) const;
+    const TdmaStats& stats() const { return st; }
+    const TdmaConfig& config() const { return cfg; }
+
+private:
+    uint32_t slotOpen(uint8_t i) const;          // offsets from superframe start
+    uint32_t slotClose(uint8_t i) const;
+    void     rollOver(uint32_t now);
+
+    TdmaConfig cfg;
+    TdmaStats  st;
+    uint16_t   addr[TDMA_MAX_NODES];
+    uint8_t    count;
+    uint32_t   t0;              // current superframe start
+    uint32_t   heard;           // bit i: slot i reported this superframe
+    uint32_t   closed;          // bit i: slot i accounted for (heard or missed)
+    bool       beaconDone;
+    bool       radioOn;
+    uint32_t   radioSince;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* ========================================================
+ *  MEMORY TELEMETRY
+ *  Heap minimums, largest free block and stack high-water
+ *  mark on the SAMD21, plus per-phase allocation counts.
+ *  Allocation counting is enabled by MEM_COUNT_ALLOCS together
+ *  with -Wl,--wrap=malloc -Wl,--wrap=free -Wl,--wrap=realloc
+ *  (see platformio.ini). The same flags work for a host build
+ *  with GNU ld and glibc, so the String-heavy code paths can
+ *  be counted off-target.
+ * ======================================================== */
+
+enum MemPhase : uint8_t {
+    MP_BOOT = 0,    // setup()
+    MP_IDLE,        // state machine, waiting
+    MP_SAMPLE,      // sampleData()
+    MP_UPLOAD,      // upload queue / uploadData()
+    MP_ISR,         // anything allocated from an interrupt (I²C ingest)
+    MP_COUNT
+};
+
+struct MemStats {
+    uint32_t freeMin;               // lowest free heap seen (bytes)
+    uint32_t largestMin;            // lowest "largest free block" seen
+    uint32_t stackMax;              // deepest stack use seen (bytes)
+    uint32_t heapPeak;              // highest live allocated bytes
+    uint32_t liveBytes;             // currently allocated bytes
+    uint32_t allocs[MP_COUNT];      // malloc/realloc calls since last report
+    uint32_t allocBytes[MP_COUNT];  // bytes requested since last report
+};
+
+void     memBegin();                // paint the free stack; call first in setup()
+MemPhase memPhase(MemPhase p);      // set attribution phase, returns the old one
+void     memSample();               // refresh heap/stack minimums
+uint32_t memFreeHeap();
+uint32_t memLargestFree();
+uint32_t memStackUsed();            // high-water mark from paint scan
+const MemStats& memStats();
+void     memReport();               // log a summary, then clear the per-phase counts
+void     memPeakReset();            // heapPeak back to liveBytes, e.g. per benchmark
+
+/* --- RAII helper: attribute allocations in this scope to one phase --- */
+class MemPhaseScope {
+public:
+    explicit MemPhaseScope(MemPhase p) : prev(memPhase(p)) {}
+    ~MemPhaseScope() { memSample(); memPhase(prev); }
+    MemPhaseScope(const MemPhaseScope&) = delete;
+    MemPhaseScope& operator=(const MemPhaseScope&) = delete;
+private:
+    MemPhase prev;
+};
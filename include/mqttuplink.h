@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include "httpresp.h"
+#include "uplink.h"
+
+/* ========================================================
+ *  MQTT OVER THE SIM7600 CMQTT STACK
+ *  AT+CMQTTSTART / ACCQ / CONNECT on client 0, then per row
+ *  AT+CMQTTTOPIC, AT+CMQTTPAYLOAD and AT+CMQTTPUB at the
+ *  QoS given to the constructor:
+ *   - 0: what the ThingSpeak broker takes. A row counts as
+ *        sent once the modem has accepted the publish; the
+ *        "+CMQTTPUB: 0,<err>" that follows is only logged.
+ *        At most once: rows lost with the connection after
+ *        that are gone, the cursor has moved past them.
+ *   - 1: for brokers that ack. Up to MQTT_WINDOW publishes
+ *        are outstanding and a row only counts as sent once
+ *        its PUBACK ("+CMQTTPUB: 0,0") is in, so the queue
+ *        cursor never moves past an unacked row. At least
+ *        once: a row whose ack was lost is sent again.
+ *  The session is asked for with clean-session 0 and, when
+ *  keepOpen(), held across drains.
+ * ======================================================== */
+
+#define MQTT_WINDOW        4
+#define MQTT_KEEPALIVE_S   300
+#define MQTT_PUB_TIMEOUT_S 30
+
+class MqttUplink : public Uplink {
+public:
+    /* broker "tcp://host:port"; format writes the payload for one row */
+    MqttUplink(Stream& modem, const char* broker, const char* clientId,
+               const char* user, const char* pass, const char* topic,
+               RowFormatFn format, uint8_t qos = 0);
+
+    bool    begin() override;
+    uint8_t window() const override { return MQTT_WINDOW; }
+    size_t  encode(const char* row, char* out, size_t cap) override;
+    bool    post(const char* wire, size_t len) override;
+    uint8_t collect(UploadResult* res, uint8_t n) override;
+    void    poll() override;
+    void    end() override;
+
+    void    keepOpen(bool on) { linger = on; }      // hold the session between drains
+    bool    isConnected() const { return connected; }
+    void    drop() { connected = false; }           // modem was reset or powered off
+
+protected:
+    /* Pump the UART until a line starting with ok / err (or ERROR).
+     * PUBACK and connection-lost URCs are handled on the way. */
+    int  waitFor(const char* ok, const char* err, uint32_t to, bool prompt = false);
+    void command(const char* cmd);
+    bool block(const char* cmd, const char* data, size_t n);  // "> " then raw bytes
+    IpdDemux::Kind pump(uint8_t b);
+    bool connect();
+    void disconnect();
+
+    Stream&      io;
+    const char*  broker;
+    const char*  clientId;
+    const char*  user;
+    const char*  pass;
+    const char*  topic;
+    RowFormatFn  format;
+    uint8_t      qos;                   // 0 or 1
+    bool         connected;
+    bool         linger;
+
+    IpdDemux     lines;                 // no socket payload here, just lines and "> "
+    InFlight     inflight;              // rows posted since the last collect()
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "textproc.h"
+
+/* ========================================================
+ *  FIELD NODE SENSOR FRAME (LoRa payload)
+ *  Little-endian, 8 depths max → at most 40 bytes on air.
+ *    [0]      NODE_FRAME_V1
+ *    [1]      sequence number
+ *    [2]      depth count n (1..8)
+ *    [3..]    int16 temperature[n]   centi-°C
+ *    [..]     int16 moisture[n]      centi-%
+ *    [..]     uint16 battery         mV
+ * ======================================================== */
+
+#define NODE_FRAME_V1      0x01
+#define NODE_MAX_DEPTHS    8
+#define NODE_FRAME_MAX     (3 + 4 * NODE_MAX_DEPTHS + 2)
+
+struct NodeFrame {
+    uint16_t addr;                      // RYLR993 sender address
+    int16_t  rssi;
+    int16_t  snr;
+    uint8_t  seq;
+    uint8_t  depths;
+    int16_t  temp[NODE_MAX_DEPTHS];     // centi-°C
+    int16_t  moist[NODE_MAX_DEPTHS];    // centi-%
+    uint16_t battery_mV;
+};
+
+/* Payload → frame. addr/rssi/snr are left for the caller to fill. */
+bool nodeFrameDecode(const uint8_t* p, size_t n, NodeFrame& f);
+size_t nodeFrameEncode(const NodeFrame& f, uint8_t* out, size_t cap);
+
+/* TSV row laid out like a local sample so the same ThingSpeak fields line up:
+ *   date  time  N<addr>  temps  moists  rssi,snr,battery */
+bool nodeFrameRow(const NodeFrame& f, const char* date, const char* time, TextBuf& out);
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================
+ *  NVM STATE STORE
+ *  A few dozen bytes that must outlive a reset (scheduler
+ *  position, last fix, clock), kept in on-chip flash instead
+ *  of on the card:
+ *   - target: NVSTORE_ROWS erase rows inside the sketch's
+ *             own image (a row-aligned const array, placed
+ *             with .rodata wherever the linker puts it),
+ *             written through NVMCTRL. Uploading a sketch
+ *             rewrites it as zeros, so the state survives
+ *             resets and power loss but not a reflash
+ *   - host:   a file of the same size (nvstoreFile())
+ *  Each commit is one 64-byte page, appended round the area
+ *  as a log: seq, length, data, CRC. The newest valid page
+ *  is the state. A commit never touches the page holding
+ *  the previous state, so a write torn by a reset leaves it
+ *  readable; a row is erased only when the log wraps into
+ *  it, which spreads the wear over the whole area.
+ * ======================================================== */
+
+#define NVSTORE_PAGE      64        // NVMCTRL write unit
+#define NVSTORE_ROW       256       // erase unit: four pages
+#define NVSTORE_ROWS      16        // 4 KB, 64 commits per erase of a row
+#define NVSTORE_DATA_MAX  (NVSTORE_PAGE - 12)
+
+bool nvstoreLoad(void* data, size_t n);             // newest committed state; false if none
+bool nvstoreCommit(const void* data, size_t n);     // false: not written (n too big, flash fault)
+#if !defined(ARDUINO_ARCH_SAMD)
+void nvstoreFile(const char* path);                 // host: file standing in for the flash; rescanned
+#endif
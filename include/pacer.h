@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+
+/* ========================================================
+ *  REQUEST PACER
+ *  Token bucket: one token every periodMs, at most burst
+ *  held. ThingSpeak takes one channel update per 15 s on the
+ *  free tier (1 s paid); an update sent early is answered
+ *  200 with entry id 0 and dropped, so the uplinks wait for
+ *  a token first. backoff() empties the bucket when the
+ *  server says it was too soon anyway. No Arduino headers.
+ * ======================================================== */
+
+class RatePacer {
+public:
+    explicit RatePacer(uint32_t periodMs, uint8_t burst = 1);
+
+    void     setPeriod(uint32_t periodMs);      // 0: unpaced
+    uint32_t period() const { return periodMs; }
+    uint32_t waitMs(uint32_t now);              // 0 when a request may go now
+    void     take(uint32_t now);
+    void     backoff(uint32_t now);
+
+private:
+    void refill(uint32_t now);
+
+    uint32_t periodMs;
+    uint8_t  burst;
+    uint8_t  tokens;
+    uint32_t since;                             // start of the current period
+};
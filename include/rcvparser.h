@@ -0,0 +1,88 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================
+ *  RYLR993 "+RCV=addr,len,data,rssi,snr\r\n" PARSER
+ *  Incremental and allocation-free: bytes go in one at a
+ *  time, <data> is taken as exactly <len> raw bytes (so
+ *  commas, CR/LF or NUL in a binary payload are fine), and
+ *  each complete frame is handed to a callback. Anything
+ *  that isn't a well-formed +RCV line is skipped until the
+ *  next "+RCV=".
+ * ======================================================== */
+
+#define RCV_PAYLOAD_MAX  240            // RYLR993 limit
+
+struct RcvFrame {
+    uint16_t       from;
+    int16_t        rssi;
+    int16_t        snr;
+    uint8_t        len;
+    const uint8_t* data;                // valid only during the callback
+};
+
+/* --- Fixed single-producer / single-consumer byte ring --- */
+template <size_t N>
+class ByteRing {
+    static_assert((N & (N - 1)) == 0, "ByteRing size must be a power of two");
+public:
+    ByteRing() : head(0), tail(0), dropped(0) {}
+
+    bool push(uint8_t b) {
+        size_t h = head;
+        if (((h + 1) & (N - 1)) == tail) { dropped++; return false; }
+        buf[h] = b;
+        head = (h + 1) & (N - 1);
+        return true;
+    }
+    bool pop(uint8_t& b) {
+        size_t t = tail;
+        if (t == head) return false;
+        b = buf[t];
+        tail = (t + 1) & (N - 1);
+        return true;
+    }
+    size_t size() const { return (head - tail) & (N - 1); }
+    size_t space() const { return N - 1 - size(); }
+    uint32_t overruns() const { return dropped; }
+
+private:
+    uint8_t buf[N];
+    volatile size_t head, tail;
+    volatile uint32_t dropped;
+};
+
+class RcvParser {
+public:
+    typedef void (*FrameFn)(const RcvFrame& f, void* ctx);
+
+    RcvParser(FrameFn fn, void* ctx = nullptr);
+
+    void feed(uint8_t b);
+    void feed(const uint8_t* p, size_t n) { while (n--) feed(*p++); }
+
+    template <size_t N>
+    void drain(ByteRing<N>& r) { uint8_t b; while (r.pop(b)) feed(b); }
+
+    uint32_t frames() const { return nFrames; }
+    uint32_t errors() const { return nErrors; }     // malformed lines dropped
+
+private:
+    enum State : uint8_t { MATCH, ADDR, LEN, DATA, RSSI, SNR };
+
+    void reset();
+    void fail(uint8_t b);
+    bool digit(uint8_t b, int32_t& acc, bool allowSign);
+
+    FrameFn  fn;
+    void*    ctx;
+    State    st;
+    uint8_t  matched;           // prefix bytes of "+RCV=" seen
+    uint8_t  digits;            // digits in the current number
+    bool     neg;
+    int32_t  addr, len, rssi, snr;
+    uint8_t  got;               // payload bytes so far
+    uint8_t  data[RCV_PAYLOAD_MAX];
+    uint32_t nFrames, nErrors;
+};
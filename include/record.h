@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================
+ *  FRAMED ROWS
+ *  Every row stored on SD is written as one text line
+ *      @LLL:CCCCCCCC:<row>
+ *  LLL = row length (hex), CCCCCCCC = CRC-32 of the row.
+ *  A torn, merged or bit-flipped line fails the check and is
+ *  never uploaded. Lines without the '@' prefix are rows from
+ *  older firmware and are passed through unchecked.
+ *  No Arduino headers: builds on the host as well.
+ * ======================================================== */
+
+#define RECORD_OVERHEAD  14             // "@LLL:CCCCCCCC:"
+
+uint32_t crc32(const void* data, size_t n, uint32_t crc = 0);
+
+/* Frame row into out (cap includes the NUL). False if it didn't fit. */
+bool recordFrame(const char* row, char* out, size_t cap);
+
+enum RecordCheck : uint8_t {
+    REC_OK = 0,         // framed and intact
+    REC_LEGACY,         // unframed line from older firmware
+    REC_BAD,            // torn or corrupt: drop it
+};
+
+/* Validate a line in place; on REC_OK/REC_LEGACY *row points at the payload */
+RecordCheck recordCheck(char* line, char** row);
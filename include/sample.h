@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ingest.h"
+#include "textproc.h"
+
+/* ========================================================
+ *  TYPED SAMPLE
+ *  One gateway reading in scaled integers, parsed once from
+ *  the ingest text and formatted once into the stored row:
+ *    EnviroPro values  hundredths (centi-°C, centi-%)
+ *    GNSS              micro-degrees / decimetres (GpsFix)
+ *    IR temperatures   deci-°C
+ *  No float anywhere, so no soft-float calls on the M0+.
+ * ======================================================== */
+
+#define SAMPLE_DEPTHS_MAX  8
+
+struct Sample {
+    GpsFix  fix;
+    uint8_t depths[INGEST_TYPES_MAX];                   // 0: type missing
+    int32_t value[INGEST_TYPES_MAX][SAMPLE_DEPTHS_MAX]; // hundredths
+    int16_t irAir_dC;
+    int16_t irSurface_dC;
+};
+
+/* "12.1,13.25,…" → hundredths; n = values stored. False on non-numeric text. */
+bool sampleParse(const char* csv, int32_t* out, uint8_t max, uint8_t& n);
+
+/* date  time  lat,lon,alt  <one column per type>  air,surface */
+bool sampleRow(const Sample& s, uint8_t types, const char* date, const char* time,
+               TextBuf& out);
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+
+/* ========================================================
+ *  BUFFERED SD APPEND PATH
+ *  Rows for the backlog day files collect in a one-sector
+ *  RAM buffer; the file stays open between appends. The
+ *  buffer is written out when the next row won't fit, when
+ *  sdlogFlush() is called (before sleep, before a drain
+ *  reads the files, when the queue demotes its unsent latest
+ *  row), or once it is older than sdlogMaxAgeMs.
+ *  A new day file is preallocated so its sectors are
+ *  contiguous for the drain's multi-block reads; rows are
+ *  written from offset 0 and sdlogClose() truncates the
+ *  unused tail, so readers never see it.
+ *
+ *  Each write-out is bracketed by a small marker (WAL.DAT)
+ *  recording file, start offset and length, which is also
+ *  where the rows end while the file is open. sdlogRecover()
+ *  uses it at boot to cut off the tail and neutralise a row
+ *  torn by a brownout.
+ * ======================================================== */
+
+#define SDLOG_SECTOR  512
+#define SDLOG_PREALLOC 262144UL     // contiguous space reserved for a new day file (~2000 rows)
+
+extern uint32_t sdlogMaxAgeMs;      // oldest a buffered row may get (default 60 s)
+
+bool sdlogAppend(const char* file, const char* row);    // row without newline
+bool sdlogFlush();                  // write buffer, keep file open; true once nothing is buffered
+void sdlogClose();                  // flush and close (before readers touch the file)
+void sdlogService();                // flush by age; call from idle loops
+void sdlogRecover();                // boot: cut to the rows' end, repair a torn row
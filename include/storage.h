@@ -0,0 +1,89 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ARDUINO
+#include <SdFat.h>
+#else
+#include <stdio.h>
+#include <dirent.h>
+#endif
+
+/* ========================================================
+ *  STORAGE
+ *  The file operations the firmware uses and no more, so
+ *  the backend can change underneath:
+ *   - target: SdFat (FAT16/32 and exFAT) on a dedicated SPI
+ *             bus, sector runs moved by the DMAC (dmaspi.h)
+ *             and multi-block transfers where files are
+ *             contiguous
+ *   - host:   a plain directory (storeRoot()), so the queue,
+ *             log and config code runs off-target on real
+ *             files
+ *  Names are 8.3, in the card root. Files are values like
+ *  the old SD File: copies share the open file and nothing
+ *  is closed behind the caller's back.
+ * ======================================================== */
+
+enum StoreMode : uint8_t {
+    ST_READ = 0,        // existing file, read only
+    ST_RW,              // read/write from offset 0; created if missing
+    ST_APPEND,          // read/write, created if missing; writes go to the end
+    ST_TRUNC,           // created, or emptied, for writing
+};
+
+class StoreFile {
+public:
+    StoreFile();
+
+    explicit operator bool() const;
+    int      read();                            // one byte, -1 at the end
+    int      read(void* buf, size_t n);         // bytes read, 0 at the end, -1 on error
+    size_t   write(uint8_t b) { return write(&b, 1); }
+    size_t   write(const void* p, size_t n);
+    size_t   println(const char* s);            // s, then CR/LF
+    bool     seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    /* Contiguous clusters for a still empty file, so later writes
+     * and reads run as multi-block transfers. The size jumps to
+     * `bytes` and the tail reads as whatever the clusters held: the
+     * writer keeps its own end and truncate()s to it. False if the
+     * file is not empty or the backend cannot. */
+    bool     preallocate(uint32_t bytes);
+    bool     truncate(uint32_t size);           // drop everything from `size` on
+    void     flush();                           // data and directory entry on the card
+    void     close();
+
+private:
+    friend StoreFile storeOpen(const char* name, StoreMode mode);
+#ifdef ARDUINO
+    FsFile f;
+#else
+    FILE*   f;
+    uint8_t lastOp;                             // 'r' / 'w' / 0 after a seek
+#endif
+};
+
+/* --- Files in the root, in directory order; directories skipped --- */
+class StoreDir {
+public:
+    StoreDir();
+    bool open();
+    bool next(char* name, size_t cap, uint32_t* size = nullptr);
+    void close();
+
+private:
+#ifdef ARDUINO
+    FsFile dir;
+#else
+    DIR*   dir;
+#endif
+};
+
+bool      storeBegin(uint8_t csPin);            // mount the card; true once mounted
+bool      storeExists(const char* name);
+bool      storeRemove(const char* name);
+StoreFile storeOpen(const char* name, StoreMode mode);
+#ifndef ARDUINO
+void      storeRoot(const char* dir);           // directory standing in for the card (default ".")
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+
+/* ========================================================
+ *  TALKBACK CONFIG CHANNEL
+ *  Pulls the next command from a ThingSpeak TalkBack queue
+ *  (GET …/commands/execute pops it) over the SIM7600 HTTP
+ *  service: AT+HTTPINIT, +HTTPPARA, +HTTPACTION, +HTTPREAD.
+ *  A command that is a valid config blob (config.h) becomes
+ *  the running config and is saved to CONFIG.TXT; anything
+ *  else is logged and dropped. Applying it to the firmware's
+ *  timers is left to the caller.
+ * ======================================================== */
+
+/* Body of the next command into out (NUL-terminated). Returns its
+ * length (not read if it does not fit in cap), 0 when the queue is
+ * empty, -1 on an HTTP or modem failure. */
+long talkbackExecute(Stream& modem, const char* url, char* out, size_t cap);
+
+/* Execute, validate, persist; true when config was replaced */
+bool talkbackFetchConfig(Stream& modem, const char* url);
@@ -0,0 +1,96 @@
+#pragma once
+#include <Arduino.h>
+#include "httpresp.h"
+#include "uplink.h"
+
+/* ========================================================
+ *  HTTP/1.1 OVER THE SIM7600 SOCKET API
+ *  AT+NETOPEN / AT+CIPOPEN / AT+CIPSEND on link 0. One
+ *  keep-alive connection is held for a whole drain, up to
+ *  TCP_PIPELINE requests are sent before their responses are
+ *  read, and the server address from AT+CDNSGIP is cached
+ *  for TCP_DNS_TTL_MS.
+ *  In bulk mode a whole window goes out as one POST instead
+ *  (ThingSpeak bulk_update.json) and every row in it shares
+ *  the one answer.
+ *  Subclasses swap the socket commands (open / close / send)
+ *  and keep the HTTP side as is.
+ * ======================================================== */
+
+#define TCP_PIPELINE      4
+#define TCP_DNS_TTL_MS    (6UL * 3600UL * 1000UL)
+#define TCP_IDLE_MAX_MS   60000UL       // held connection idle longer than this is reopened
+#define TCP_SEND_MAX      1460          // bytes per AT+CIPSEND / AT+CCHSEND
+
+/* One POST carrying a window of rows */
+struct BulkFormat {
+    const char* target;                 // request path
+    const char* prefix;                 // body before the first item
+    const char* suffix;                 // body after the last item
+    RowFormatFn item;                   // one row as a body item; items are ','-joined
+};
+
+class TcpUplink : public Uplink {
+public:
+    TcpUplink(Stream& modem, const char* host, uint16_t port, RowFormatFn path);  // path: "/update?…"
+
+    bool    begin() override;
+    uint8_t window() const override { return bulkFmt ? UPLINK_WINDOW_MAX : TCP_PIPELINE; }
+    size_t  encode(const char* row, char* out, size_t cap) override;
+    bool    post(const char* wire, size_t len) override;
+    uint8_t collect(UploadResult* res, uint8_t n) override;
+    void    poll() override;
+    void    end() override;
+
+    void    forgetDns() { ipAt = 0; ip[0] = '\0'; }
+    void    keepOpen(bool on) { linger = on; }      // hold the connection between drains
+    bool    isConnected() const { return connected; }
+    void    drop() { connected = false; }           // modem was reset or powered off
+    void    bulk(const BulkFormat* f) { bulkFmt = f; }   // nullptr: one GET per row
+    bool    isBulk() const { return bulkFmt != nullptr; }
+
+protected:
+    TcpUplink(Stream& modem, const char* host, uint16_t port, RowFormatFn path,
+              const char* ipdPrefix);
+
+    /* --- socket dialect --- */
+    virtual bool open();                                // link 0 up and connected
+    virtual void close();
+    virtual void sendCommand(char* cmd, size_t cap, size_t len) const;
+    virtual const char* sendDone() const { return "+CIPSEND: 0,"; }
+    virtual bool closedBy(const char* line) const;      // URC: peer or network closed
+    virtual const char* tag() const { return "[TCP]"; }
+
+    /* Pump the UART until a result line containing ok / err shows up.
+     * Socket payload arriving meanwhile is parsed, not lost. */
+    int  waitFor(const char* ok, const char* err, uint32_t to, bool prompt = false);
+    void command(const char* cmd);
+    bool resolve();
+    bool connect();
+    void abandon();
+    bool sendv(const char* const* part, const size_t* len, uint8_t n);
+    bool sendBulk();
+    IpdDemux::Kind pump(uint8_t b);
+
+    Stream&      io;
+    const char*  host;
+    uint16_t     port;
+    RowFormatFn  path;
+    bool         connected;
+    bool         linger;
+    uint32_t     lastUse;               // millis() of the last response
+
+    char         ip[16];
+    uint32_t     ipAt;                  // millis() of the lookup, 0 = none
+
+    IpdDemux     demux;
+    HttpResponse resp;
+    InFlight     inflight;              // requests sent since the last collect()
+
+    const BulkFormat* bulkFmt;
+    const char*  bulkItem[UPLINK_WINDOW_MAX];   // posted rows waiting for the POST
+    size_t       bulkLen[UPLINK_WINDOW_MAX];
+    uint8_t      bulkN;
+
+    UploadResult judge(uint16_t status, const char* body);
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========================================================
+ *  TEXT KERNELS
+ *  Allocation-free versions of the row / URL / NMEA helpers.
+ *  Nothing here touches Arduino headers, so the same file
+ *  compiles on the host for profiling against sample data.
+ * ======================================================== */
+
+/* --- Bounded append buffer: stops writing once full, remembers it --- */
+struct TextBuf {
+    char*  p;
+    size_t cap;
+    size_t len;
+    bool   ok;
+
+    TextBuf(char* buf, size_t n) : p(buf), cap(n), len(0), ok(n > 0) { if (n) buf[0] = '\0'; }
+    TextBuf& add(const char* s);
+    TextBuf& add(const char* s, size_t n);
+    TextBuf& add(char c);
+    TextBuf& addUint(uint32_t v);
+};
+
+/* "a\tb c\t+d" → "field1=a&field2=b%20c&field3=%2Bd"; appends to out */
+bool tsvToFields(const char* tsv, TextBuf& out);
+
+/* In place: drop CR/LF and encode spaces as %20. False if it didn't fit. */
+bool rowSanitize(char* row, size_t cap);
+
+/* --- GNSS fix parsed from "+CGPSINFO: lat,N,lon,W,date,utc,alt,..." --- */
+struct GpsFix {
+    int32_t latitude_udeg;  // micro-degrees, south negative
+    int32_t longitude_udeg; // micro-degrees, west negative
+    int32_t altitude_dm;    // decimetres
+};
+bool parseCgpsInfo(const char* line, GpsFix& fix);     // false when there is no fix
+bool formatFix(const GpsFix& fix, TextBuf& out);       // "lat,lon,alt" (6,6,1 decimals)
+
+/* --- Fixed-point decimals: value × 10^decimals in an int32 --- */
+/* Parse "-12.345" at p into v (decimals ≤ 6, extra digits rounded) and
+ * advance p past it. False, with p unchanged, if there is no number. */
+bool parseFixed(const char*& p, uint8_t decimals, int32_t& v);
+bool addFixed(TextBuf& out, int32_t v, uint8_t decimals);
+
+/* --- Block-buffered line reader over anything with read(void*, n) --- */
+template <class Src, size_t BLOCK = 64>
+class LineReader {
+public:
+    explicit LineReader(Src& s) : src(s), pos(0), len(0), eof(false) {}
+
+    /* Next non-empty line without CR/LF. Returns its length, or -1 at
+     * end of input. Lines longer than cap-1 are truncated; a last line
+     * with no newline (torn write) is not returned. */
+    int next(char* out, size_t cap) {
+        size_t n = 0;
+        for (;;) {
+            if (pos == len) {
+                int r = eof ? 0 : src.read(blk, BLOCK);
+                if (r <= 0) { eof = true; n = 0; break; }
+                len = (size_t)r; pos = 0;
+            }
+            char c = (char)blk[pos++];
+            if (c == '\n') {
+                if (n) break;           // skip empty lines
+                continue;
+            }
+            if (c == '\r') continue;
+            if (n + 1 < cap) out[n++] = c;
+        }
+        if (cap) out[n] = '\0';
+        return n ? (int)n : -1;
+    }
+
+    /* Bytes already pulled from the source but not yet returned */
+    size_t buffered() const { return len - pos; }
+
+private:
+    Src&    src;
+    uint8_t blk[BLOCK];
+    size_t  pos, len;
+    bool    eof;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "tcpuplink.h"
+
+/* ========================================================
+ *  HTTPS OVER THE SIM7600 SSL SOCKET (CCH) API
+ *  Same keep-alive, pipelined HTTP/1.1 as TcpUplink, carried
+ *  on AT+CCHOPEN session 0 with SSL context 0 (AT+CSSLCFG).
+ *  The handshake is the expensive part, so the session is
+ *  held for the whole drain and, with keepOpen(), across
+ *  wake cycles until the server closes it.
+ *  caCert names a CA file already on the modem
+ *  (AT+CCERTDOWN); without one the link is encrypted but the
+ *  server is not verified.
+ * ======================================================== */
+
+class TlsUplink : public TcpUplink {
+public:
+    TlsUplink(Stream& modem, const char* host, uint16_t port, RowFormatFn path,
+              const char* caCert = nullptr);
+
+protected:
+    bool open() override;
+    void close() override;
+    void sendCommand(char* cmd, size_t cap, size_t len) const override;
+    const char* sendDone() const override { return "OK"; }
+    bool closedBy(const char* line) const override;
+    const char* tag() const override { return "[TLS]"; }
+
+    const char* ca;
+};
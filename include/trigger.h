@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "ingest.h"
+#include "sample.h"
+
+/* ========================================================
+ *  EVENT TRIGGERS
+ *  Rules checked against every completed EnviroPro block,
+ *  compared with the previous block of the same type:
+ *    TRIG_DELTA  |change| > threshold       (hundredths)
+ *    TRIG_RATE   |change| per minute > thr. (hundredths/min)
+ *  at one depth or at any depth. A fired rule is held off
+ *  for holdoffMs so one wetting front is one event.
+ *  Cheap enough for the Wire receive ISR. No Arduino headers.
+ * ======================================================== */
+
+#define TRIG_ANY_DEPTH  (-1)
+
+enum TriggerKind : uint8_t {
+    TRIG_DELTA = 0,
+    TRIG_RATE,
+};
+
+struct TriggerRule {
+    uint8_t     type;           // ingest type index (SENSOR_TYPES order)
+    TriggerKind kind;
+    int8_t      depth;          // 0-based, or TRIG_ANY_DEPTH
+    int32_t     threshold;
+    bool        upload;         // send the event row straight away
+};
+
+class TriggerEngine {
+public:
+    TriggerEngine(const TriggerRule* rules, uint8_t n, uint32_t holdoffMs);
+
+    /* Compare a block with the type's previous one, then keep it as the
+     * new baseline. Returns the first rule that fired, or -1. */
+    int8_t evaluate(uint8_t type, const int32_t* v, uint8_t n, uint32_t nowMs);
+
+    const TriggerRule& rule(uint8_t i) const { return rules[i]; }
+    uint32_t fired() const { return nFired; }
+
+private:
+    bool check(const TriggerRule& r, const int32_t* v, uint8_t n, uint32_t dtMs) const;
+
+    const TriggerRule* rules;
+    uint8_t            nRules;
+    uint32_t           holdoff;
+    int32_t            last[INGEST_TYPES_MAX][SAMPLE_DEPTHS_MAX];
+    uint8_t            lastN[INGEST_TYPES_MAX];
+    uint32_t           lastAt[INGEST_TYPES_MAX];
+    uint32_t           firedAt;
+    bool               armed;       // false until the first fire
+    uint32_t           nFired;
+};
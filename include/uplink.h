@@ -0,0 +1,113 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "pacer.h"
+#include "textproc.h"
+#include "upqueue.h"
+
+/* ========================================================
+ *  UPLINK TRANSPORT
+ *  What the upload queue drains into. A row is first
+ *  encode()d into its wire form (request, MQTT payload), then
+ *  post()ed. A transport may keep up to window() rows in
+ *  flight: the queue posts that many, then collect()s one
+ *  result per row, in order. Encoding is separate so the
+ *  queue can prepare the next batch while one is on the air,
+ *  polling the transport meanwhile. begin()/end() bracket a
+ *  whole drain so a connection can be held open across it.
+ *  With a pacer set, every request waits for its token.
+ * ======================================================== */
+
+#define UPLINK_WINDOW_MAX  8
+#define UPLINK_WIRE_MAX    512      // longest wire form of one row
+
+class Uplink {
+public:
+    virtual ~Uplink() {}
+
+    virtual bool    begin() = 0;                // link up for a drain
+    virtual uint8_t window() const = 0;         // max rows posted before collect()
+    /* Wire form of row into out (NUL-terminated); returns its length,
+     * 0 if the server would refuse the row or it does not fit in cap */
+    virtual size_t  encode(const char* row, char* out, size_t cap) = 0;
+    /* wire stays untouched until the row is collected */
+    virtual bool    post(const char* wire, size_t len) = 0;  // false: not sent, UP_FAILED
+    /* Results of the posted rows, oldest first. Returns how many were
+     * filled; rows without a result are retried later. */
+    virtual uint8_t collect(UploadResult* res, uint8_t n) = 0;
+    virtual void    poll() {}                   // never blocks: take in what has arrived
+    virtual void    end() = 0;
+
+    void pace(RatePacer* p) { pacer = p; }      // nullptr: send as fast as the link goes
+
+protected:
+    void paceWait();                            // poll() until the pacer lets a request out
+    void paceRefused();                         // server said the request came too soon
+
+    RatePacer* pacer = nullptr;
+};
+
+/* Writes the wire form of one row (request target, MQTT payload);
+ * false: the server would refuse it, so the row is skipped */
+typedef bool (*RowFormatFn)(const char* row, TextBuf& out);
+
+/* --- The one-request-at-a-time path (an UploadFn) as an Uplink --- */
+class FnUplink : public Uplink {
+public:
+    explicit FnUplink(UploadFn f) : fn(f), have(false), last(UP_FAILED) {}
+
+    bool    begin() override { return true; }
+    uint8_t window() const override { return 1; }
+    size_t  encode(const char* row, char* out, size_t cap) override {
+        size_t n = strlen(row);                 // fn() builds its own request
+        if (n >= cap) return 0;
+        memcpy(out, row, n + 1);
+        return n;
+    }
+    bool    post(const char* wire, size_t) override {
+        paceWait();
+        last = fn(wire);
+        have = true;
+        return true;
+    }
+    uint8_t collect(UploadResult* res, uint8_t n) override {
+        if (!have || !n) return 0;
+        res[0] = last;
+        have = false;
+        return 1;
+    }
+    void    end() override {}
+
+private:
+    UploadFn     fn;
+    bool         have;
+    UploadResult last;
+};
+
+/* --- Book-keeping for one window of posted rows ---
+ * Server answers arrive in send order. */
+class InFlight {
+public:
+    InFlight() { clear(); }
+    void clear() { posted = answered = 0; }
+    bool full() const { return posted >= UPLINK_WINDOW_MAX; }
+
+    void sent() { posted++; }
+    void answer(UploadResult r) { if (answered < UPLINK_WINDOW_MAX) answers[answered++] = r; }
+
+    uint8_t count() const { return posted; }
+    uint8_t received() const { return answered; }
+    uint8_t awaiting(uint8_t n) const { return n < posted ? n : posted; }
+    /* results for the first n rows, as far as they have come in */
+    uint8_t fill(UploadResult* res, uint8_t n) const {
+        uint8_t k = 0;
+        for (; k < n && k < answered; ++k) res[k] = answers[k];
+        return k;
+    }
+
+private:
+    uint8_t      posted;
+    UploadResult answers[UPLINK_WINDOW_MAX];
+    uint8_t      answered;
+};
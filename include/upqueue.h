@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/* ========================================================
+ *  STORE-AND-FORWARD UPLOAD QUEUE
+ *  Two lanes on SD:
+ *   - latest : LATEST.TXT, the newest row, always sent first
+ *   - backlog: the daily D<yymmdd>.CSV files, drained oldest
+ *              first from a persisted cursor (QUEUE.CUR)
+ *  A latest row that isn't sent before the next sample is
+ *  demoted into its day file through the buffered append
+ *  path (sdlog.h) and flushed there before LATEST.TXT is
+ *  overwritten, so no brownout finds it only in RAM.
+ *  While the card is missing, rows wait in a RAM FIFO
+ *  instead (the newest one is the latest) and are sent from
+ *  there; once the card mounts they move into their day
+ *  files. A full FIFO drops its oldest row.
+ *  Rows are stored CRC-framed (record.h); torn ones are
+ *  skipped, never uploaded.
+ * ======================================================== */
+
+enum UploadResult : uint8_t {
+    UP_OK = 0,          // accepted by the server
+    UP_FAILED,          // transient: keep the row, retry next cycle
+    UP_REJECTED,        // row can never succeed: skip it
+};
+
+#define QUEUE_RAM_BYTES 4096        // rows held while the card is missing (~30)
+
+typedef UploadResult (*UploadFn)(const char* row);
+class Uplink;                                           // uplink.h
+
+struct DrainStats {
+    uint16_t sent;
+    uint16_t skipped;
+    bool     empty;     // backlog fully drained
+};
+
+bool queuePush(const char* row, const char* dayFile);   // becomes the new latest
+bool queueAppend(const char* row, const char* dayFile); // straight into the backlog
+bool queueArchive(const char* row, const char* dayFile);// kept on SD, never uploaded
+bool queueHasLatest();
+bool queueHasBacklog();
+uint32_t queueBacklogBytes();                           // day-file bytes past the cursor
+/* The caller brackets these with up.begin() / up.end() */
+UploadResult queueSendLatest(Uplink& up);
+DrainStats queueDrain(Uplink& up, uint32_t budgetMs,    // stops once budget is spent
+                      uint16_t maxRows = 0);            // or after maxRows (0: no cap)
+void queueRecover();                                    // boot, after sdlogRecover()
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+/* ========================================================
+ *  WATCHDOG SUPERVISION
+ *  The SAMD21 WDT runs with an 8 s period and an early-
+ *  warning interrupt at 4 s. The interrupt feeds it for as
+ *  long as the task at the last checkpoint is inside the
+ *  budget that checkpoint gave itself, so one slow modem
+ *  command is fine while a loop that stopped checking in
+ *  is not. An overrun, or a hang with interrupts off, lets
+ *  the WDT bite.
+ *  The last checkpoint lives in RAM the startup code does
+ *  not clear (.noinit), so the next boot can say which task
+ *  hung and how far past its budget. Host build: the
+ *  checkpoints are kept, nothing resets.
+ * ======================================================== */
+
+#define WD_SLACK_MS 5000            // added to a bounded wait's own timeout
+
+enum WdTask : uint8_t {
+    WD_BOOT = 0,        // setup()
+    WD_LOOP,            // state machine, arg = state
+    WD_IDLE,            // idleWait()
+    WD_SAMPLE,          // sampleData()
+    WD_MODEM,           // AT exchange or power sequence, arg = timeout in s
+    WD_UPLINK,          // queue send / drain, arg = rows done
+    WD_SD,              // card mount and writes
+    WD_TASK_COUNT
+};
+extern const char* const WD_TASK_NAME[WD_TASK_COUNT];
+
+enum ResetCause : uint8_t {
+    RC_POWER = 0,       // power-on: nothing from the last run survives
+    RC_BROWNOUT,
+    RC_PIN,             // reset button / external
+    RC_WATCHDOG,
+    RC_SOFT,            // wdRestart() or another system reset request
+};
+extern const char* const RC_NAME[];
+
+/* What ended the previous run; task, arg and overMs only mean
+ * something for RC_WATCHDOG and RC_SOFT */
+struct WdReport {
+    ResetCause cause;
+    WdTask     task;            // at the last checkpoint
+    uint16_t   arg;
+    uint32_t   overMs;          // past the budget when the WDT was let go; 0: never got there
+    uint16_t   restarts;        // watchdog and soft resets since power-on
+};
+
+WdReport wdBegin();                                     // arm; first thing in setup()
+void     wdCheckpoint(WdTask t, uint32_t budgetMs, uint16_t arg = 0);
+void     wdRestart(WdTask t, uint16_t arg = 0);         // deliberate warm restart, cause kept
@@ -0,0 +1,67 @@
+#include <string.h>
+#include "aggregate.h"
+
+const char* const AGG_STAT_NAME[AGG_STAT_COUNT] = {"avg", "min", "max", "sd"};
+
+void Aggregator::reset() {
+    memset(ch, 0, sizeof(ch));
+    memset(nDepths, 0, sizeof(nDepths));
+    samples = 0;
+}
+
+bool Aggregator::add(uint8_t type, const int32_t* v, uint8_t n) {
+    if (type >= INGEST_TYPES_MAX) return false;
+    if (n > AGG_DEPTHS_MAX) n = AGG_DEPTHS_MAX;
+
+    for (uint8_t d = 0; d < n; ++d) {
+        Channel& c = ch[type][d];
+        if (!c.n) { c.min = c.max = c.base = v[d]; }
+        if (v[d] < c.min) c.min = v[d];
+        if (v[d] > c.max) c.max = v[d];
+        int64_t dv = (int64_t)v[d] - c.base;
+        c.sum   += dv;
+        c.sumSq += dv * dv;
+        if (c.n < 0xFFFF) c.n++;
+    }
+    if (n > nDepths[type]) nDepths[type] = n;
+    return true;
+}
+
+/* Integer square root (bitwise, no FPU needed) */
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t r = 0, bit = (uint64_t)1 << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) { v -= r + bit; r = (r >> 1) + bit; }
+        else r >>= 1;
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+int32_t Aggregator::stat(const Channel& c, AggStat s) const {
+    switch (s) {
+        case AGG_MIN: return c.min;
+        case AGG_MAX: return c.max;
+        case AGG_MEAN: {
+            int64_t half = c.sum >= 0 ? c.n / 2 : -(int64_t)(c.n / 2);
+            return c.base + (int32_t)((c.sum + half) / c.n);
+        }
+        case AGG_SD: {
+            if (c.n < 2) return 0;
+            int64_t ss = c.sumSq - c.sum * c.sum / c.n;     // Σ(x-mean)²
+            return ss > 0 ? (int32_t)isqrt64((uint64_t)(ss / (c.n - 1))) : 0;
+        }
+        default: return 0;
+    }
+}
+
+bool Aggregator::format(uint8_t type, AggStat s, TextBuf& out) const {
+    if (type >= INGEST_TYPES_MAX) return false;
+    for (uint8_t d = 0; d < nDepths[type]; ++d) {
+        if (d) out.add(',');
+        const Channel& c = ch[type][d];
+        if (c.n) addFixed(out, stat(c, s), 2);
+    }
+    return out.ok;
+}
@@ -0,0 +1,147 @@
+#include <Arduino.h>
+#include "config.h"
+#include "energy.h"
+#include "log.h"
+#include "record.h"
+#include "storage.h"
+
+bool sdInit();                              // jacob-main.cpp
+
+static const char CONFIG_FILE[] = "CONFIG.TXT";
+
+GatewayConfig config;
+
+void configDefaults(GatewayConfig& c) {
+    c.sampleIntervalS = 15;
+    c.cycleWaits      = 1;
+    c.uploadBudgetS   = 120;
+    c.batchRows       = 0;
+    c.powerPolicy     = PWR_MODEM_ON;
+    c.aggIntervalS    = 0;
+    c.transport       = TR_AT_HTTP;
+    c.ratePeriodS     = 15;
+    strcpy(c.apn, "fast.t-mobile.com");
+}
+
+/* --- KEY TABLE: name, range, where it goes --- */
+struct ConfigKey {
+    const char* name;
+    uint32_t    lo, hi;
+    uint8_t     size;                       // bytes of the numeric field
+    size_t      offset;
+};
+
+static const ConfigKey KEYS[] = {
+    {"si", 5, 86400,   4, offsetof(GatewayConfig, sampleIntervalS)},
+    {"cy", 1, 96,      1, offsetof(GatewayConfig, cycleWaits)},
+    {"ub", 0, 3600,    2, offsetof(GatewayConfig, uploadBudgetS)},
+    {"bs", 0, 1000,    2, offsetof(GatewayConfig, batchRows)},
+    {"pp", 0, 1,       1, offsetof(GatewayConfig, powerPolicy)},
+    {"ag", 0, 604800,  4, offsetof(GatewayConfig, aggIntervalS)},
+    {"tr", 0, 3,       1, offsetof(GatewayConfig, transport)},
+    {"rl", 0, 3600,    2, offsetof(GatewayConfig, ratePeriodS)},
+};
+
+static void setField(GatewayConfig& c, const ConfigKey& k, uint32_t v) {
+    uint8_t* p = (uint8_t*)&c + k.offset;
+    if (k.size == 1)      *p = (uint8_t)v;
+    else if (k.size == 2) *(uint16_t*)p = (uint16_t)v;
+    else                  *(uint32_t*)p = v;
+}
+
+static uint32_t getField(const GatewayConfig& c, const ConfigKey& k) {
+    const uint8_t* p = (const uint8_t*)&c + k.offset;
+    if (k.size == 1) return *p;
+    if (k.size == 2) return *(const uint16_t*)p;
+    return *(const uint32_t*)p;
+}
+
+static bool apnValid(const char* s, size_t n) {
+    if (!n || n >= CONFIG_APN_MAX) return false;
+    for (size_t i = 0; i < n; ++i) {
+        char ch = s[i];
+        if (!(isalnum((unsigned char)ch) || ch == '.' || ch == '-' || ch == '_')) return false;
+    }
+    return true;
+}
+
+bool configParse(const char* blob, GatewayConfig& out) {
+    while (*blob == ' ') ++blob;
+    if (strncmp(blob, "v1", 2) || (blob[2] && blob[2] != ';')) return false;
+
+    GatewayConfig c = out;
+    const char* p = blob + 2;
+    while (*p == ';') {
+        ++p;
+        const char* eq = strchr(p, '=');
+        const char* end = strchr(p, ';');
+        if (!end) end = p + strlen(p);
+        while (end > p && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) --end;
+        if (!eq || eq > end) return false;
+        size_t klen = eq - p;
+        const char* val = eq + 1;
+        size_t vlen = end - val;
+
+        if (klen == 3 && !strncmp(p, "apn", 3)) {
+            if (!apnValid(val, vlen)) return false;
+            memcpy(c.apn, val, vlen);
+            c.apn[vlen] = '\0';
+        } else {
+            const ConfigKey* k = nullptr;
+            for (const ConfigKey& kk : KEYS)
+                if (strlen(kk.name) == klen && !strncmp(p, kk.name, klen)) k = &kk;
+            if (!k || !vlen) return false;
+
+            uint32_t v = 0;
+            for (size_t i = 0; i < vlen; ++i) {
+                if (val[i] < '0' || val[i] > '9' || v > 429496728) return false;
+                v = v * 10 + (val[i] - '0');
+            }
+            if (v < k->lo || v > k->hi) return false;
+            setField(c, *k, v);
+        }
+        p = end;
+        while (*p == '\r' || *p == '\n' || *p == ' ') ++p;
+    }
+    if (*p) return false;
+
+    out = c;
+    return true;
+}
+
+bool configFormat(const GatewayConfig& c, TextBuf& out) {
+    out.add("v1");
+    for (const ConfigKey& k : KEYS)
+        out.add(';').add(k.name).add('=').addUint(getField(c, k));
+    out.add(";apn=").add(c.apn);
+    return out.ok;
+}
+
+bool configLoad() {
+    EnergyScope es(EN_SD);
+    if (!sdInit()) return false;
+    StoreFile f = storeOpen(CONFIG_FILE, ST_READ);
+    if (!f) return false;
+
+    char line[CONFIG_BLOB_MAX + RECORD_OVERHEAD], *blob;
+    LineReader<StoreFile> lines(f);
+    bool ok = lines.next(line, sizeof(line)) > 0 && recordCheck(line, &blob) == REC_OK &&
+              configParse(blob, config);
+    f.close();
+    if (!ok) LOG_WARN("%s invalid, defaults kept", CONFIG_FILE);
+    return ok;
+}
+
+bool configSave() {
+    EnergyScope es(EN_SD);
+    char blob[CONFIG_BLOB_MAX], line[CONFIG_BLOB_MAX + RECORD_OVERHEAD];
+    TextBuf tb(blob, sizeof(blob));
+    if (!configFormat(config, tb) || !recordFrame(blob, line, sizeof(line))) return false;
+    if (!sdInit()) return false;
+
+    StoreFile f = storeOpen(CONFIG_FILE, ST_TRUNC);
+    if (!f) return false;
+    f.println(line);
+    f.close();
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifdef ARDUINO_ARCH_SAMD
+#include <Arduino.h>
+#include "dmac.h"
+
+static DmaDesc table[DMA_CH_COUNT] __attribute__((aligned(16)));
+static volatile DmaDesc writeback[DMA_CH_COUNT] __attribute__((aligned(16)));
+static DmaDoneFn doneFn[DMA_CH_COUNT];
+static bool      started = false;
+
+/* Keeps interrupts off for a scope and restores the previous state,
+ * so these calls nest inside the callers' own critical sections and
+ * work from the DMAC callbacks */
+struct IrqLock {
+    uint32_t primask;
+    IrqLock() : primask(__get_PRIMASK()) { __disable_irq(); }
+    ~IrqLock() { __set_PRIMASK(primask); }
+};
+
+void dmacBegin() {
+    if (started) return;
+    PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+    PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+
+    DMAC->CTRL.reg &= ~DMAC_CTRL_DMAENABLE;
+    DMAC->CTRL.reg = DMAC_CTRL_SWRST;
+    while (DMAC->CTRL.reg & DMAC_CTRL_SWRST);
+    DMAC->BASEADDR.reg = (uint32_t)table;
+    DMAC->WRBADDR.reg  = (uint32_t)writeback;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+
+    NVIC_SetPriority(DMAC_IRQn, 1);
+    NVIC_EnableIRQ(DMAC_IRQn);
+    started = true;
+}
+
+/* CHID selects the channel the CH* registers refer to; the handler
+ * puts it back so a main-line access is never redirected */
+static void select(uint8_t ch) {
+    DMAC->CHID.reg = DMAC_CHID_ID(ch);
+}
+
+void dmacStop(uint8_t ch) {
+    IrqLock lock;
+    select(ch);
+    DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_ENABLE);
+    DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_MASK;
+}
+
+void dmacStart(uint8_t ch, const DmaDesc& desc, uint8_t trigger, bool loop, DmaDoneFn done) {
+    IrqLock lock;
+    dmacStop(ch);
+    table[ch] = desc;
+    if (loop) table[ch].descaddr = (uint32_t)&table[ch];
+    doneFn[ch] = done;
+
+    select(ch);
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+    while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_SWRST);
+    DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(trigger) |
+                        DMAC_CHCTRLB_TRIGACT_BEAT;
+    DMAC->CHINTENCLR.reg = DMAC_CHINTENCLR_MASK;
+    if (done) DMAC->CHINTENSET.reg = DMAC_CHINTENSET_TCMPL;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+}
+
+bool dmacBusy(uint8_t ch) {
+    IrqLock lock;
+    select(ch);
+    return DMAC->CHCTRLA.reg & DMAC_CHCTRLA_ENABLE;
+}
+
+/* The channel being served reports its live count in ACTIVE; the
+ * others have theirs in the write-back entry, updated each time the
+ * arbiter moves on (after every beat, at this trigger rate). */
+uint16_t dmacRemaining(uint8_t ch) {
+    DMAC_ACTIVE_Type a;
+    a.reg = DMAC->ACTIVE.reg;
+    if (a.bit.ABUSY && a.bit.ID == ch) return a.bit.BTCNT;
+    return writeback[ch].btcnt;
+}
+
+void DMAC_Handler() {
+    uint8_t keep = DMAC->CHID.reg;
+    uint8_t ch = DMAC->INTPEND.bit.ID;
+    select(ch);
+    uint8_t flags = DMAC->CHINTFLAG.reg;
+    DMAC->CHINTFLAG.reg = flags;
+    if ((flags & DMAC_CHINTFLAG_TCMPL) && ch < DMA_CH_COUNT && doneFn[ch]) doneFn[ch]();
+    DMAC->CHID.reg = keep;                      // the callback may have selected another
+}
+#endif
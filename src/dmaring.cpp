@@ -0,0 +1,82 @@
+#include <string.h>
+#include "dmaring.h"
+
+DmaDesc dmaDescToPeriph(const void* src, uint16_t n, uint32_t periphReg) {
+    DmaDesc d;
+    d.btctrl   = DMA_BT_VALID | DMA_BT_BLOCKINT | DMA_BT_BEAT8 | DMA_BT_SRCINC;
+    d.btcnt    = n;
+    d.srcaddr  = (uint32_t)(uintptr_t)src + n;
+    d.dstaddr  = periphReg;
+    d.descaddr = 0;
+    return d;
+}
+
+DmaDesc dmaDescFromPeriph(uint32_t periphReg, void* dst, uint16_t n) {
+    DmaDesc d;
+    d.btctrl   = DMA_BT_VALID | DMA_BT_BLOCKINT | DMA_BT_BEAT8 | DMA_BT_DSTINC;
+    d.btcnt    = n;
+    d.srcaddr  = periphReg;
+    d.dstaddr  = (uint32_t)(uintptr_t)dst + n;
+    d.descaddr = 0;
+    return d;
+}
+
+DmaDesc dmaDescFill(const uint8_t* byte, uint16_t n, uint32_t periphReg) {
+    DmaDesc d = dmaDescToPeriph(byte, n, periphReg);
+    d.btctrl &= ~DMA_BT_SRCINC;
+    d.srcaddr = (uint32_t)(uintptr_t)byte;
+    return d;
+}
+
+DmaDesc dmaDescDrain(uint32_t periphReg, uint8_t* sink, uint16_t n) {
+    DmaDesc d = dmaDescFromPeriph(periphReg, sink, n);
+    d.btctrl &= ~DMA_BT_DSTINC;
+    d.dstaddr = (uint32_t)(uintptr_t)sink;
+    return d;
+}
+
+DmaRxRing::DmaRxRing(uint8_t* b, uint16_t n) : buf(b), size(n) {
+    reset();
+}
+
+void DmaRxRing::reset() {
+    written = taken = lost = 0;
+}
+
+/* left == 0 (block just ended, lap not counted yet) and left == size
+ * (next lap started and counted) give the same total. The other
+ * order, block reloaded but the interrupt not yet run, reads as a
+ * step back by one lap and is ignored until the count catches up. */
+void DmaRxRing::sync(uint32_t laps, uint16_t left) {
+    if (left > size) return;
+    uint32_t w = laps * size + (size - left);
+    if ((int32_t)(w - written) <= 0) return;
+    written = w;
+    if (written - taken > size) {
+        lost += written - taken - size;
+        taken = written - size;
+    }
+}
+
+int DmaRxRing::peek() const {
+    return written == taken ? -1 : buf[taken % size];
+}
+
+int DmaRxRing::read() {
+    if (written == taken) return -1;
+    return buf[taken++ % size];
+}
+
+size_t DmaRxRing::read(uint8_t* out, size_t n) {
+    size_t got = 0;
+    while (got < n && written != taken) {
+        uint16_t at = taken % size;
+        size_t run = size - at;                     // up to the end of the buffer
+        if (run > written - taken) run = written - taken;
+        if (run > n - got) run = n - got;
+        memcpy(out + got, buf + at, run);
+        got += run;
+        taken += run;
+    }
+    return got;
+}
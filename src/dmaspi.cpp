@@ -0,0 +1,78 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "dmaspi.h"
+
+#if defined(ARDUINO_ARCH_SAMD) && SPI_DRIVER_SELECT == 3
+#include "dmac.h"
+
+static const uint8_t ONES = 0xFF;           // clocked out while reading
+static uint8_t       sink;                  // bytes read back while writing
+
+void DmaSpi::begin(SdSpiConfig config) {
+    dmacBegin();
+    sck = config.maxSck;
+    SPI.begin();
+}
+
+void DmaSpi::activate() {
+    SPI.beginTransaction(SPISettings(sck, MSBFIRST, SPI_MODE0));
+}
+
+void DmaSpi::deactivate() {
+    SPI.endTransaction();
+}
+
+void DmaSpi::end() {
+    SPI.end();
+}
+
+void DmaSpi::setSckSpeed(uint32_t maxSck) {
+    sck = maxSck;
+}
+
+uint8_t DmaSpi::receive() {
+    return SPI.transfer(0xFF);
+}
+
+void DmaSpi::send(uint8_t b) {
+    SPI.transfer(b);
+}
+
+/* RX is armed first so no byte TX clocks in is missed; RX finishing
+ * means the last byte has been shifted both ways. */
+void DmaSpi::run(const uint8_t* tx, uint8_t* rx, uint16_t n) {
+    uint32_t data = (uint32_t)&SERCOM4->SPI.DATA.reg;      // board SPI
+    dmacStart(DMA_CH_SD_RX, rx ? dmaDescFromPeriph(data, rx, n) : dmaDescDrain(data, &sink, n),
+              SERCOM4_DMAC_ID_RX, false);
+    dmacStart(DMA_CH_SD_TX, tx ? dmaDescToPeriph(tx, n, data) : dmaDescFill(&ONES, n, data),
+              SERCOM4_DMAC_ID_TX, false);
+    while (dmacBusy(DMA_CH_SD_RX));
+}
+
+uint8_t DmaSpi::receive(uint8_t* buf, size_t n) {
+    if (n < DMASPI_MIN_BYTES) {
+        for (size_t i = 0; i < n; ++i) buf[i] = SPI.transfer(0xFF);
+        return 0;
+    }
+    while (n) {
+        uint16_t k = n > 0xFFFF ? 0xFFFF : n;
+        run(nullptr, buf, k);
+        buf += k;
+        n -= k;
+    }
+    return 0;
+}
+
+void DmaSpi::send(const uint8_t* buf, size_t n) {
+    if (n < DMASPI_MIN_BYTES) {
+        for (size_t i = 0; i < n; ++i) SPI.transfer(buf[i]);
+        return;
+    }
+    while (n) {
+        uint16_t k = n > 0xFFFF ? 0xFFFF : n;
+        run(buf, nullptr, k);
+        buf += k;
+        n -= k;
+    }
+}
+#endif
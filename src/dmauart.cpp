@@ -0,0 +1,131 @@
+#ifdef ARDUINO_ARCH_SAMD
+#include <Arduino.h>
+#include "wiring_private.h"
+#include "dmac.h"
+#include "dmauart.h"
+
+DmaUart* DmaUart::self = nullptr;
+
+DmaUart::DmaUart(SERCOM* s, Sercom* r, uint8_t rxTrig, uint8_t txTrig,
+                 uint8_t rxP, uint8_t txP, SercomRXPad rxPd, SercomUartTXPad txPd)
+    : sercom(s), regs(r), rxTrigger(rxTrig), txTrigger(txTrig), rxPin(rxP), txPin(txP),
+      rxPad(rxPd), txPad(txPd), rx(rxBuf, sizeof(rxBuf)), laps(0), txFill(0), txBusy(false),
+      txSent(false) {
+    txLen[0] = txLen[1] = 0;
+    self = this;
+}
+
+void DmaUart::begin(unsigned long baud) {
+    begin(baud, SERIAL_8N1);
+}
+
+/* Also used to change baud: the SERCOM and both channels start over */
+void DmaUart::begin(unsigned long baud, uint16_t) {
+    dmacBegin();
+    end();
+    pinPeripheral(rxPin, g_APinDescription[rxPin].ulPinType);
+    pinPeripheral(txPin, g_APinDescription[txPin].ulPinType);
+
+    sercom->initUART(UART_INT_CLOCK, SAMPLE_RATE_x16, baud);
+    sercom->initFrame(UART_CHAR_SIZE_8_BITS, LSB_FIRST, SERCOM_NO_PARITY, SERCOM_STOP_BIT_1);
+    sercom->initPads(txPad, rxPad);
+    regs->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_MASK;    // no per-byte interrupt
+    sercom->enableUART();
+
+    laps = 0;
+    rx.reset();
+    dmacStart(DMA_CH_MODEM_RX,
+              dmaDescFromPeriph((uint32_t)&regs->USART.DATA.reg, rxBuf, sizeof(rxBuf)),
+              rxTrigger, true, rxLap);
+}
+
+void DmaUart::end() {
+    dmacStop(DMA_CH_MODEM_RX);
+    dmacStop(DMA_CH_MODEM_TX);
+    noInterrupts();
+    txBusy = txSent = false;
+    txLen[0] = txLen[1] = 0;
+    interrupts();
+    sercom->resetUART();
+}
+
+void DmaUart::rxLap() {
+    self->laps++;
+}
+
+/* Read the lap count on both sides of BTCNT so the pair belongs to
+ * the same lap */
+void DmaUart::rxSync() {
+    uint32_t l;
+    uint16_t left;
+    do {
+        l = laps;
+        left = dmacRemaining(DMA_CH_MODEM_RX);
+    } while (l != laps);
+    rx.sync(l, left);
+}
+
+int DmaUart::available() {
+    rxSync();
+    return rx.available();
+}
+
+int DmaUart::peek() {
+    rxSync();
+    return rx.peek();
+}
+
+int DmaUart::read() {
+    if (!rx.available()) rxSync();
+    return rx.read();
+}
+
+size_t DmaUart::read(uint8_t* out, size_t n) {
+    rxSync();
+    return rx.read(out, n);
+}
+
+/* Put the filled buffer on the air and switch to the other one */
+void DmaUart::txKick() {
+    uint8_t b = txFill;
+    if (txBusy || !txLen[b]) return;
+    regs->USART.INTFLAG.reg = SERCOM_USART_INTFLAG_TXC;
+    dmacStart(DMA_CH_MODEM_TX,
+              dmaDescToPeriph(txBuf[b], txLen[b], (uint32_t)&regs->USART.DATA.reg),
+              txTrigger, false, txDone);
+    txBusy = true;
+    txSent = true;
+    txFill = b ^ 1;
+    txLen[txFill] = 0;
+}
+
+void DmaUart::txDone() {
+    self->txBusy = false;
+    self->txKick();                             // whatever was queued meanwhile
+}
+
+size_t DmaUart::write(const uint8_t* p, size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        noInterrupts();
+        uint8_t b = txFill;
+        size_t take = DMAUART_TX_BYTES - txLen[b];
+        if (take > n - done) take = n - done;
+        memcpy(txBuf[b] + txLen[b], p + done, take);
+        txLen[b] += take;
+        done += take;
+        txKick();
+        interrupts();
+        /* both buffers full: wait for the block on the air */
+        while (done < n && txLen[txFill] == DMAUART_TX_BYTES);
+    }
+    return n;
+}
+
+void DmaUart::flush() {
+    if (!txSent) return;                        // TXC only rises after a transfer
+    while (txBusy || txLen[txFill]);
+    while (!(regs->USART.INTFLAG.reg & SERCOM_USART_INTFLAG_TXC));
+    txSent = false;
+}
+#endif
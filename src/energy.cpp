@@ -0,0 +1,154 @@
+#include <Arduino.h>
+#include "energy.h"
+#include "storage.h"
+
+bool sdInit();                              // jacob-main.cpp
+
+/* --- DEFAULT CURRENT DRAW (µA) --- */
+uint32_t energyCurrent_uA[EN_COUNT] = {
+    12000,      // EN_AWAKE  : SAMD21 @48 MHz + board regulators
+    110000,     // EN_LTE    : SIM7600 registering / attaching
+    180000,     // EN_UPLOAD : SIM7600 transmitting
+    35000,      // EN_SAMPLE : relay + EnviroPro probe
+    60000,      // EN_GPS    : SIM7600 with GNSS engine on
+    30000,      // EN_SD     : card active
+    8000        // EN_SLEEP  : modem idle, MCU waiting
+};
+
+static const char ENERGY_FILE[]     = "ENERGY.BIN";
+static const uint32_t ENERGY_MAGIC  = 0x31524E45;   // "ENR1"
+static const uint16_t ENERGY_SLOTS  = 256;          // ~10 KB on card
+
+static const uint8_t STACK_DEPTH = 8;
+static EnergyState stack[STACK_DEPTH];
+static uint8_t     depth = 0;
+static uint32_t    lastMark = 0;
+static EnergyRecord cur{};
+static EnergyRecord last{};
+static bool        haveLast = false;
+static uint32_t    nextSeq = 0;
+
+/* --- RING HEADER ON SD --- */
+struct EnergyRingHdr {
+    uint32_t magic;
+    uint16_t head;      // next slot to write
+    uint16_t count;     // valid slots
+    uint32_t seq;       // next cycle number
+};
+
+/* Charge time since the last mark to whatever state is on top; past
+ * STACK_DEPTH that is the deepest one recorded */
+static void charge() {
+    uint32_t now = millis();
+    uint8_t d = depth < STACK_DEPTH ? depth : STACK_DEPTH;
+    EnergyState top = d ? stack[d - 1] : EN_AWAKE;
+    cur.ms[top] += now - lastMark;
+    lastMark = now;
+}
+
+static bool readHdr(StoreFile& f, EnergyRingHdr& h) {
+    f.seek(0);
+    if (f.read(&h, sizeof(h)) != sizeof(h) || h.magic != ENERGY_MAGIC
+        || h.head >= ENERGY_SLOTS || h.count > ENERGY_SLOTS) {
+        h = EnergyRingHdr{ENERGY_MAGIC, 0, 0, 0};
+        return false;
+    }
+    return true;
+}
+
+static void logRecord(EnergyRecord& r) {
+    if (!sdInit()) return;
+
+    // ST_APPEND would force every write to the end; the ring needs random access
+    StoreFile f = storeOpen(ENERGY_FILE, ST_RW);
+    if (!f) return;
+
+    EnergyRingHdr h;
+    if (readHdr(f, h)) r.seq = h.seq;       // card numbering wins across reboots
+    h.seq = r.seq + 1;
+    nextSeq = h.seq;
+
+    f.seek(sizeof(h) + (uint32_t)h.head * sizeof(EnergyRecord));
+    f.write(&r, sizeof(r));
+
+    h.head = (h.head + 1) % ENERGY_SLOTS;
+    if (h.count < ENERGY_SLOTS) h.count++;
+    f.seek(0);
+    f.write(&h, sizeof(h));
+    f.close();
+}
+
+/* ======================================================== */
+void energyBegin() {
+    depth = 0;
+    cur = EnergyRecord{};
+    lastMark = millis();
+}
+
+void energySetCurrent(EnergyState s, uint32_t uA) {
+    if (s < EN_COUNT) energyCurrent_uA[s] = uA;
+}
+
+void energyEnter(EnergyState s) {
+    charge();
+    if (depth < STACK_DEPTH) stack[depth] = s;
+    depth++;                                // still counted when too deep, so exits balance
+}
+
+void energyExit() {
+    charge();
+    if (depth) depth--;
+}
+
+uint32_t energyCycleEnd() {
+    charge();
+
+    /* µA·ms → µAh : divide by 3 600 000 */
+    uint64_t uAms = 0;
+    for (uint8_t i = 0; i < EN_COUNT; ++i)
+        uAms += (uint64_t)cur.ms[i] * energyCurrent_uA[i];
+    cur.uAh = (uint32_t)(uAms / 3600000ULL);
+    cur.seq = nextSeq++;
+
+    logRecord(cur);
+    last = cur;
+    haveLast = true;
+
+    // Open scopes carry over into the next cycle
+    uint32_t uAh = cur.uAh;
+    cur = EnergyRecord{};
+    lastMark = millis();
+    return uAh;
+}
+
+const EnergyRecord& energyLastCycle() {
+    return last;
+}
+
+/* --- ThingSpeak status text: total charge plus seconds per state (URL-safe) ---
+ * Fields that do not fit are left off whole, so a %20 is never cut */
+bool energyStatus(char* out, size_t len) {
+    static const char* const NAMES[EN_COUNT] = {
+        "CPU", "LTE", "UPL", "SMP", "GPS", "SD", "SLP"
+    };
+    if (!haveLast || !len) return false;
+
+    char field[24];
+    size_t n = 0;
+    out[0] = '\0';
+    for (int i = -1; i < EN_COUNT; ++i) {
+        int k;
+        if (i < 0)
+            k = snprintf(field, sizeof(field), "E=%lu.%03lumAh",
+                         (unsigned long)(last.uAh / 1000), (unsigned long)(last.uAh % 1000));
+        else if (last.ms[i])
+            k = snprintf(field, sizeof(field), "%%20%s=%lus", NAMES[i],
+                         (unsigned long)(last.ms[i] / 1000));
+        else
+            continue;
+        if (k < 0 || (size_t)k >= sizeof(field) || n + k >= len) break;
+        memcpy(out + n, field, k + 1);
+        n += k;
+    }
+    return true;
+}
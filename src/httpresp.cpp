@@ -0,0 +1,165 @@
+#include <string.h>
+#include "httpresp.h"
+
+/* ======================================================== */
+/* |---------------------- IpdDemux ----------------------| */
+/* ======================================================== */
+void IpdDemux::reset() {
+    st = TEXT;
+    remain = 0;
+    n = 0;
+    buf[0] = '\0';
+}
+
+IpdDemux::Kind IpdDemux::feed(uint8_t b, uint8_t* out) {
+    switch (st) {
+    case TEXT:
+        if (b == '>' && n == 0) return PROMPT;
+        if (b == '\r') return NONE;
+        if (b == '\n') {
+            if (!n) return NONE;
+            buf[n] = '\0';
+            n = 0;
+            return LINE;
+        }
+        if (n < IPD_LINE_MAX - 1) buf[n++] = (char)b;
+        if (n == preLen && !memcmp(buf, pre, preLen)) { st = LEN; remain = 0; n = 0; }
+        return NONE;
+
+    case LEN:
+        if (b >= '0' && b <= '9' && remain < 100000) { remain = remain * 10 + (b - '0'); return NONE; }
+        if (b == '\r') { st = LEN_LF; return NONE; }
+        st = TEXT;                                  // not a header after all
+        return NONE;
+
+    case LEN_LF:
+        st = (b == '\n' && remain) ? DATA : TEXT;
+        return NONE;
+
+    case DATA:
+        *out = b;
+        if (--remain == 0) st = TEXT;
+        return PAYLOAD;
+    }
+    return NONE;
+}
+
+/* ======================================================== */
+/* |-------------------- HttpResponse --------------------| */
+/* ======================================================== */
+void HttpResponse::reset() {
+    st = STATUS;
+    code = 0;
+    chunked = connClose = haveLen = false;
+    remain = 0;
+    n = 0;
+    bodyLen = 0;
+    bodyBuf[0] = '\0';
+}
+
+static bool startsWithNoCase(const char* s, const char* prefix) {
+    for (; *prefix; ++s, ++prefix) {
+        char a = *s, b = *prefix;
+        if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+        if (a != b) return false;
+    }
+    return true;
+}
+
+static const char* skipSpaces(const char* s) {
+    while (*s == ' ' || *s == '\t') ++s;
+    return s;
+}
+
+void HttpResponse::header() {
+    if (startsWithNoCase(lineBuf, "content-length:")) {
+        remain = 0;
+        for (const char* p = skipSpaces(lineBuf + 15); *p >= '0' && *p <= '9'; ++p)
+            remain = remain * 10 + (*p - '0');
+        haveLen = true;
+    } else if (startsWithNoCase(lineBuf, "transfer-encoding:")) {
+        chunked = startsWithNoCase(skipSpaces(lineBuf + 18), "chunked");
+    } else if (startsWithNoCase(lineBuf, "connection:")) {
+        connClose = startsWithNoCase(skipSpaces(lineBuf + 11), "close");
+    }
+}
+
+void HttpResponse::keep(uint8_t b) {
+    if (bodyLen < HTTP_BODY_MAX - 1) {
+        bodyBuf[bodyLen++] = (char)b;
+        bodyBuf[bodyLen] = '\0';
+    }
+}
+
+bool HttpResponse::feed(uint8_t b) {
+    /* line-oriented states collect into lineBuf first */
+    if (st == STATUS || st == HEADER || st == CHUNK_SIZE || st == CHUNK_END || st == TRAILER) {
+        if (b == '\r') return false;
+        if (b != '\n') {
+            if (n < sizeof(lineBuf) - 1) lineBuf[n++] = (char)b;
+            return false;
+        }
+        lineBuf[n] = '\0';
+        uint8_t len = n;
+        n = 0;
+
+        switch (st) {
+        case STATUS:                            // "HTTP/1.1 200 OK"
+            if (!len) return false;             // stray CRLF between responses
+            if (strncmp(lineBuf, "HTTP/", 5)) return false;
+            {
+                const char* p = strchr(lineBuf, ' ');
+                code = 0;
+                if (p) for (++p; *p >= '0' && *p <= '9'; ++p) code = code * 10 + (*p - '0');
+            }
+            st = HEADER;
+            return false;
+
+        case HEADER:
+            if (len) { header(); return false; }
+            if (chunked) { st = CHUNK_SIZE; return false; }
+            if (haveLen && remain) { st = BODY; return false; }
+            st = DONE;                          // no body (or Content-Length: 0)
+            return true;
+
+        case CHUNK_SIZE: {
+            remain = 0;
+            for (const char* p = lineBuf; ; ++p) {
+                char c = *p;
+                int v = (c >= '0' && c <= '9') ? c - '0'
+                      : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                      : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+                if (v < 0) break;
+                remain = (remain << 4) | (uint32_t)v;
+            }
+            st = remain ? CHUNK_DATA : TRAILER;
+            return false;
+        }
+
+        case CHUNK_END:                         // CRLF after chunk data
+            st = CHUNK_SIZE;
+            return false;
+
+        case TRAILER:
+            if (len) return false;
+            st = DONE;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    switch (st) {
+    case BODY:
+        keep(b);
+        if (--remain == 0) { st = DONE; return true; }
+        return false;
+    case CHUNK_DATA:
+        keep(b);
+        if (--remain == 0) st = CHUNK_END;
+        return false;
+    default:
+        return false;                           // DONE: caller resets first
+    }
+}
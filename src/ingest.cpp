@@ -0,0 +1,70 @@
+#include <string.h>
+#include "ingest.h"
+
+Ingest::Ingest(const IngestType* types, uint8_t n)
+    : table(types), nTypes(n > INGEST_TYPES_MAX ? INGEST_TYPES_MAX : n),
+      cur(-1), assembling(false) {
+    clear();
+}
+
+void Ingest::clear() {
+    for (uint8_t i = 0; i < INGEST_TYPES_MAX; ++i) {
+        slot[i].len = 0;
+        slot[i].done = false;
+        slot[i].buf[0] = '\0';
+    }
+    cur = -1;
+    assembling = false;
+}
+
+bool Ingest::ready() const {
+    if (assembling) return false;
+    bool any = false;
+    for (uint8_t i = 0; i < nTypes; ++i) {
+        if (table[i].required && !slot[i].done) return false;
+        any |= slot[i].done;
+    }
+    return any;
+}
+
+bool Ingest::append(const char* p, size_t n) {
+    Slot& s = slot[cur];
+    if (s.len + n >= INGEST_BUF_MAX) return false;
+    memcpy(s.buf + s.len, p, n);
+    s.len += n;
+    s.buf[s.len] = '\0';
+    return true;
+}
+
+IngestEvent Ingest::feed(const char* p, size_t n) {
+    /* 1 ── new block header: "<tag>," ------------------------ */
+    for (uint8_t i = 0; i < nTypes; ++i) {
+        size_t t = strlen(table[i].tag);
+        if (n > t && p[t] == ',' && !memcmp(p, table[i].tag, t)) {
+            cur = i;
+            slot[i].len = 0;
+            slot[i].done = false;
+            slot[i].buf[0] = '\0';
+            assembling = true;
+            if (!append(p + t + 1, n - t - 1)) { assembling = false; return ING_OVERFLOW; }
+            return ING_START;
+        }
+    }
+
+    /* 2 ── continuation of the current block ---------------- */
+    if (!assembling || cur < 0) return ING_IGNORED;
+    if (!append(p, n)) {
+        assembling = false;
+        slot[cur].len = 0;
+        slot[cur].buf[0] = '\0';
+        return ING_OVERFLOW;
+    }
+    if (n >= INGEST_END_LEN) return ING_MORE;
+
+    /* 3 ── short packet: block complete, drop trailing comma -- */
+    Slot& s = slot[cur];
+    if (s.len && s.buf[s.len - 1] == ',') s.buf[--s.len] = '\0';
+    s.done = true;
+    assembling = false;
+    return ING_DONE;
+}
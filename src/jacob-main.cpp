@@ -1,14 +1,47 @@
 #include <Arduino.h>
 #include <SPI.h>
-#include <SD.h>
 #include <RTCZero.h>
 #include <ArduinoLowPower.h>
 #include <algorithm>
 #include <Wire.h>
 #include <secrets.h>
+#include "energy.h"
+#include "log.h"
+#include "memstat.h"
+#include "textproc.h"
+#include "upqueue.h"
+#include "sdlog.h"
+#include "ingest.h"
+#include "aggregate.h"
+#include "sample.h"
+#include "trigger.h"
+#include "config.h"
+#include "talkback.h"
+#include "uplink.h"
+#include "tcpuplink.h"
+#include "mqttuplink.h"
+#include "tlsuplink.h"
+#include "lora.h"
+#include "dmauart.h"
+#include "storage.h"
+#include "nvstore.h"
+#include "watchdog.h"
 
 #define BAUD 115200
-#define DEBUG true
+#ifndef USB_WAIT_MS                 // -D USB_WAIT_MS=5000: give a serial monitor time to attach
+#define USB_WAIT_MS 0
+#endif
+
+/* --- MODEM UART --- */
+#ifndef MODEM_UART_DMA              // -D MODEM_UART_DMA=0: the core's interrupt-driven Serial1
+#ifdef ARDUINO_ARCH_SAMD
+#define MODEM_UART_DMA 1
+#else
+#define MODEM_UART_DMA 0
+#endif
+#endif
+#define MODEM_BAUD_DEFAULT 115200   // SIM7600 factory rate
+#define MODEM_BAUD (MODEM_UART_DMA ? 921600UL : MODEM_BAUD_DEFAULT)
 
 /* --- PINS --- */
 #define LTE_RESET_PIN   6
@@ -18,144 +51,374 @@
 
 #define SLAVE_ADDRESS 0x08
 
+/* --- LORA --- */
+#define LORA_ENABLED true           // RYLR993 ingest from field nodes
+const uint16_t LORA_NODES[] = {2, 3, 4};   // slot order; unknown senders join at the end
+
+/* --- ENERGY --- */
+#define ENERGY_STATUS_UPLOAD true   // send last cycle's estimate as ThingSpeak status
+
 /* --- SENSOR DATA --- */
-String moistBuf = "";
-String tempBuf  = "";
-String curType  = "";
-bool   assembling = false;          // true while a block is still arriving
-bool   processingData = false;      // true while sampleData() is running
+/* EnviroPro record types; row columns follow this order.
+ * A new probe type is one more line here. */
+enum { SENSOR_TEMP, SENSOR_MOIST };
+const IngestType SENSOR_TYPES[] = {
+    {"Temp",  true},
+    {"Moist", true},
+};
+Ingest ingest(SENSOR_TYPES, sizeof(SENSOR_TYPES) / sizeof(SENSOR_TYPES[0]));
+volatile bool processingData = false;   // true while sampleData() is running
+
+/* --- EVENT TRIGGERS --- */
+/* Checked in processChunk() on every finished block; a hit takes an
+ * extra sample during the idle wait. Thresholds are in hundredths. */
+const TriggerRule TRIGGER_RULES[] = {
+    {SENSOR_MOIST, TRIG_DELTA, TRIG_ANY_DEPTH, 300, true},  // irrigation / rain: >3 % step
+    {SENSOR_TEMP,  TRIG_RATE,  0,               50, false}, // surface >0.5 °C per minute
+};
+TriggerEngine triggers(TRIGGER_RULES, sizeof(TRIGGER_RULES) / sizeof(TRIGGER_RULES[0]),
+                       600000);                             // one event per 10 min at most
+volatile int8_t triggerFired = -1;      // rule index waiting for its event sample
 
 
 /* --- CONSTANTS --- */
 /* ---------- THINGSPEAK --------------------------------- */
+#ifndef TALKBACK_URL                // -D TALKBACK_URL=... to point at a test server
+#define TALKBACK_URL "http://api.thingspeak.com/talkbacks/"
+#endif
 const char* TS_API_KEY   = API_WRITE_KEY;
+const char TS_HOST[]      = "api.thingspeak.com";
 const char TS_BASE_URL[]  = "http://api.thingspeak.com/update";
+
+/* ThingSpeak MQTT device: MQTT_CLIENT_ID, MQTT_USERNAME, MQTT_PASSWORD
+ * and TS_CHANNEL_ID in secrets.h; without them tr=2 falls back to HTTP */
+#if defined(MQTT_CLIENT_ID) && defined(MQTT_USERNAME) && defined(MQTT_PASSWORD) && defined(TS_CHANNEL_ID)
+#define MQTT_ENABLED true
+#else
+#define MQTT_ENABLED false
+#endif
+#ifndef MQTT_BROKER                 // -D MQTT_BROKER=... to point at a test broker
+#define MQTT_BROKER "tcp://mqtt3.thingspeak.com:1883"
+#endif
+#ifndef MQTT_QOS                    // 0: ThingSpeak, at most once; 1: PUBACK moves the cursor
+#define MQTT_QOS 0
+#endif
+#ifndef TLS_CA_CERT                 // CA file name on the modem (AT+CCERTDOWN); unset: no server check
+#define TLS_CA_CERT nullptr
+#endif
 const uint8_t TS_MAX_FLD  = 8;
+const uint16_t TS_ROW_BYTES = 128;  // typical stored row, for sizing the backlog in rows
 
 const int PIN_SD_SELECT = 4;
+const uint32_t SD_RETRY_MS = 60000; // mount attempts while the card is missing
+const char RESET_FILE[] = "RESETS.TXT";     // a line per watchdog or software restart
 
 /* --- STATE MACHINE POINTER --- */
 uint8_t state = 0;
 
+/* Progress through state 0, so a reset mid-cycle resumes it */
+enum CycleStep : uint8_t {
+    CY_START = 0,       // energy closed, sample next
+    CY_SAMPLED,         // sample queued, upload next
+};
+uint8_t cycleStep = CY_START;
+uint32_t waitUntil = 0;             // RTC epoch the current idle wait ends; 0: none
+
 /* --- DEEP SLEEP TIME VARIABLES --- */
 uint32_t heartBeatInterval = 3600000; // 1 hour in milliseconds
 uint8_t hoursInDay = 0; // Counter for hours in a day
 
-
-struct GNSS {
-    float latitude;
-    float longitude;
-    float altitude;
+/* --- RTC OBJECT --- */
+RTCZero rtc;                        // synced from the modem clock in timestampNow()
+uint32_t lastSync = 0;              // RTC epoch of the last network time; 0: never
+
+/* --- UPLOAD BUDGET --- */
+uint32_t uploadBudgetMs = 120000;   // airtime per cycle for draining the backlog (config.ub)
+
+/* --- AGGREGATION --- */
+uint32_t aggIntervalMs = 0;         // 0: queue every raw row; else one summary per interval (config.ag)
+bool     aggRawLocal   = true;      // keep raw rows in D<yymmdd>.RAW while aggregating
+uint8_t  aggStatMask   = 0x0F;      // bit per AggStat row to emit (avg, min, max, sd)
+Aggregator agg;
+uint32_t aggStart = 0;
+
+
+GpsFix location{0, 0, 0};          // last known fix
+
+/* --- PERSISTED ACROSS RESETS (nvstore.h) --- */
+struct GatewayState {
+    uint8_t  state;
+    uint8_t  hoursInDay;
+    uint8_t  cycleStep;
+    uint8_t  reserved;
+    uint32_t waitUntil;
+    uint32_t rtcEpoch;              // RTC at the commit: a stand-in for a clock lost to power-off
+    uint32_t lastSync;
+    GpsFix   location;
 };
-GNSS location{0.0, 0.0, 0.0};
+static_assert(sizeof(GatewayState) <= NVSTORE_DATA_MAX, "one NVM page");
+
+/* --- MODEM STATE --- */
+bool modemUp = false;               // answering AT since the last power sequence
+bool modemWarm = false;             // MCU restarted under a powered modem: try to keep it
+bool sampleDue = false;             // this cycle's sample still waits for its blocks
+
+/* --- LAST WATCHDOG / SOFTWARE RESTART ---
+ * Appended to RESETS.TXT once the card mounts and sent once in the
+ * ThingSpeak status, so a hang in the field shows up without USB */
+WdReport lastReset;
+bool resetToLog = false;
+bool resetToSend = false;
+
+const size_t ROW_MAX = 256;         // one TSV row
+const size_t URL_MAX = 512;         // AT+HTTPPARA="URL" command
 
 
 /* --- FUNCTION DECLARATIONS --- */
 void ltePowerSequence();
+bool modemSync();
 void modemOff();
-String sendAT(const String& cmd, uint32_t to = 2000, bool dbg = DEBUG);
+bool modemAdopt();
+String sendAT(const String& cmd, uint32_t to = 2000, bool dbg = true);
 void enableTimeUpdates();
 String getTime();
-bool uploadData(const String& payload);
+void timestampNow(char* date, char* time, char* dayFile);
+void timestampRtc(char* date, char* time, char* dayFile);
+uint32_t rtcSecondsOfDay();
+void idleWait(uint32_t ms);
+UploadResult uploadData(const char* row);
+bool tsUpdatePath(const char* row, TextBuf& out);
+bool tsPublishBody(const char* row, TextBuf& out);
+bool tsBulkItem(const char* row, TextBuf& out);
+long httpReadBody(const String& actionResp, char* out, size_t cap);
+Uplink& activeUplink();
 bool sdInit();
-bool sdHasCsvFiles();
-bool sdUploadChrono();
+void logReset();
+void saveState();
+bool restoreState();
 bool sdDeleteCsv(const char* name);
-void processChunk(const String& data);
-void sampleData();
-String tsvToFieldString(const String &tsvLine);
+void processChunk(const char* data, size_t n);
+bool sampleData(bool event = false);
+void applyConfig();
+bool fetchRemoteConfig();
+void serviceTrigger();
+bool emitSummary(const char* date, const char* time, const char* dayFile);
 void initGPS();
-String getGPSData();
-String parseCoordinates(const String& nmeaLine);
-String getIRTemperatureData();
+bool getGPSData(GpsFix& fix);
+void getIRTemperatureData(Sample& s);
 void clearAllCsvFiles();
 
+/* --- MODEM PORT: SERCOM0, pins 0 (RX) / 1 (TX), same as Serial1 --- */
+#if MODEM_UART_DMA
+DmaUart modemSerial(&sercom0, SERCOM0, SERCOM0_DMAC_ID_RX, SERCOM0_DMAC_ID_TX,
+                    PIN_SERIAL1_RX, PIN_SERIAL1_TX, PAD_SERIAL1_RX, PAD_SERIAL1_TX);
+#else
+Uart& modemSerial = Serial1;
+#endif
+
+/* --- UPLINKS (config.tr picks one) --- */
+RatePacer tsPacer(15000);           // shared by all uplinks: one channel, one limit (config.rl)
+FnUplink  httpUplink(uploadData);                           // TR_AT_HTTP
+TcpUplink tcpUplink(modemSerial, TS_HOST, 80, tsUpdatePath);    // TR_TCP
+TlsUplink tlsUplink(modemSerial, TS_HOST, 443, tsUpdatePath, TLS_CA_CERT);   // TR_TLS
+#if MQTT_ENABLED
+MqttUplink mqttUplink(modemSerial, MQTT_BROKER, MQTT_CLIENT_ID, MQTT_USERNAME, MQTT_PASSWORD,
+                      "channels/" TS_CHANNEL_ID "/publish", tsPublishBody, MQTT_QOS);   // TR_MQTT
+#endif
+#ifdef TS_CHANNEL_ID
+/* Socket uplinks switch to this when the backlog outgrows the budget */
+const BulkFormat TS_BULK = {
+    "/channels/" TS_CHANNEL_ID "/bulk_update.json",
+    "{\"write_api_key\":\"" API_WRITE_KEY "\",\"updates\":[",
+    "]}",
+    tsBulkItem,
+};
+#endif
+
 
 /* ======================================================== */
 /* |----------------------- SETUP ------------------------| */
 /* ======================================================== */
+/* Staged boot: nothing here waits on the modem, the network or a
+ * serial monitor, so the gateway takes blocks again within a fraction
+ * of a second of a reset. The modem and GNSS come up when the first
+ * upload needs them (activeUplink()). */
 void setup(){
+    WdReport wr = wdBegin();
+    memBegin();
+    energyBegin();
     SerialUSB.begin(BAUD);
-    if (DEBUG) while(!SerialUSB);  // wait
-    delay(1000);
-    Serial1.begin(BAUD);
-    while (!Serial1);
-
-    /* --- INITIALIZE LTE PINS --- */
-    pinMode(LTE_RESET_PIN, OUTPUT);
-    pinMode(LTE_PWRKEY_PIN, OUTPUT);
-    pinMode(LTE_FLIGHT_PIN, OUTPUT);
-
-    /* --- INITIALIZE SD CARD --- */
-    if (!sdInit()) {
-        SerialUSB.println(F("SD CARD NOT READY!"));
-        SerialUSB.println(F("Please check the SD card connection."));
-        while (true) {
-            delay(1000);
-            SerialUSB.println(F("Waiting for SD card..."));
-        }   
+#if USB_WAIT_MS
+    for (uint32_t t0 = millis(); !SerialUSB && millis() - t0 < USB_WAIT_MS; ) {}
+#endif
+
+    /* --- WHAT ENDED THE LAST RUN --- */
+    if (wr.cause == RC_WATCHDOG || wr.cause == RC_SOFT) {
+        LOG_WARN("Restart %u after %s reset: %s task, arg %u, %lu ms over budget",
+                 wr.restarts, RC_NAME[wr.cause], WD_TASK_NAME[wr.task], wr.arg,
+                 (unsigned long)wr.overMs);
+        lastReset = wr;
+        resetToLog = resetToSend = true;        // no USB host in the field
+    } else {
+        LOG_INFO("Boot after %s", RC_NAME[wr.cause]);
+    }
+    TRACE(TR_RESET, wr.cause << 8 | wr.task);
+    modemWarm = wr.cause != RC_POWER && wr.cause != RC_BROWNOUT;
+
+    /* --- INITIALIZE RTC: kept across a system or watchdog reset --- */
+    rtc.begin();
+    bool rtcKept = rtc.getYear() >= 25;
+    if (!rtcKept) {
+        rtc.setTime(0, 0, 0);
+        rtc.setDate(1, 1, 25); // 1, 1, 2025 until the modem clock is read
     }
 
+    /* --- RESUME THE INTERRUPTED CYCLE --- */
+    bool resumed = restoreState();
+
     /* --- INITIATE I2C FOR ENVIROPRO --- */
     Wire.begin(SLAVE_ADDRESS);
     Wire.onReceive([](int /*n*/) {
-        String chunk;
-        while (Wire.available())           // read all bytes of this I²C packet
-            chunk += char(Wire.read());
-        processChunk(chunk);               // assemble
+        char chunk[64];
+        size_t n = 0;
+        while (Wire.available() && n < sizeof(chunk))   // one I²C packet (≤32 B)
+            chunk[n++] = char(Wire.read());
+        while (Wire.available()) Wire.read();
+        processChunk(chunk, n);            // assemble
     });
 
-    /* --- INITIALIZE LTE AND GPS --- */
-    ltePowerSequence();
-    delay(2000);  // Wait for LTE module to stabilize
-    initGPS();
+    /* --- RUNTIME CONFIG: defaults, then the last accepted blob --- */
+    configDefaults(config);
+    httpUplink.pace(&tsPacer);
+    tcpUplink.pace(&tsPacer);
+    tlsUplink.pace(&tsPacer);
+#if MQTT_ENABLED
+    mqttUplink.pace(&tsPacer);
+#endif
+
+    /* --- INITIALIZE SD CARD: recovery and config load on mount --- */
+    if (!sdInit()) {
+        LOG_ERROR("SD CARD NOT READY! Rows are kept in RAM until it mounts.");
+        TRACE(TR_SD_FAIL, 0);
+        applyConfig();
+    }
+
+    /* --- LTE PINS; the modem itself stays as it is until needed --- */
+    pinMode(LTE_RESET_PIN, OUTPUT);
+    pinMode(LTE_PWRKEY_PIN, OUTPUT);
+    pinMode(LTE_FLIGHT_PIN, OUTPUT);
+    modemSerial.begin(MODEM_BAUD);
 
-    state = 0;
-    SerialUSB.println("Setup complete!");
+    /* --- INITIALIZE LORA RADIO --- */
+    if (LORA_ENABLED) {
+        if (!loraBegin()) LOG_WARN("LoRa radio not responding");
+        loraSchedBegin(LORA_NODES, sizeof(LORA_NODES) / sizeof(LORA_NODES[0]));
+    }
+
+    if (resumed) {
+        LOG_INFO("Resuming state %u, step %u, wait %u/%u", state, cycleStep,
+                 hoursInDay, config.cycleWaits);
+        if (!rtcKept && lastSync) LOG_WARN("Clock restored from NVM, last network time %lu s before",
+                               (unsigned long)(rtc.getEpoch() - lastSync));
+    }
+    TRACE(TR_BOOT, resumed);
+    memSample();
+    memPhase(MP_IDLE);
+    LOG_INFO("Setup complete!");
 }
 
 /* ======================================================== */
 /* |----------------- MAIN STATE MACHINE -----------------| */
 /* ======================================================== */
 void loop(){
+    wdCheckpoint(WD_LOOP, 10000, state);
+    TRACE(TR_STATE, state);
     switch(state) {
         /* --- GATEWAY AND TRANSMIT --- */
         case 0:
-            if (DEBUG) SerialUSB.println("State 0 - Data Collection and Upload");
-
-            /* --- Upload Data via HTTPS --- */
-            if (sdHasCsvFiles()) {
-                SerialUSB.println(F("Uploading saved data..."));
-                if (sdUploadChrono()) {
-                    SerialUSB.println(F("Data upload successful."));
-                    // Clear all old CSV files after successful upload
-                    clearAllCsvFiles();
-                }
-                else {
-                    SerialUSB.println("Data upload unsuccessful");
+            LOG_DEBUG("State 0 - Data Collection and Upload");
+
+            /* --- Close the previous cycle's energy account --- */
+            if (cycleStep < CY_SAMPLED) {
+                uint32_t uAh = energyCycleEnd();
+                LOG_INFO("Last cycle: %lu uAh", (unsigned long)uAh);
+                (void)uAh;
+                memReport();
+                if (LORA_ENABLED) {
+                    const TdmaStats& ls = loraSchedStats();
+                    LOG_INFO("LoRa: %lu frames, %lu strays, %lu misses, radio on %lu s",
+                             (unsigned long)ls.frames, (unsigned long)ls.strays,
+                             (unsigned long)ls.misses, (unsigned long)(ls.radioOnMs / 1000));
+                    (void)ls;
                 }
             }
-            
-            delay(1000); // Allow time for the sensor to power up
-            
-                    /* --- Sample Data from Sensors --- */
-        sampleData();
 
-        // Ensure processing flag is reset even if sampleData() fails
-        processingData = false;
-        
-        hoursInDay = 0;
-        state = 1;
+            /* --- Sample Data from Sensors; blocks still missing are
+             *     waited for in idleWait() --- */
+            if (cycleStep < CY_SAMPLED) {
+                sampleDue = !sampleData();
+                cycleStep = CY_SAMPLED;
+                saveState();
+            } else LOG_INFO("Cycle resumed after reset, sample already taken");
+
+            // Ensure processing flag is reset even if sampleData() fails
+            processingData = false;
+
+            /* --- Upload newest reading first, then drain history --- */
+            {
+                bool online = false;
+                bool latest = queueHasLatest(), backlog = queueHasBacklog();
+                Uplink* up = (latest || backlog) ? &activeUplink() : nullptr;
+                if (up && up->begin()) {
+                    if (latest) {
+                        online = queueSendLatest(*up) == UP_OK;
+                        if (online) LOG_INFO("Latest reading uploaded.");
+                        else LOG_WARN("Latest reading not uploaded");
+                    }
+                    if (backlog) {
+                        LOG_INFO("Uploading saved data...");
+                        DrainStats ds = queueDrain(*up, uploadBudgetMs, config.batchRows);
+                        LOG_INFO("Backlog: %u sent, %u skipped%s", ds.sent, ds.skipped,
+                                 ds.empty ? ", empty" : "");
+                        online |= ds.sent > 0;
+                    }
+                    up->end();
+                } else if (up) LOG_WARN("Uplink not available");
+
+                /* --- Pick up a config change while the link is known good --- */
+                if (online && fetchRemoteConfig()) LOG_INFO("Remote config applied");
+
+                /* --- GNSS has been acquiring since the modem came up --- */
+                GpsFix fix;
+                if (modemUp && getGPSData(fix)) LOG_DEBUG("GPS fix updated");
+                if (config.powerPolicy == PWR_MODEM_OFF) modemOff();
+            }
+
+            hoursInDay = 0;
+            cycleStep = CY_START;
+            state = 1;
             break;
             
         /* --- WAITING MODE --- */
         case 1:
-            if (DEBUG) SerialUSB.println("State 1 - Waiting Mode");
+            LOG_DEBUG("State 1 - Waiting Mode");
             
-            if ( hoursInDay < 1 ) {
-                delay(15000); // simulate 15 seconds of Low power mode
+            if ( hoursInDay < config.cycleWaits ) {
+                /* a wait cut short by a reset runs on to its old end */
+                uint32_t now = rtc.getEpoch();
+                if (!waitUntil) {
+                    waitUntil = now + config.sampleIntervalS;
+                    saveState();
+                }
+                uint32_t left = waitUntil > now ? waitUntil - now : 0;
+                if (left > config.sampleIntervalS) left = config.sampleIntervalS;  // clock stepped back
+                traceFlush();
+                EnergyScope es(EN_SLEEP);
+                idleWait(left * 1000UL); // Low power wait
+                waitUntil = 0;
                 state = 2;
                 hoursInDay++;
+                saveState();
                 break;
             } else {
                 state = 0;
@@ -166,12 +429,12 @@ void loop(){
             
         /* --- COLLECTION MODE --- */
         case 2:
-            if (DEBUG) SerialUSB.println("State 2 - Collection Mode");
+            LOG_DEBUG("State 2 - Collection Mode");
             state = 1; // Return to low power mode
             break;
             
         default:
-            SerialUSB.println(F("Invalid state!"));
+            LOG_ERROR("Invalid state %u!", state);
             state = 0;
     }
 }
@@ -182,7 +445,21 @@ void loop(){
 /* |--------------- FUNCTION DEFINITIONS -----------------| */
 /* ======================================================== */
 void ltePowerSequence() {
-    if (DEBUG) SerialUSB.println(F(">> LTE Power Sequence Start"));
+    EnergyScope es(EN_LTE);
+    wdCheckpoint(WD_MODEM, 10000);
+    LOG_DEBUG(">> LTE Power Sequence Start");
+    modemUp = false;
+    tlsUplink.drop();           // the reset below ends any session
+#if MQTT_ENABLED
+    mqttUplink.drop();
+#endif
+    if (modemWarm) {
+        modemWarm = false;
+        if (modemAdopt()) {
+            LOG_INFO("Modem kept across the restart");
+            return;
+        }
+    }
 
     // 1. Hard reset module
     digitalWrite(LTE_RESET_PIN, HIGH);
@@ -199,18 +476,16 @@ void ltePowerSequence() {
 
     // 4. Wait and check for modem readiness
     delay(2000);
-    unsigned long start = millis();
-    while (millis() - start < 30000) {  // 30 seconds max wait
-        String resp = sendAT("AT", 1000, false);
-        if (resp.indexOf("OK") != -1) break;
-        delay(1000);
-        if (DEBUG) SerialUSB.println(F("Waiting for modem..."));
+    if (!(modemUp = modemSync())) {
+        LOG_ERROR("Modem not answering");
+        return;
     }
+    initGPS();                  // acquires while the network attaches
 
     // 5. SIM check
     String simStatus = sendAT("AT+CPIN?", 2000);
     if (simStatus.indexOf("READY") == -1) {
-        SerialUSB.println(F("SIM not ready - aborting setup."));
+        LOG_ERROR("SIM not ready - aborting setup.");
         return;
     }
 
@@ -223,14 +498,16 @@ void ltePowerSequence() {
         String reg = sendAT("AT+CREG?", 2000);
         if (reg.indexOf(",1") != -1 || reg.indexOf(",5") != -1) break;  // home/roaming
         delay(2000);
-        if (DEBUG) SerialUSB.println(F("Waiting for network registration..."));
+        LOG_DEBUG("Waiting for network registration...");
     }
 
     // 8. Attach to packet domain
     sendAT("AT+CGATT=1", 2000);
 
     // 9. Define PDP context (APN first!)
-    sendAT("AT+CGDCONT=1,\"IP\",\"fast.t-mobile.com\"", 2000);
+    char pdp[64];
+    snprintf(pdp, sizeof(pdp), "AT+CGDCONT=1,\"IP\",\"%s\"", config.apn);
+    sendAT(pdp, 2000);
 
     // 10. Activate PDP context
     sendAT("AT+CGACT=1,1", 2000);
@@ -238,28 +515,123 @@ void ltePowerSequence() {
     // 11. Verify the PDP address (get IP)
     sendAT("AT+CGPADDR=1", 3000);
 
-    // 12. Enable time synchronization from network
+    // 12. Enable time synchronization from network, then set the RTC
     enableTimeUpdates();
+    char d[11], t[9], f[13];
+    timestampNow(d, t, f);
 
-    if (DEBUG) SerialUSB.println(F("<< LTE Power Sequence Complete"));
+    LOG_DEBUG("<< LTE Power Sequence Complete");
 }
 
 
+/* AT until the modem answers (30 s max). A modem still on its factory
+ * rate is found by trying that too on every other attempt, then moved
+ * up to MODEM_BAUD; the SIM7600 keeps AT+IPR across power cycles. */
+bool modemSync() {
+    unsigned long start = millis();
+    for (uint8_t i = 0; millis() - start < 30000; ++i) {
+        unsigned long baud = (i & 1) ? MODEM_BAUD_DEFAULT : MODEM_BAUD;
+        modemSerial.begin(baud);
+        if (sendAT("AT", 1000, false).indexOf("OK") != -1) {
+            if (baud == MODEM_BAUD) return true;
+            LOG_INFO("Modem at %lu baud, moving it to %lu", baud, (unsigned long)MODEM_BAUD);
+            sendAT("AT+IPR=" + String(MODEM_BAUD), 500);
+            modemSerial.begin(MODEM_BAUD);
+            if (sendAT("AT", 1000, false).indexOf("OK") != -1) return true;
+            continue;
+        }
+        delay(1000);
+        LOG_DEBUG("Waiting for modem...");
+    }
+    modemSerial.begin(MODEM_BAUD);
+    return false;
+}
+
+/* After a warm restart the modem has kept power, registration and
+ * its PDP context. A session left open by the last run is closed
+ * (ERROR when there is none) and the rest is taken over as it is.
+ * False: it needs the full power sequence. */
+bool modemAdopt() {
+    modemSerial.begin(MODEM_BAUD);
+    if (sendAT("AT", 500, false).indexOf("OK") == -1) return false;
+    String ip = sendAT("AT+CGPADDR=1", 1000);
+    int at = ip.indexOf("+CGPADDR: 1,");
+    if (at < 0 || !isdigit(ip[at + 12])) return false;
+
+    sendAT("AT+CIPCLOSE=0", 500, false);
+    sendAT("AT+CCHCLOSE=0", 500, false);
+#if MQTT_ENABLED
+    sendAT("AT+CMQTTDISC=0,60", 500, false);
+    sendAT("AT+CMQTTREL=0", 500, false);
+#endif
+    modemUp = true;
+    initGPS();                  // still on, most likely; ERROR then
+    return true;
+}
+
 void modemOff() {
+#if MODEM_UART_DMA
+    if (modemSerial.overruns()) LOG_WARN("Modem UART: %lu bytes lost", (unsigned long)modemSerial.overruns());
+#endif
     sendAT("AT+CPOF", 1000, false);  // turn off modem
+    modemUp = false;
+    tlsUplink.drop();
+#if MQTT_ENABLED
+    mqttUplink.drop();
+#endif
     digitalWrite(LTE_PWRKEY_PIN, HIGH);
 }
 
+/* --- WAIT, KEEPING THE LORA UART DRAINED --- */
+void idleWait(uint32_t ms) {
+    sdlogFlush();       // nothing left only in RAM while idle
+    uint32_t t0 = millis();
+    while (millis() - t0 < ms) {
+        wdCheckpoint(WD_IDLE, 10000);
+        if (LORA_ENABLED) loraSchedService();
+        serviceTrigger();
+        if (sampleDue && ingest.ready()) {
+            LOG_INFO("Blocks in, taking the cycle's sample");
+            sampleData();
+            processingData = false;
+        }
+        sdlogService();
+        delay(50);
+    }
+}
+
+/* Event sample for a fired trigger rule, taken once every required
+ * block is in. Runs inside the idle wait, so the clock-driven
+ * schedule carries on unchanged afterwards. */
+void serviceTrigger() {
+    int8_t r = triggerFired;
+    if (r < 0 || !ingest.ready()) return;
+
+    LOG_INFO("Trigger %d fired, event sample", r);
+    triggerFired = -1;      // one attempt per event, even if the sample fails
+    sampleData(true);
+    processingData = false;
+
+    if (TRIGGER_RULES[r].upload && queueHasLatest()) {
+        Uplink& up = activeUplink();
+        bool ok = up.begin() && queueSendLatest(up) == UP_OK;
+        up.end();
+        if (ok) LOG_INFO("Event reading uploaded.");
+        else LOG_WARN("Event reading not uploaded");
+    }
+}
+
 /* --- SEND AT COMMAND to 4G LTE MODULE --- */
 String sendAT(const String& cmd, uint32_t to, bool dbg ){
+    wdCheckpoint(WD_MODEM, to + WD_SLACK_MS, to / 1000);
     String resp;
-    Serial1.println(cmd);                           // sends CR/LF automatically
+    modemSerial.println(cmd);                       // sends CR/LF automatically
 
     unsigned long t0 = millis();
     while (millis() - t0 < to) {
-        while (Serial1.available()) resp += (char)Serial1.read();
+        while (modemSerial.available()) resp += (char)modemSerial.read();
     }
-    if (dbg && resp.length()) SerialUSB.print(resp);
+    if (dbg && resp.length()) LOG_DEBUG_RAW(resp.c_str(), resp.length());
     return resp;
 }
 
@@ -272,410 +644,672 @@ String getTime(){
 	int q_index = time.indexOf("\"");
 	time = time.substring(q_index + 1, q_index + 21);
 
-	if (DEBUG) SerialUSB.println("getTime() response:"+time);
+	LOG_DEBUG("getTime() response:%s", time.c_str());
 
 	return time;
 }
 
-String tsvToFieldString(const String &tsvLine)
-{
-  String out;
-  int start = 0, fieldNo = 1;
+/* --- "yy/MM/dd", "hh:mm:ss" and the matching day file "Dyymmdd.CSV" --- */
+static void formatStamp(char* date, char* time, char* dayFile,
+                        uint8_t yr2digit, uint8_t mon, uint8_t day,
+                        uint8_t hr, uint8_t min, uint8_t sec) {
+    snprintf(date, 11, "%02u/%02u/%02u", yr2digit, mon, day);
+    snprintf(time, 9, "%02u:%02u:%02u", hr, min, sec);
+    snprintf(dayFile, 13, "D%02u%02u%02u.CSV", yr2digit, mon, day);  // Use 2-digit year for filename
+}
 
-  while (start < tsvLine.length()) {
-    int end = tsvLine.indexOf('\t', start);    // next TAB
-    if (end == -1) end = tsvLine.length();     // last value
+/* Read the network clock and re-sync the RTC from it */
+void timestampNow(char* date, char* time, char* dayFile) {
+    if (!modemUp) {
+        timestampRtc(date, time, dayFile);      // not worth a modem start
+        return;
+    }
+    String t = getTime();
+    uint8_t yr2digit = t.substring(0,2).toInt();
+    uint8_t mon = t.substring(3,5).toInt();
+    uint8_t day = t.substring(6,8).toInt();
+    uint8_t hr  = t.substring(9,11).toInt();
+    uint8_t min = t.substring(12,14).toInt();
+    uint8_t sec = t.substring(15,17).toInt();
+
+    if (yr2digit < 25 || mon < 1 || mon > 12 || day < 1 || day > 31) {
+        timestampRtc(date, time, dayFile);      // no network time yet (CCLK reads 80/01/06)
+        return;
+    }
+    rtc.setDate(day, mon, yr2digit);
+    rtc.setTime(hr, min, sec);
+    lastSync = rtc.getEpoch();
+    formatStamp(date, time, dayFile, yr2digit, mon, day, hr, min, sec);
+}
 
-    String fieldValue = tsvLine.substring(start, end);
-    
-    // URL encode the field value
-    fieldValue.replace("+", "%2B");  // Encode plus signs
-    fieldValue.replace(" ", "%20");  // Encode spaces
-    
-    out += "field";
-    out += fieldNo++;
-    out += '=';
-    out += fieldValue;
+/* Same format from the RTC alone: no modem round-trip */
+void timestampRtc(char* date, char* time, char* dayFile) {
+    formatStamp(date, time, dayFile, rtc.getYear(), rtc.getMonth(), rtc.getDay(),
+                rtc.getHours(), rtc.getMinutes(), rtc.getSeconds());
+}
 
-    if (end < tsvLine.length()) out += '&';    // no '&' after last field
-    start = end + 1;                           // jump past TAB
-  }
-  return out;
+uint32_t rtcSecondsOfDay() {
+    return rtc.getHours() * 3600UL + rtc.getMinutes() * 60UL + rtc.getSeconds();
 }
 
-bool uploadData(const String& payload) {
-    if (DEBUG) SerialUSB.println("uploadData payload: " + payload);
-    
+/* ---- ThingSpeak fields for one row ------------------------------- */
+/* "field1=…&field2=…", plus the last cycle's energy estimate as status
+ * once per cycle. False: the row would be refused (HTTP 400) or does
+ * not fit, so it is dropped rather than retried. */
+static uint32_t statusSeq = UINT32_MAX;
+
+/* "watchdog,modem,30,1200,3": cause, task, arg, ms over budget, restarts */
+static void resetText(TextBuf& out, char sep) {
+    out.add(RC_NAME[lastReset.cause]).add(sep).add(WD_TASK_NAME[lastReset.task]).add(sep)
+       .addUint(lastReset.arg).add(sep).addUint(lastReset.overMs).add(sep)
+       .addUint(lastReset.restarts);
+}
+
+/* Energy estimate, then "%20RST=..." while a restart is unreported;
+ * that part is left off whole if it does not fit */
+static bool statusText(char* out, size_t cap) {
+    if (!energyStatus(out, cap)) return false;
+    if (resetToSend) {
+        char rst[64];
+        TextBuf tb(rst, sizeof(rst));
+        tb.add("%20RST=");
+        resetText(tb, ',');
+        size_t n = strlen(out);
+        if (tb.ok && n + tb.len < cap) memcpy(out + n, rst, tb.len + 1);
+    }
+    return true;
+}
+
+static void statusSent() {
+    statusSeq = energyLastCycle().seq;
+    resetToSend = false;
+}
+
+static bool tsFields(const char* row, TextBuf& out, bool& withStatus) {
+    withStatus = false;
     // Check for invalid data that would cause HTTP 400
-    if (payload.indexOf("No IR") != -1 || payload.indexOf("25-07-10") != -1) {
-        SerialUSB.println("Skipping invalid data payload");
+    if (strstr(row, "No IR") || strstr(row, "25-07-10")) {
+        LOG_WARN("Skipping invalid data payload");
         return false;
     }
-    
-	bool success = false;
+    tsvToFields(row, out);
+
+    /* ---- Piggy-back the energy estimate once per cycle -------------- */
+    if (ENERGY_STATUS_UPLOAD && statusSeq != energyLastCycle().seq) {
+        char status[128];
+        if (statusText(status, sizeof(status))) {
+            out.add("&status=").add(status);
+            withStatus = true;
+        }
+    }
+    if (!out.ok) LOG_WARN("Row too long for URL buffer");
+    return out.ok;
+}
+
+static bool tsPath(const char* row, TextBuf& out, bool& withStatus) {
+    out.add("/update?api_key=").add(API_WRITE_KEY).add('&');
+    return tsFields(row, out, withStatus);
+}
+
+/* RowFormatFns for the socket uplinks: the reply is only read a
+ * window later, so the status counts as sent once it is on the wire. */
+bool tsUpdatePath(const char* row, TextBuf& out) {
+    bool withStatus;
+    if (!tsPath(row, out, withStatus)) return false;
+    if (withStatus) statusSent();
+    return true;
+}
+
+bool tsPublishBody(const char* row, TextBuf& out) {
+    bool withStatus;
+    if (!tsFields(row, out, withStatus)) return false;
+    if (withStatus) statusSent();
+    return true;
+}
+
+/* Stored rows are already URL-encoded (rowSanitize), JSON wants them plain */
+static void jsonString(TextBuf& out, const char* s, size_t n) {
+    out.add('"');
+    for (size_t i = 0; i < n; ++i) {
+        char c = s[i];
+        if (c == '%' && i + 2 < n && s[i + 1] == '2' && s[i + 2] == '0') { out.add(' '); i += 2; }
+        else if (c == '"' || c == '\\') out.add('\\').add(c);
+        else if ((unsigned char)c >= 0x20) out.add(c);
+    }
+    out.add('"');
+}
+
+/* One bulk_update entry:
+ * {"created_at":"2025-07-11 14:03:00","field1":"25/07/11",…}
+ * The fields are numbered as in tsFields() so the channel sees the
+ * same layout either way; created_at carries the sample time (no
+ * offset: the channel's time zone applies). */
+bool tsBulkItem(const char* row, TextBuf& out) {
+    if (strstr(row, "No IR") || strstr(row, "25-07-10")) {
+        LOG_WARN("Skipping invalid data payload");
+        return false;
+    }
+    const char* tab1 = strchr(row, '\t');
+    const char* tab2 = tab1 ? strchr(tab1 + 1, '\t') : nullptr;
+    if (!tab1 || tab1 - row != 8 || !tab2 || tab2 - tab1 != 9) return false;   // yy/mm/dd, hh:mm:ss
+
+    char stamp[20];
+    snprintf(stamp, sizeof(stamp), "20%.2s-%.2s-%.2s %.8s", row, row + 3, row + 6, tab1 + 1);
+    out.add("{\"created_at\":\"").add(stamp).add('"');
+
+    uint32_t fieldNo = 1;
+    for (const char* p = row; *p && fieldNo <= TS_MAX_FLD; ++fieldNo) {
+        const char* e = strchr(p, '\t');
+        if (!e) e = p + strlen(p);
+        out.add(",\"field").addUint(fieldNo).add("\":");
+        jsonString(out, p, e - p);
+        p = *e ? e + 1 : e;
+    }
+    if (ENERGY_STATUS_UPLOAD && statusSeq != energyLastCycle().seq) {
+        char status[128];
+        if (statusText(status, sizeof(status))) {
+            out.add(",\"status\":");
+            jsonString(out, status, strlen(status));
+            if (out.ok) statusSent();
+        }
+    }
+    out.add('}');
+    if (!out.ok) LOG_WARN("Row too long for bulk entry");
+    return out.ok;
+}
+
+/* Bulk updates once the backlog holds more rows than the pacer lets
+ * out as single updates within the budget */
+static void pickBulk(TcpUplink& up) {
+#ifdef TS_CHANNEL_ID
+    uint32_t rows  = queueBacklogBytes() / TS_ROW_BYTES;
+    uint32_t slots = tsPacer.period() ? uploadBudgetMs / tsPacer.period() : UINT32_MAX;
+    up.bulk(rows > slots ? &TS_BULK : nullptr);
+    if (up.isBulk()) LOG_INFO("Backlog ~%lu rows: bulk update", (unsigned long)rows);
+#else
+    (void)up;
+#endif
+}
+
+Uplink& activeUplink() {
+#if MQTT_ENABLED
+    if (config.transport == TR_MQTT) {
+        /* with the modem left on, the session outlives the drain and
+         * the modem is only reset when it has to reconnect */
+        mqttUplink.keepOpen(config.powerPolicy == PWR_MODEM_ON);
+        if (!mqttUplink.isConnected()) ltePowerSequence();
+        return mqttUplink;
+    }
+#else
+    if (config.transport == TR_MQTT) LOG_WARN("MQTT credentials missing, using HTTP");
+#endif
+    if (config.transport == TR_TLS) {
+        /* a handshake costs seconds of modem time: keep the session
+         * for the next cycle too while the modem stays on */
+        tlsUplink.keepOpen(config.powerPolicy == PWR_MODEM_ON);
+        pickBulk(tlsUplink);
+        if (!tlsUplink.isConnected()) ltePowerSequence();
+        return tlsUplink;
+    }
+    if (config.transport == TR_TCP) {
+        /* the socket path holds one session for the whole drain, so
+         * the modem is brought up once here, not per row */
+        pickBulk(tcpUplink);
+        ltePowerSequence();
+        return tcpUplink;
+    }
+    return httpUplink;
+}
+
+UploadResult uploadData(const char* row) {
+    EnergyScope es(EN_UPLOAD);
+    MemPhaseScope mp(MP_UPLOAD);
+    LOG_DEBUG("uploadData payload: %s", row);
+
+	UploadResult result = UP_FAILED;
+
+	/* ---- Build ThingSpeak URL command ------------------------------ */
+	static char cmd[URL_MAX];
+	TextBuf url(cmd, sizeof(cmd));
+	url.add("AT+HTTPPARA=\"URL\",\"http://").add(TS_HOST);
+	bool sendStatus;
+	if (!tsPath(row, url, sendStatus)) return UP_REJECTED;
+	url.add('"');
+	if (!url.ok) {
+		LOG_WARN("Row too long for URL buffer");
+		return UP_REJECTED;
+	}
 
 	// For some reason, I have only observed consistent success using HTTP
 	// if I reset LTE before every query
 	ltePowerSequence(); 
 
-	/* ---- Build ThingSpeak URL -------------------------------------- */
-	String url = "http://api.thingspeak.com/update?api_key=";
-	url += API_WRITE_KEY;
-    url += "&";
-    url += tsvToFieldString(payload);
-    
-
-	SerialUSB.println("\n[HTTP] » " + url);
+	LOG_DEBUG("[HTTP] » %s", cmd);
 
 	/* ---- One-shot HTTP session ------------------------------------- */
 	if (sendAT("AT+HTTPTERM", 1000).indexOf("ERROR") == -1) {
 		// ignore result – module may reply ERROR if not initialised yet
 	}
 	if (sendAT("AT+HTTPINIT", 5000).indexOf("OK") == -1) {
-		SerialUSB.println(F("HTTPINIT failed – aborting"));
-		return false;
+		LOG_WARN("HTTPINIT failed – aborting");
+		return UP_FAILED;
 	}
     sendAT("AT+HTTPPARA=\"CID\",1");  // Idk if this is necessary
 	sendAT("AT+HTTPPARA=\"CONTENT\",\"application/x-www-form-urlencoded\"", 1000);
-	sendAT("AT+HTTPPARA=\"URL\",\"" + url + "\"", 2000);
+	sendAT(cmd, 2000);
 
-	/* Start HTTP GET (method 0) */
+	/* Start HTTP GET (method 0); the body is the entry id, "0" when
+	 * ThingSpeak dropped the update for coming too soon */
 	String resp = sendAT("AT+HTTPACTION=0", 30000);
-	if (resp.indexOf("+HTTPACTION: 0,200") != -1) {
-		SerialUSB.println(F("Upload OK"));
-		success = true;
+	char entry[16];
+	long n = httpReadBody(resp, entry, sizeof(entry));
+	if (n > 0 && strcmp(entry, "0")) {
+		LOG_INFO("Upload OK");
+		result = UP_OK;
+		if (sendStatus) statusSent();
+	} else if (n > 0) {
+		LOG_WARN("Upload refused: rate limit");
+		tsPacer.backoff(millis());
 	} else {
-		SerialUSB.println("Upload failed");
+		LOG_WARN("Upload failed");
 	}
 	sendAT("AT+HTTPTERM", 1000);
+	TRACE(TR_UPLOAD, result == UP_OK);
 	
-	return success;
+	return result;
 }
 
+/* Body of a 200 answer to AT+HTTPACTION=0 into out (NUL-terminated).
+ * Returns its length (not copied if it does not fit in cap), 0 for an
+ * empty body, -1 for any other status or a failed read. */
+long httpReadBody(const String& actionResp, char* out, size_t cap) {
+    /* +HTTPACTION: 0,200,<len> */
+    int at = actionResp.indexOf("+HTTPACTION: 0,200,");
+    if (at < 0) return -1;
+    long len = actionResp.substring(at + 19).toInt();
+    if (len <= 0 || (size_t)len >= cap) return len;
+
+    /* +HTTPREAD: <n>\r\n<data>\r\n+HTTPREAD: 0 */
+    String body = sendAT("AT+HTTPREAD=0," + String(len), 3000);
+    int s = body.indexOf("+HTTPREAD:");
+    if (s >= 0) s = body.indexOf('\n', s);
+    if (s < 0 || (unsigned)(s + 1 + len) > body.length()) return -1;
+    memcpy(out, body.c_str() + s + 1, len);
+    out[len] = '\0';
+    return len;
+}
 
-/* --- MOUNT SD CARD --- */
-bool sdInit() {
-    static bool ready = false;
-    if (!ready) ready = SD.begin(PIN_SD_SELECT);
-    return ready;
+/* Push the runtime config into the globals that use it */
+void applyConfig() {
+    uploadBudgetMs = config.uploadBudgetS * 1000UL;
+    aggIntervalMs  = config.aggIntervalS * 1000UL;
+    tsPacer.setPeriod(config.ratePeriodS * 1000UL);
+    LOG_INFO("Config: wait %lus x%u, budget %us, batch %u, power %u, agg %lus, tr %u, rl %us, apn %s",
+             (unsigned long)config.sampleIntervalS, config.cycleWaits, config.uploadBudgetS,
+             config.batchRows, config.powerPolicy, (unsigned long)config.aggIntervalS,
+             config.transport, config.ratePeriodS, config.apn);
 }
 
-/* --- CHECK IF CSV FILES EXIST --- */
-bool sdHasCsvFiles() {
-    if (!sdInit()) return false;
-    File r = SD.open("/");
-    while (File f = r.openNextFile()) {
-        if (!f.isDirectory() && String(f.name()).endsWith(".CSV")) {
-            f.close(); r.close(); return true;
-        }
-        f.close();
-    }
-    r.close();
+/* Execute the next TalkBack command; a valid config blob is applied
+ * and persisted (talkback.h). Needs TALKBACK_ID and TALKBACK_KEY in
+ * secrets.h. */
+bool fetchRemoteConfig() {
+#if defined(TALKBACK_ID) && defined(TALKBACK_KEY)
+    EnergyScope es(EN_UPLOAD);
+    char url[160];
+    snprintf(url, sizeof(url), TALKBACK_URL "%s/commands/execute?api_key=%s",
+             TALKBACK_ID, TALKBACK_KEY);
+
+    if (!talkbackFetchConfig(modemSerial, url)) return false;
+    applyConfig();
+    return true;
+#else
     return false;
+#endif
 }
 
-/* --- UPLOAD ALL CSV FILES CHRONOLOGICALLY --- */
-/* ── Upload every *.CSV row-by-row in chronological order ──────────────── */
-bool sdUploadChrono()
-{
-    if (!sdInit()) return false;
-
-    /* 1 ─ collect filenames */
-    String list[32]; uint8_t n = 0;
-    File dir = SD.open("/");
-    while (File f = dir.openNextFile()) {
-        if (!f.isDirectory() && String(f.name()).endsWith(".CSV") && n < 32)
-            list[n++] = String(f.name());
-        f.close();
-    }
-    dir.close();
-    if (!n) return false;
-
-    /* 2 ─ sort alphabetically (lexicographic ≈ chronological) */
-    for (uint8_t i = 0; i < n - 1; ++i)
-        for (uint8_t j = i + 1; j < n; ++j)
-            if (list[j] < list[i]) std::swap(list[i], list[j]);
 
-    /* 3 ─ stream each file row-by-row */
-    for (uint8_t i = 0; i < n; ++i) {
-        File f = SD.open(list[i], FILE_READ);
-        if (!f) continue;
+/* --- SCHEDULER STATE IN NVM ---
+ * Offered at the cycle's steps and around each wait, up to three times
+ * an interval. The flash row takes ~25k erases and the 64-page log
+ * erases a row every 64 commits, so commits are rationed:
+ *  - only a change to the scheduler fields is committed; rtcEpoch is
+ *    left out of the comparison and rides along, refreshed if an hour
+ *    old
+ *  - a burst of STATE_BURST commits, then one per STATE_REFILL_MS.
+ *    A change with no credit waits for the next offer after one is
+ *    earned; a reset in between replays that much of the cycle (a wait
+ *    again, at worst a second sample)
+ * That is at most ~290 commits a day, each row erased ~4.5 times a
+ * day: the flash outlasts the hardware at any sample interval. */
+static const uint8_t  STATE_BURST      = 4;
+static const uint32_t STATE_REFILL_MS  = 300000UL;
+static const uint32_t STATE_EPOCH_MAX_S = 3600;
+
+static GatewayState committed;      // as last committed, rtcEpoch zero
+static uint32_t     committedEpoch = 0;
+static bool         haveCommitted = false;
+
+static GatewayState currentState() {
+    GatewayState gs;
+    memset(&gs, 0, sizeof(gs));     // rtcEpoch stays 0: compared with memcmp
+    gs.state      = state;
+    gs.hoursInDay = hoursInDay;
+    gs.cycleStep  = cycleStep;
+    gs.waitUntil  = waitUntil;
+    gs.lastSync   = lastSync;
+    gs.location   = location;
+    return gs;
+}
 
-        String row = "";
-        while (f.available()) {
-            char c = f.read();
-            if (c == '\n') {                    // got one complete row
-                row.trim();                     // remove CR if any
+void saveState() {
+    static uint8_t  credit = STATE_BURST;
+    static uint32_t refillAt = 0;
+
+    GatewayState gs = currentState();
+    uint32_t now = rtc.getEpoch();
+    bool changed = !haveCommitted || memcmp(&gs, &committed, sizeof(gs));
+    if (!changed && now - committedEpoch < STATE_EPOCH_MAX_S) return;
+
+    uint32_t ms = millis();
+    if (credit < STATE_BURST) {
+        uint32_t earned = (ms - refillAt) / STATE_REFILL_MS;
+        if (earned >= (uint32_t)(STATE_BURST - credit)) credit = STATE_BURST;
+        else credit += earned;
+        refillAt += earned * STATE_REFILL_MS;
+    }
+    if (!credit) return;                        // kept for a later offer
+    if (credit == STATE_BURST) refillAt = ms;
+    credit--;
+
+    committed = gs;
+    gs.rtcEpoch = now;
+    if (!nvstoreCommit(&gs, sizeof(gs))) {
+        LOG_WARN("State not persisted");
+        haveCommitted = false;
+        return;
+    }
+    committedEpoch = now;
+    haveCommitted = true;
+}
 
-                /* skip header or empty lines (contains alpha chars) */
-                if (!row.length()) { continue; }
+/* At boot, before anything runs. An unset RTC takes the last committed
+ * time: stale by the outage, but later than the 2025 default. */
+bool restoreState() {
+    GatewayState gs;
+    if (!nvstoreLoad(&gs, sizeof(gs))) return false;
+    committed = gs;
+    committed.rtcEpoch = 0;
+    committedEpoch = gs.rtcEpoch;
+    haveCommitted = true;
+    state      = gs.state <= 2 ? gs.state : 0;
+    hoursInDay = gs.hoursInDay;
+    cycleStep  = gs.cycleStep <= CY_SAMPLED ? gs.cycleStep : (uint8_t)CY_START;
+    waitUntil  = gs.waitUntil;
+    lastSync   = gs.lastSync;
+    location   = gs.location;
+    if (rtc.getEpoch() < gs.rtcEpoch) rtc.setEpoch(gs.rtcEpoch);
+    return true;
+}
 
-                if (!uploadData(row)) { // push to ThingSpeak
-                    f.close(); return false;    // abort on first failure
-                }
-                row = "";
-            }
-            else if (c != '\r') row += c;       // build row
-        }
-        f.close();
-        SD.remove(list[i]);                     // delete file after upload
+/* --- MOUNT SD CARD ---
+ * A missing card is tried again at most every SD_RETRY_MS. The first
+ * mount repairs what the last power loss may have torn and loads the
+ * stored config. */
+bool sdInit() {
+    static bool ready = false, tried = false;
+    static uint32_t lastTry;
+    if (ready) return true;
+    if (tried && millis() - lastTry < SD_RETRY_MS) return false;
+    wdCheckpoint(WD_SD, 10000);
+    tried = true;
+    lastTry = millis();
+    {
+        EnergyScope es(EN_SD);
+        if (!(ready = storeBegin(PIN_SD_SELECT))) return false;
     }
+    sdlogRecover();     // repair a row torn by a brownout during the last write
+    queueRecover();     // drop a torn LATEST.TXT, re-check the upload cursor
+    configLoad();
+    applyConfig();
+    if (resetToLog) logReset();
     return true;
 }
 
+/* One TSV line per watchdog or software restart: date, time, then
+ * resetText()'s fields */
+void logReset() {
+    char date[12], time[12], day[16], line[96];
+    timestampRtc(date, time, day);
+    TextBuf tb(line, sizeof(line));
+    tb.add(date).add('\t').add(time).add('\t');
+    resetText(tb, '\t');
+    EnergyScope es(EN_SD);
+    StoreFile f = storeOpen(RESET_FILE, ST_APPEND);
+    if (!f) return;
+    f.println(line);
+    f.close();
+    resetToLog = false;
+}
+
 /* --- DELETE --- */
 bool sdDeleteCsv(const char* name) {
     if (!sdInit()) return false;
-    return SD.exists(name) && SD.remove(name);
+    return storeExists(name) && storeRemove(name);
 }
 
 void clearAllCsvFiles() {
+    EnergyScope es(EN_SD);
     if (!sdInit()) return;
     
-    File dir = SD.open("/");
-    while (File f = dir.openNextFile()) {
-        if (!f.isDirectory() && String(f.name()).endsWith(".CSV")) {
-            f.close();
-            SD.remove(f.name());
-            if (DEBUG) SerialUSB.println("Deleted old file: " + String(f.name()));
-        } else {
-            f.close();
-        }
+    char name[64];
+    StoreDir dir;
+    if (!dir.open()) return;
+    while (dir.next(name, sizeof(name))) {
+        size_t n = strlen(name);
+        if (n > 4 && !strcmp(name + n - 4, ".CSV") && storeRemove(name))
+            LOG_DEBUG("Deleted old file: %s", name);
     }
     dir.close();
 }
 
 /* --- GPS FUNCTIONS --- */
+/* Started with the modem: the first fix is read after the upload */
 void initGPS() {
-    if (DEBUG) SerialUSB.println("Initializing GPS...");
+    LOG_DEBUG("Initializing GPS...");
     
-    // Basic AT commands to set up GPS
-    sendAT("AT", 1000);              // Basic check
-    sendAT("ATE0", 1000);            // Disable echo
-    sendAT("AT+CGPS=1,1", 2000);     // Power on GPS in standalone mode
+    sendAT("ATE0", 500);             // Disable echo
+    sendAT("AT+CGPS=1,1", 500);      // Power on GPS in standalone mode
     
-    if (DEBUG) SerialUSB.println("GPS initialization complete");
+    LOG_DEBUG("GPS initialization complete");
 }
 
-String getGPSData() {
+bool getGPSData(GpsFix& fix) {
+    if (!modemUp) return false;                 // off: the cached fix stands
+    EnergyScope es(EN_GPS);
     String gpsInfo = sendAT("AT+CGPSINFO", 3000);
     
-    if (gpsInfo.indexOf("+CGPSINFO:") >= 0) {
-        // Extract the GPS data line
-        int startIdx = gpsInfo.indexOf("+CGPSINFO:");
-        int endIdx = gpsInfo.indexOf('\n', startIdx);
-        if (endIdx == -1) endIdx = gpsInfo.length();
-        
-        String nmeaLine = gpsInfo.substring(startIdx, endIdx);
-        nmeaLine.trim();
-        
-        if (DEBUG) SerialUSB.println("GPS Raw: " + nmeaLine);
-        
-        return parseCoordinates(nmeaLine);
-    }
-    
-    return ""; // No GPS data available
-}
+    int startIdx = gpsInfo.indexOf("+CGPSINFO:");
+    if (startIdx < 0) return false;             // No GPS data available
 
-String parseCoordinates(const String& nmeaLine) {
-    int idx = nmeaLine.indexOf(":");
-    if (idx < 0) return "";
-
-    String data = nmeaLine.substring(idx + 1);
-    data.trim();
-
-    // Data format: <lat>,<N/S>,<long>,<E/W>,<date>,<utc>,<alt>,<speed>
-    int firstComma = data.indexOf(',');
-    if (firstComma < 0 || data[firstComma + 1] == ',') return ""; // No GPS fix
-
-    String lat = data.substring(0, firstComma);
-    int secondComma = data.indexOf(',', firstComma + 1);
-    String ns = data.substring(firstComma + 1, secondComma);
-
-    int thirdComma = data.indexOf(',', secondComma + 1);
-    String lon = data.substring(secondComma + 1, thirdComma);
-    int fourthComma = data.indexOf(',', thirdComma + 1);
-    String ew = data.substring(thirdComma + 1, fourthComma);
-
-    // Get altitude (7th field)
-    int altStart = data.indexOf(',', fourthComma + 1);
-    for (int i = 0; i < 2; i++) { // Skip date and UTC
-        altStart = data.indexOf(',', altStart + 1);
-    }
-    int altEnd = data.indexOf(',', altStart + 1);
-    String alt = data.substring(altStart + 1, altEnd);
+    LOG_DEBUG("GPS Raw: %s", gpsInfo.c_str() + startIdx);
 
-    if (lat.length() == 0 || lon.length() == 0) return "";
-
-    // Convert to decimal degrees
-    float latDeg = lat.toFloat() / 100.0;
-    float lonDeg = lon.toFloat() / 100.0;
-    float altM = alt.toFloat();
-
-    // Apply hemisphere corrections
-    if (ns == "S") latDeg = -latDeg;
-    if (ew == "W") lonDeg = -lonDeg;
-
-    // Update global location struct
-    location.latitude = latDeg;
-    location.longitude = lonDeg;
-    location.altitude = altM;
-
-    return String(latDeg, 6) + "," + String(lonDeg, 6) + "," + String(altM, 1);
+    if (!parseCgpsInfo(gpsInfo.c_str() + startIdx, fix)) return false;     // No GPS fix
+    location = fix;
+    return true;
 }
 
 /* --- IR TEMPERATURE SENSOR FUNCTIONS --- */
-String getIRTemperatureData() {
+void getIRTemperatureData(Sample& s) {
     // TODO: Implement IR temperature sensor reading
-    // This function should return air temperature and surface temperature
-    // Format: "air_temp,surface_temp" as string
-    
+    // This function should fill the air and surface temperature
+    // in deci-°C (MLX90614 resolution is 0.02 °C)
+
     // Placeholder implementation - replace with actual sensor code
-    float airTemp = 25.0;      // Air temperature in Celsius
-    float surfaceTemp = 30.0;  // Surface temperature in Celsius
-    
-    if (DEBUG) {
-        SerialUSB.println("IR Sensor - Air: " + String(airTemp, 1) + "°C, Surface: " + String(surfaceTemp, 1) + "°C");
-    }
-    
-    return String(airTemp, 1) + "," + String(surfaceTemp, 1);
+    s.irAir_dC     = 250;   // Air temperature, 25.0 °C
+    s.irSurface_dC = 300;   // Surface temperature, 30.0 °C
+
+    LOG_DEBUG("IR Sensor - Air: %d.%d°C, Surface: %d.%d°C",
+              s.irAir_dC / 10, s.irAir_dC % 10, s.irSurface_dC / 10, s.irSurface_dC % 10);
 }
 
 /* --- PROCESS I²C CHUNK FROM ENVIROPRO --- */
-void processChunk(const String& data)
+void processChunk(const char* data, size_t n)
 {
     // Don't process new data if sampleData() is currently running
     if (processingData) {
-        if (DEBUG) SerialUSB.println("Skipping chunk - data processing in progress");
-        return;
-    }
-    
-    SerialUSB.println("Processing Chunk: " + data);
-    /* 1 ── new transmission header ------------------------ */
-    if (data.startsWith("Moist,")) {
-        curType     = "Moist";
-        moistBuf    = data;          // start fresh
-        assembling  = true;
-        return;
-    }
-    if (data.startsWith("Temp,")) {
-        curType     = "Temp";
-        tempBuf     = data;
-        assembling  = true;
+        LOG_DEBUG("Skipping chunk - data processing in progress");
         return;
     }
 
-    /* 2 ── continuation of current block ----------------- */
-    if (assembling) {
-        if (curType == "Moist")      moistBuf += data;
-        else if (curType == "Temp")  tempBuf  += data;
-
-        /* 3 ── heuristic: a short (<15 B) fragment marks
-         *        the end of this transmission ------------- */
-        if (data.length() < 15) {
-            assembling = false;      // finished – ready for sampleData()
-            if (DEBUG) SerialUSB.println("Data assembly complete");
+    TRACE(TR_CHUNK, n);
+    LOG_DEBUG("Processing Chunk: %.*s", (int)n, data);
+    switch (ingest.feed(data, n)) {
+        case ING_DONE: {
+            int8_t t = ingest.current();
+            TRACE(TR_BLOCK_DONE, t);
+            LOG_DEBUG("Data assembly complete");
+
+            int32_t v[SAMPLE_DEPTHS_MAX];
+            uint8_t nv;
+            if (sampleParse(ingest.values(t), v, SAMPLE_DEPTHS_MAX, nv)) {
+                int8_t r = triggers.evaluate(t, v, nv, millis());
+                if (r >= 0 && triggerFired < 0) {
+                    triggerFired = r;
+                    TRACE(TR_TRIGGER, r);
+                }
+            }
             /*  let the state-machine call sampleData()
                 (case 2) to save the finished buffer        */
+            break;
         }
+        case ING_OVERFLOW:
+            LOG_WARN("%s block exceeds %u bytes, dropped",
+                     ingest.type(ingest.current()).tag, (unsigned)INGEST_BUF_MAX);
+            break;
+        default:
+            break;
     }
 }
-
-/*-----------------------------------------------------------
- *  SAMPLE DATA  – called once per hour from the state-machine
- * --------------------------------------------------------- */
-void sampleData()
+/* False only when the blocks are not all in yet; any other outcome
+ * uses them up */
+bool sampleData(bool event)
 {   
-    if (DEBUG) SerialUSB.println("Attempting to sample data");
+    EnergyScope es(EN_SAMPLE);
+    MemPhaseScope mp(MP_SAMPLE);
+    wdCheckpoint(WD_SAMPLE, 10000);
+    LOG_DEBUG("Attempting to sample data");
     
     // Set processing flag to prevent new I2C data from interfering
     processingData = true;
     
     /* 1 ── still receiving an I²C block? */
-    if (assembling) {
-        if (DEBUG) SerialUSB.println("Sample cancelled, still assembling");
+    if (ingest.busy()) {
+        LOG_DEBUG("Sample cancelled, still assembling");
+        TRACE(TR_SAMPLE, 0);
         processingData = false;
-        return;
+        return false;
     }
 
-    /* 2 ── need BOTH buffers ready */
-    if (!moistBuf.length() || !tempBuf.length()) {
-        Serial.println("Sample cancelled, one buffer not ready");
+    /* 2 ── need every required block */
+    if (!ingest.ready()) {
+        LOG_INFO("Sample cancelled, a required block is not ready");
+        TRACE(TR_SAMPLE, 0);
         processingData = false;
-        return;
+        return false;
     }
 
-    /* 3 ── strip the labels ("Moist," / "Temp,") ------------- */
-    if(DEBUG){  // code hung after attempting to sample data. New data came in and the state machine seemed to halt.
-        SerialUSB.println("moistBuf=" + moistBuf);
-        SerialUSB.println("tempBuf=" + tempBuf);
+    /* 3 ── parse each block into hundredths ----------------- */
+    Sample smp;
+    for (uint8_t i = 0; i < ingest.types(); ++i) {
+        LOG_DEBUG("%s=%s", ingest.type(i).tag, ingest.values(i));
+        if (!sampleParse(ingest.values(i), smp.value[i], SAMPLE_DEPTHS_MAX, smp.depths[i])) {
+            LOG_WARN("%s values not numeric, column left empty", ingest.type(i).tag);
+            smp.depths[i] = 0;
+        }
     }
-    String moistValues = moistBuf.substring(6);      // after "Moist,"
-    String tempValues  = tempBuf.substring(5);       // after "Temp,"
-    if (moistValues.endsWith(",")) moistValues.remove(moistValues.length() - 1);
-    if (tempValues.endsWith(","))  tempValues.remove(tempValues.length()  - 1);
 
     /* 4 ── build timestamp ---------------------------------- */
-    String time = getTime();
-    uint16_t yr2digit = time.substring(0,2).toInt();
-    uint8_t  mon = time.substring(3,5).toInt();
-    uint8_t  day = time.substring(6,8).toInt();
-    uint8_t  hr = time.substring(9,11).toInt();
-    uint8_t  min = time.substring(12,14).toInt();
-    uint8_t  sec = time.substring(15,17).toInt();
-
-    char dateStr[11], timeStr[9];
-    snprintf(dateStr, sizeof(dateStr), "%02u/%02u/%02u", yr2digit, mon, day);
-    snprintf(timeStr, sizeof(timeStr), "%02u:%02u:%02u", hr, min, sec);
+    char dateStr[11], timeStr[9], fname[13];
+    timestampNow(dateStr, timeStr, fname);
 
     /* 5 ── get GPS data ---------------------------------- */
-    String gpsData = getGPSData();
-    if (gpsData.length() == 0) {
-        // Use last known location or default values
-        gpsData = String(location.latitude, 6) + "," + String(location.longitude, 6) + "," + String(location.altitude, 1);
-        if (DEBUG) SerialUSB.println("Using cached GPS data: " + gpsData);
-    } else {
-        if (DEBUG) SerialUSB.println("Fresh GPS data: " + gpsData);
+    bool freshFix = getGPSData(smp.fix);
+    if (!freshFix) smp.fix = location;          // Use last known location or default values
+    LOG_DEBUG("Using %s GPS data", freshFix ? "fresh" : "cached");
+
+    /* 6 ── compose CSV row: one column per record type, IR last */
+    getIRTemperatureData(smp);
+    char row[ROW_MAX];
+    TextBuf tb(row, sizeof(row));
+    sampleRow(smp, ingest.types(), dateStr, timeStr, tb);
+
+    if (!tb.ok || !rowSanitize(row, sizeof(row))) {  // url encoding
+        LOG_ERROR("Row exceeds %u bytes, dropped", (unsigned)ROW_MAX);
+        sampleDue = false;
+        processingData = false;
+        return true;
     }
 
-    /* 6 ── get IR temperature data ---------------------------------- */
-    String irData = getIRTemperatureData();
 
-    /* 7 ── compose CSV row ---------------------------------- */
-    String row  = String(dateStr) + "\t" + timeStr + "\t";
-    row += gpsData + "\t";
-    row += tempValues + "\t" + moistValues + "\t" + irData;
-    
-    row.replace("\n", "");
-    row.replace(" ", "%20");  // url encoding
-
-
-    /* 8 ── ensure SD present -------------------------------- */
-    if (!sdInit()) {
-        SerialUSB.println("Failed to initialize SD card");
-        return;                          // silent if no card
+    /* 7 ── queue as the latest reading, or fold into the interval;
+     *      event samples are always queued raw                   */
+    if (!aggIntervalMs || event) {
+        LOG_DEBUG("Queueing row: %s", row);
+        if (!queuePush(row, fname)) {
+            LOG_ERROR("Failed to store row in %s", fname);
+            TRACE(TR_SD_FAIL, 1);
+            sampleDue = false;
+            processingData = false;
+            return true;
+        }
     }
-
-    /* 9 ── open / create daily file ------------------------- */
-    char fname[24];
-    snprintf(fname, sizeof(fname), "D%02u%02u%02u.CSV", yr2digit, mon, day);  // Use 2-digit year for filename
-    bool newFile = !SD.exists(fname);
-
-    File f = SD.open(fname, FILE_WRITE);
-    if (!f) {
-        SerialUSB.println("Failed to open file " + (String)fname);
-        SerialUSB.println("New file: " + newFile);
-        return;
+    if (aggIntervalMs) {
+        if (!event && aggRawLocal && !queueArchive(row, fname)) TRACE(TR_SD_FAIL, 2);
+        if (!agg.count()) aggStart = millis();
+        for (uint8_t i = 0; i < ingest.types(); ++i)
+            agg.add(i, smp.value[i], smp.depths[i]);
+        agg.sampleDone();
+
+        if (millis() - aggStart >= aggIntervalMs) {
+            if (!emitSummary(dateStr, timeStr, fname)) TRACE(TR_SD_FAIL, 3);
+            agg.reset();
+        }
     }
 
-    /* 10 ── append the data row ------------------------------ */
-    if (DEBUG) SerialUSB.println("Writing row to SD: " + row);
-    f.println(row);
-    f.close();
-
-    /* 11 ── clear for next hour ------------------------------ */
-    moistBuf  = "";
-    tempBuf   = "";
-    curType   = "";
+    /* 8 ── clear for next hour ------------------------------ */
+    ingest.clear();
+    triggerFired = -1;      // this sample covers any pending event
+    sampleDue = false;
+    TRACE(TR_SAMPLE, 1);
     processingData = false;  // Allow new I2C data to be processed
+    return true;
+}
+
+/* One row per enabled statistic: date, time, GPS, a column per record
+ * type, then "<stat>:<samples>". The mean goes out as the latest row,
+ * the others join the backlog. */
+bool emitSummary(const char* date, const char* time, const char* dayFile)
+{
+    bool ok = true;
+    char row[ROW_MAX];
+    for (int8_t s = AGG_STAT_COUNT - 1; s >= 0; --s) {   // mean last: it becomes latest
+        if (!(aggStatMask & (1u << s))) continue;
+
+        TextBuf tb(row, sizeof(row));
+        tb.add(date).add('\t').add(time).add('\t');
+        formatFix(location, tb);
+        tb.add('\t');
+        for (uint8_t i = 0; i < ingest.types(); ++i) {
+            agg.format(i, (AggStat)s, tb);
+            tb.add('\t');
+        }
+        tb.add(AGG_STAT_NAME[s]).add(':').addUint(agg.count());
+        if (!tb.ok) { ok = false; continue; }
+
+        LOG_DEBUG("Summary row: %s", row);
+        ok &= s == AGG_MEAN ? queuePush(row, dayFile) : queueAppend(row, dayFile);
+    }
+    LOG_INFO("Interval summary of %u samples queued", agg.count());
+    return ok;
 }
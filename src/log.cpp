@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include "log.h"
+
+#if LOG_TRACE
+#include "storage.h"
+bool sdInit();                              // jacob-main.cpp
+#endif
+
+/* True while running in an exception handler (I²C onReceive etc.) */
+static inline bool inIsr() {
+#ifdef ARDUINO_ARCH_SAMD
+    return __get_IPSR() != 0;
+#else
+    return false;
+#endif
+}
+
+#if LOG_LEVEL > LOG_LVL_NONE
+void logWrite(uint8_t lvl, const char* fmt, ...) {
+    static const char TAG[] = "?EWID";
+    // One buffer per context so an ISR can't scribble over a line mid-print
+    static char lineBuf[LOG_LINE_MAX];
+    static char isrBuf[LOG_LINE_MAX];
+    char* buf = inIsr() ? isrBuf : lineBuf;
+
+    buf[0] = TAG[lvl < sizeof(TAG) - 1 ? lvl : 0];
+    buf[1] = ' ';
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + 2, LOG_LINE_MAX - 2, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+
+    size_t len = 2 + ((size_t)n < LOG_LINE_MAX - 2 ? (size_t)n : LOG_LINE_MAX - 3);
+    SerialUSB.write((const uint8_t*)buf, len);
+    SerialUSB.write("\r\n");
+}
+
+void logRaw(const char* s, size_t n) {
+    SerialUSB.write((const uint8_t*)s, n);
+}
+#endif
+
+
+#if LOG_TRACE
+/* ======================================================== */
+/* |--------------------- TRACE RING ---------------------| */
+/* ======================================================== */
+struct TraceRec {
+    uint32_t ms;
+    uint16_t id;
+    uint16_t arg;
+};
+
+static const uint8_t TRACE_SLOTS = 64;      // power of two
+static TraceRec traceRing[TRACE_SLOTS];
+static volatile uint8_t traceHead = 0;      // next write
+static volatile uint8_t traceTail = 0;      // oldest unflushed
+static volatile uint16_t traceLost = 0;
+
+void tracePoint(uint16_t id, uint16_t arg) {
+    noInterrupts();
+    uint8_t next = (traceHead + 1) & (TRACE_SLOTS - 1);
+    if (next == traceTail) {
+        traceLost++;                        // keep the oldest, drop the newest
+    } else {
+        traceRing[traceHead] = TraceRec{(uint32_t)millis(), id, arg};
+        traceHead = next;
+    }
+    interrupts();
+}
+
+void traceFlush() {
+    if (traceHead == traceTail || !sdInit()) return;
+
+    StoreFile f = storeOpen("TRACE.BIN", ST_APPEND);
+    if (!f) return;
+    while (traceTail != traceHead) {
+        f.write(&traceRing[traceTail], sizeof(TraceRec));
+        traceTail = (traceTail + 1) & (TRACE_SLOTS - 1);
+    }
+    if (traceLost) {
+        TraceRec lost{(uint32_t)millis(), 0xFFFF, traceLost};
+        f.write(&lost, sizeof(lost));
+        traceLost = 0;
+    }
+    f.close();
+}
+#endif
@@ -0,0 +1,196 @@
+#include <Arduino.h>
+#include "wiring_private.h"
+#include "lora.h"
+#include "log.h"
+#include "nodeframe.h"
+#include "rcvparser.h"
+#include "textproc.h"
+#include "upqueue.h"
+
+void timestampRtc(char* date, char* time, char* dayFile);  // jacob-main.cpp
+uint32_t rtcSecondsOfDay();
+
+/* Create a new UART instance using SERCOM3 on PADs 2 (RX) and 3 (TX) */
+Uart LORA (&sercom3, 2, 3, SERCOM_RX_PAD_2, UART_TX_PAD_2);
+void SERCOM3_Handler() { LORA.IrqHandler(); }
+
+static Stream* port = &LORA;
+
+static TdmaSchedule sched(TdmaConfig{LORA_PERIOD_MS, LORA_BEACON_MS, LORA_SLOT_MS, LORA_GUARD_MS});
+static bool     schedOn = false;
+static bool     radioAwake = false;
+
+static void onFrame(const RcvFrame& f, void* ctx);
+static ByteRing<256> rxRing;                // UART → parser
+static RcvParser     rcv(onFrame);
+static uint8_t       queuedNow = 0;         // rows queued by the current loraService()
+
+bool loraBegin() {
+    pinPeripheral(2, PIO_SERCOM);
+    pinPeripheral(3, PIO_SERCOM);
+    LORA.begin(LORA_BAUD);
+    port = &LORA;
+
+    if (!loraOn()) return false;
+    return loraAT("AT+ADDRESS=" + String(LORA_GATEWAY_ADDR)).indexOf("OK") >= 0;
+}
+
+void loraAttach(Stream& p) {
+    port = &p;
+}
+
+/* ---------- tiny util identical to LTE sendAT() style ----- */
+String loraAT(const String& cmd, uint32_t to, bool dbg)
+{
+    String resp;
+    port->println(cmd);                   // AT … \r\n
+
+    unsigned long t0 = millis();
+    while (millis() - t0 < to) {
+        while (port->available())
+            resp += char(port->read());
+        if (resp.indexOf("OK") >= 0 || resp.indexOf("ERR") >= 0) break;
+    }
+    if (dbg && resp.length()) LOG_DEBUG_RAW(resp.c_str(), resp.length());
+    return resp;
+}
+
+/* ---------- 1. Wake / turn ON (exit sleep mode) ------------ */
+bool loraOn()
+{
+    /* The first byte on UART already wakes the chip from MODE 1
+       and the module answers +READY\r\n                       */
+    port->write('\r');                        // dummy wake pulse
+    delay(10);
+
+    // Tell it explicitly to stay in MODE 0 (active)
+    String r = loraAT("AT+MODE=0");
+    if (r.indexOf("OK") >= 0 || r.indexOf("+READY") >= 0) {
+        LOG_DEBUG("[LoRa] ACTIVE");
+        radioAwake = true;
+        sched.radio(true, millis());
+        return true;
+    }
+    LOG_WARN("[LoRa] Wake-up FAILED");
+    return false;
+}
+
+/* ---------- 2. Put module to SLEEP (µA) -------------------- */
+void loraOff()
+{
+    loraAT("AT+MODE=1");                     // replies OK then sleeps
+    radioAwake = false;
+    sched.radio(false, millis());
+    LOG_DEBUG("[LoRa] SLEEP");
+}
+
+/* ---------- 3. Send a WAKE-UP frame to another node -------- */
+bool loraSendWake(uint16_t addr, uint8_t window)
+{
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "AT+SEND=%u,4,WU%02u", addr, window);   // "WU10" etc.
+
+    bool ok = loraAT(cmd, 5000).indexOf("OK") >= 0;
+    LOG_DEBUG("[LoRa] WAKE(%u) %s", addr, ok ? "sent" : "fail");
+    return ok;
+}
+
+/* ---------- Binary payload: header as text, then raw bytes -- */
+bool loraSend(uint16_t addr, const uint8_t* data, uint8_t len)
+{
+    char hdr[24];
+    snprintf(hdr, sizeof(hdr), "AT+SEND=%u,%u,", addr, len);
+    port->print(hdr);
+    port->write(data, len);
+    port->print("\r\n");
+
+    String resp;
+    unsigned long t0 = millis();
+    while (millis() - t0 < 3000) {
+        while (port->available()) resp += char(port->read());
+        if (resp.indexOf("OK") >= 0) return true;
+        if (resp.indexOf("ERR") >= 0) break;
+    }
+    LOG_WARN("[LoRa] SEND to %u failed", addr);
+    return false;
+}
+
+/* ---------- 4. Frame sink: decode and queue ---------------- */
+static void onFrame(const RcvFrame& f, void* /*ctx*/)
+{
+    NodeFrame nf;
+    if (!nodeFrameDecode(f.data, f.len, nf)) {
+        LOG_WARN("[LoRa] bad frame from %u (%u B)", f.from, f.len);
+        return;
+    }
+    nf.addr = f.from;
+    nf.rssi = f.rssi;
+    nf.snr  = f.snr;
+
+    if (schedOn) {
+        sched.frameSeen(f.from, millis());
+        if (sched.slotOf(f.from) < 0 && sched.addNode(f.from))
+            LOG_INFO("[LoRa] node %u joined, slot %d", f.from, sched.slotOf(f.from));
+    }
+
+    char date[11], time[9], day[13], row[256];
+    timestampRtc(date, time, day);           // no modem round-trip inside a slot
+    TextBuf tb(row, sizeof(row));
+    if (nodeFrameRow(nf, date, time, tb) && queueAppend(row, day)) {
+        queuedNow++;
+        LOG_DEBUG("[LoRa] node %u seq %u queued", nf.addr, nf.seq);
+    }
+}
+
+/* ---------- 5. Non-blocking: UART → ring → +RCV parser ----- */
+uint8_t loraService()
+{
+    queuedNow = 0;
+    do {
+        while (port->available() && rxRing.space())
+            rxRing.push((uint8_t)port->read());
+        rcv.drain(rxRing);
+    } while (port->available());
+    return queuedNow;
+}
+
+/* ======================================================== */
+/* |--------------------- TDMA DRIVER --------------------| */
+/* ======================================================== */
+void loraSchedBegin(const uint16_t* nodes, uint8_t n)
+{
+    for (uint8_t i = 0; i < n; ++i) sched.addNode(nodes[i]);
+    sched.start(millis());
+    schedOn = true;
+}
+
+void loraSchedService()
+{
+    if (!schedOn) { loraService(); return; }
+
+    uint32_t until;
+    uint32_t now = millis();
+    switch (sched.step(now, until)) {
+        case TdmaSchedule::TDMA_BEACON: {
+            if (!radioAwake) loraOn();
+            uint8_t b[TDMA_BEACON_MAX];
+            size_t n = sched.beacon(b, sizeof(b), rtcSecondsOfDay(), now);
+            loraSend(LORA_BROADCAST, b, n);
+            sched.beaconSent(millis());
+            break;
+        }
+        case TdmaSchedule::TDMA_LISTEN:
+            if (!radioAwake) loraOn();
+            loraService();
+            break;
+        case TdmaSchedule::TDMA_SLEEP:
+            loraService();                  // anything still buffered from the last window
+            if (radioAwake) loraOff();
+            break;
+    }
+}
+
+const TdmaStats& loraSchedStats()
+{
+    return sched.stats();
+}
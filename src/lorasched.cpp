@@ -0,0 +1,103 @@
+#include "lorasched.h"
+
+TdmaSchedule::TdmaSchedule(const TdmaConfig& c)
+    : cfg(c), st(), count(0), t0(0), heard(0), closed(0),
+      beaconDone(false), radioOn(false), radioSince(0) {}
+
+bool TdmaSchedule::addNode(uint16_t a) {
+    if (slotOf(a) >= 0) return true;
+    if (count >= TDMA_MAX_NODES) return false;
+    addr[count++] = a;
+    return true;
+}
+
+int8_t TdmaSchedule::slotOf(uint16_t a) const {
+    for (uint8_t i = 0; i < count; ++i)
+        if (addr[i] == a) return i;
+    return -1;
+}
+
+uint32_t TdmaSchedule::slotOpen(uint8_t i) const {
+    uint32_t s = cfg.beaconMs + (uint32_t)i * cfg.slotMs;
+    return s > cfg.guardMs ? s - cfg.guardMs : 0;
+}
+
+uint32_t TdmaSchedule::slotClose(uint8_t i) const {
+    return cfg.beaconMs + (uint32_t)(i + 1) * cfg.slotMs;
+}
+
+void TdmaSchedule::start(uint32_t now) {
+    t0 = now;
+    heard = closed = 0;
+    beaconDone = false;
+}
+
+void TdmaSchedule::rollOver(uint32_t now) {
+    uint32_t off = now - t0;
+    if (off < cfg.periodMs) return;
+
+    for (uint8_t i = 0; i < count; ++i)
+        if (!((heard | closed) & (1UL << i))) st.misses++;
+    st.superframes++;
+    t0 += (off / cfg.periodMs) * cfg.periodMs;
+    heard = closed = 0;
+    beaconDone = false;
+}
+
+TdmaSchedule::Action TdmaSchedule::step(uint32_t now, uint32_t& until) {
+    rollOver(now);
+    if (!beaconDone) {
+        until = now;
+        return TDMA_BEACON;
+    }
+
+    uint32_t off = now - t0;
+    for (uint8_t i = 0; i < count; ++i) {
+        uint32_t bit = 1UL << i;
+        if (heard & bit) continue;
+        if (off < slotOpen(i)) { until = t0 + slotOpen(i); return TDMA_SLEEP; }
+        if (off < slotClose(i)) { until = t0 + slotClose(i); return TDMA_LISTEN; }
+        if (!(closed & bit)) { closed |= bit; st.misses++; }
+    }
+    until = t0 + cfg.periodMs;
+    return TDMA_SLEEP;
+}
+
+void TdmaSchedule::beaconSent(uint32_t now) {
+    (void)now;
+    beaconDone = true;
+}
+
+void TdmaSchedule::frameSeen(uint16_t from, uint32_t now) {
+    int8_t i = slotOf(from);
+    uint32_t off = now - t0;
+    if (i < 0 || off < slotOpen(i) || off >= slotClose(i) || (heard & (1UL << i))) {
+        st.strays++;                        // outside its window: it collided with someone
+        return;
+    }
+    heard |= 1UL << i;
+    st.frames++;
+}
+
+void TdmaSchedule::radio(bool on, uint32_t now) {
+    if (on && !radioOn) radioSince = now;
+    if (!on && radioOn) st.radioOnMs += now - radioSince;
+    radioOn = on;
+}
+
+static void put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void put32(uint8_t* p, uint32_t v) { put16(p, (uint16_t)v); put16(p + 2, (uint16_t)(v >> 16)); }
+
+size_t TdmaSchedule::beacon(uint8_t* out, size_t cap, uint32_t secOfDay, uint32_t now) const {
+    size_t n = 14 + 2 * (size_t)count;
+    if (n > cap) return 0;
+
+    out[0] = TDMA_BEACON_V1;
+    put32(out + 1, secOfDay);
+    put32(out + 5, t0 + cfg.periodMs - now);        // ms to next beacon
+    put16(out + 9, cfg.slotMs);
+    put16(out + 11, cfg.beaconMs);
+    out[13] = count;
+    for (uint8_t i = 0; i < count; ++i) put16(out + 14 + 2 * i, addr[i]);
+    return n;
+}
@@ -0,0 +1,148 @@
+#include <Arduino.h>
+#include <malloc.h>
+#include "memstat.h"
+#include "log.h"
+
+static MemStats stats = {UINT32_MAX, UINT32_MAX, 0, 0, 0, {0}, {0}};
+static volatile MemPhase phase = MP_BOOT;
+
+static inline bool inIsr() {
+#ifdef ARDUINO_ARCH_SAMD
+    return __get_IPSR() != 0;
+#else
+    return false;
+#endif
+}
+
+/* ======================================================== */
+/* |------------------ COUNTING ALLOCATOR ----------------| */
+/* ======================================================== */
+#ifdef MEM_COUNT_ALLOCS
+extern "C" {
+void* __real_malloc(size_t n);
+void* __real_realloc(void* p, size_t n);
+void  __real_free(void* p);
+
+static void countAlloc(size_t n, size_t oldUsable, void* p) {
+    MemPhase ph = inIsr() ? MP_ISR : phase;
+    stats.allocs[ph]++;
+    stats.allocBytes[ph] += n;
+    if (!p) return;
+    stats.liveBytes += malloc_usable_size(p) - oldUsable;
+    if (stats.liveBytes > stats.heapPeak) stats.heapPeak = stats.liveBytes;
+}
+
+void* __wrap_malloc(size_t n) {
+    void* p = __real_malloc(n);
+    countAlloc(n, 0, p);
+    return p;
+}
+
+void* __wrap_realloc(void* old, size_t n) {
+    size_t oldUsable = old ? malloc_usable_size(old) : 0;
+    void* p = __real_realloc(old, n);
+    if (p) countAlloc(n, oldUsable, p);
+    else if (!n) stats.liveBytes -= oldUsable;      // realloc(p, 0) frees
+    return p;
+}
+
+void __wrap_free(void* p) {
+    if (p) stats.liveBytes -= malloc_usable_size(p);
+    __real_free(p);
+}
+}
+#endif
+
+/* ======================================================== */
+/* |----------------- HEAP / STACK PROBES ----------------| */
+/* ======================================================== */
+#ifdef ARDUINO_ARCH_SAMD
+extern "C" char* sbrk(int incr);
+extern "C" uint32_t __StackTop;             // linker script: top of RAM
+
+/* newlib-nano free list (Arduino SAMD links with nano.specs) */
+struct NanoChunk { long size; NanoChunk* next; };
+extern "C" NanoChunk* __malloc_free_list;
+
+static const uint32_t PAINT = 0xA5A5A5A5;
+static const uint32_t STACK_GUARD = 64;     // never paint right under the live frame
+
+static uint32_t stackPointer() {
+    return __get_MSP();
+}
+
+void memBegin() {
+    uint32_t* p   = (uint32_t*)(((uint32_t)sbrk(0) + 3) & ~3u);
+    uint32_t* end = (uint32_t*)(stackPointer() - STACK_GUARD);
+    while (p < end) *p++ = PAINT;
+    phase = MP_BOOT;
+}
+
+uint32_t memFreeHeap() {
+    uint32_t gap = stackPointer() - (uint32_t)sbrk(0);
+    return gap + mallinfo().fordblks;
+}
+
+uint32_t memLargestFree() {
+    uint32_t largest = stackPointer() - (uint32_t)sbrk(0);
+    noInterrupts();
+    for (NanoChunk* c = __malloc_free_list; c; c = c->next)
+        if ((uint32_t)c->size > largest) largest = c->size;
+    interrupts();
+    return largest;
+}
+
+uint32_t memStackUsed() {
+    // The first word above the heap that lost its paint is the deepest the stack has been
+    uint32_t* p   = (uint32_t*)(((uint32_t)sbrk(0) + 3) & ~3u);
+    uint32_t* top = (uint32_t*)stackPointer();
+    while (p < top && *p == PAINT) ++p;
+    return (uint32_t)&__StackTop - (uint32_t)p;
+}
+#else
+/* Host build: only the counting allocator is meaningful */
+void     memBegin() { phase = MP_BOOT; }
+uint32_t memFreeHeap() { return UINT32_MAX; }
+uint32_t memLargestFree() { return UINT32_MAX; }
+uint32_t memStackUsed() { return 0; }
+#endif
+
+/* ======================================================== */
+MemPhase memPhase(MemPhase p) {
+    MemPhase old = phase;
+    phase = p;
+    return old;
+}
+
+void memSample() {
+    uint32_t f = memFreeHeap();
+    uint32_t l = memLargestFree();
+    uint32_t s = memStackUsed();
+    if (f < stats.freeMin)    stats.freeMin = f;
+    if (l < stats.largestMin) stats.largestMin = l;
+    if (s > stats.stackMax)   stats.stackMax = s;
+}
+
+const MemStats& memStats() {
+    return stats;
+}
+
+void memPeakReset() {
+    stats.heapPeak = stats.liveBytes;
+}
+
+void memReport() {
+    static const char* const NAMES[MP_COUNT] = {"boot", "idle", "sample", "upload", "isr"};
+    memSample();
+    LOG_INFO("MEM free=%lu min=%lu largestMin=%lu stack=%lu live=%lu peak=%lu",
+             (unsigned long)memFreeHeap(), (unsigned long)stats.freeMin,
+             (unsigned long)stats.largestMin, (unsigned long)stats.stackMax,
+             (unsigned long)stats.liveBytes, (unsigned long)stats.heapPeak);
+    for (uint8_t i = 0; i < MP_COUNT; ++i) {
+        if (!stats.allocs[i]) continue;
+        LOG_INFO("MEM %-6s allocs=%lu bytes=%lu", NAMES[i],
+                 (unsigned long)stats.allocs[i], (unsigned long)stats.allocBytes[i]);
+        stats.allocs[i] = stats.allocBytes[i] = 0;
+    }
+    (void)NAMES;
+}
@@ -0,0 +1,170 @@
+#include "mqttuplink.h"
+#include "energy.h"
+#include "log.h"
+#include "watchdog.h"
+
+MqttUplink::MqttUplink(Stream& modem, const char* b, const char* id,
+                       const char* u, const char* p, const char* t, RowFormatFn fn,
+                       uint8_t q)
+    : io(modem), broker(b), clientId(id), user(u), pass(p), topic(t), format(fn),
+      qos(q ? 1 : 0), connected(false), linger(false) {}
+
+IpdDemux::Kind MqttUplink::pump(uint8_t b) {
+    uint8_t pb;
+    IpdDemux::Kind k = lines.feed(b, &pb);
+    if (k != IpdDemux::LINE) return k;
+
+    const char* l = lines.line();
+    if (!strncmp(l, "+CMQTTPUB: 0,", 13)) {             // PUBACK (or its timeout)
+        int err = atoi(l + 13);
+        if (qos) inflight.answer(err == 0 ? UP_OK : UP_FAILED);     // QoS 0: already counted
+        if (err) LOG_WARN("[MQTT] publish error %d", err);
+    } else if (!strncmp(l, "+CMQTTCONNLOST: 0", 17) || !strncmp(l, "+CMQTTNONET", 11)) {
+        connected = false;
+        LOG_WARN("[MQTT] %s", l);
+    }
+    return k;
+}
+
+int MqttUplink::waitFor(const char* ok, const char* err, uint32_t to, bool prompt) {
+    wdCheckpoint(WD_MODEM, to + WD_SLACK_MS, to / 1000);
+    uint32_t t0 = millis();
+    while (millis() - t0 < to) {
+        while (io.available()) {
+            IpdDemux::Kind k = pump((uint8_t)io.read());
+            if (k == IpdDemux::PROMPT && prompt) return 1;
+            if (k != IpdDemux::LINE) continue;
+            const char* l = lines.line();
+            if (ok && !strncmp(l, ok, strlen(ok))) return 1;
+            if (err && !strncmp(l, err, strlen(err))) return 0;
+            if (!strcmp(l, "ERROR")) return 0;
+        }
+    }
+    return -1;                                  // timeout
+}
+
+void MqttUplink::command(const char* cmd) {
+    LOG_DEBUG("[MQTT] >> %s", cmd);
+    io.print(cmd);
+    io.print("\r\n");
+}
+
+bool MqttUplink::block(const char* cmd, const char* data, size_t n) {
+    command(cmd);
+    if (waitFor(nullptr, nullptr, 5000, true) != 1) return false;
+    io.write((const uint8_t*)data, n);
+    return waitFor("OK", nullptr, 5000) == 1;
+}
+
+bool MqttUplink::connect() {
+    EnergyScope es(EN_UPLOAD);
+    command("AT+CMQTTSTART");                   // "+CMQTTSTART: 23" = already running,
+    if (waitFor("+CMQTTSTART:", nullptr, 10000) == 1 && atoi(lines.line() + 12) == 23)
+        waitFor("ERROR", nullptr, 1000);        // and an ERROR of its own follows
+
+    char cmd[192];
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTACCQ=0,\"%s\"", clientId);
+    command(cmd);
+    waitFor("OK", nullptr, 3000);               // ERROR: client 0 still held, fine
+
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTCONNECT=0,\"%s\",%u,0,\"%s\",\"%s\"",
+             broker, MQTT_KEEPALIVE_S, user, pass);
+    command(cmd);
+    if (waitFor("+CMQTTCONNECT: 0,0", "+CMQTTCONNECT: 0,", 30000) != 1) {
+        LOG_WARN("[MQTT] connect to %s failed", broker);
+        return false;
+    }
+    connected = true;
+    return true;
+}
+
+void MqttUplink::disconnect() {
+    command("AT+CMQTTDISC=0,60");
+    waitFor("+CMQTTDISC: 0,", nullptr, 5000);
+    command("AT+CMQTTREL=0");
+    waitFor("OK", nullptr, 2000);
+    command("AT+CMQTTSTOP");
+    waitFor("+CMQTTSTOP:", nullptr, 5000);
+    connected = false;
+}
+
+bool MqttUplink::begin() {
+    inflight.clear();
+    if (connected) {
+        /* held since the last drain: catch a CONNLOST that came in
+         * meanwhile, then ask the modem whether the session is up */
+        poll();
+        if (connected) {
+            command("AT+CMQTTCONNECT?");
+            int up = waitFor("+CMQTTCONNECT: 0,\"", "+CMQTTCONNECT: 0", 3000);
+            waitFor("OK", nullptr, 1000);
+            if (up == 1) return true;
+            connected = false;
+        }
+    }
+    return connect();
+}
+
+size_t MqttUplink::encode(const char* row, char* out, size_t cap) {
+    TextBuf tb(out, cap);
+    if (!format(row, tb)) return 0;
+    return tb.ok ? tb.len : 0;
+}
+
+bool MqttUplink::post(const char* wire, size_t len) {
+    EnergyScope es(EN_UPLOAD);
+    if (inflight.full()) return false;
+    paceWait();
+    poll();                                     // a CONNLOST behind the last OK
+    if (!connected) {
+        /* QoS 1: a new session would leave earlier PUBACKs unmatched */
+        if (inflight.received() < inflight.count()) return false;
+        if (!connect()) return false;
+    }
+
+    char cmd[40];
+    size_t tlen = strlen(topic);
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTTOPIC=0,%u", (unsigned)tlen);
+    bool ok = block(cmd, topic, tlen);
+    snprintf(cmd, sizeof(cmd), "AT+CMQTTPAYLOAD=0,%u", (unsigned)len);
+    ok = ok && block(cmd, wire, len);
+    if (ok) {
+        snprintf(cmd, sizeof(cmd), "AT+CMQTTPUB=0,%u,%u", qos, MQTT_PUB_TIMEOUT_S);
+        command(cmd);
+        ok = waitFor("OK", nullptr, 5000) == 1;
+    }
+    if (!ok) {
+        LOG_WARN("[MQTT] publish not accepted by modem");
+        connected = false;
+        return false;
+    }
+    inflight.sent();
+    if (!qos) inflight.answer(UP_OK);           // accepted is as far as QoS 0 goes
+    return true;
+}
+
+void MqttUplink::poll() {
+    while (io.available()) pump((uint8_t)io.read());
+}
+
+uint8_t MqttUplink::collect(UploadResult* res, uint8_t n) {
+    EnergyScope es(EN_UPLOAD);
+    uint8_t want = inflight.awaiting(n);
+
+    /* the modem reports every publish, acked or timed out; at QoS 0
+     * each row was answered when it was posted */
+    uint32_t t0 = millis();
+    poll();
+    while (inflight.received() < want && connected &&
+           millis() - t0 < (MQTT_PUB_TIMEOUT_S + 5) * 1000UL)
+        poll();
+
+    uint8_t filled = inflight.fill(res, n);
+    inflight.clear();
+    return filled;
+}
+
+void MqttUplink::end() {
+    if (connected && !linger) disconnect();
+    inflight.clear();
+}
@@ -0,0 +1,59 @@
+#include "nodeframe.h"
+
+static inline int16_t rdI16(const uint8_t* p) {
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void wrI16(uint8_t* p, int16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+bool nodeFrameDecode(const uint8_t* p, size_t n, NodeFrame& f) {
+    if (n < 3 || p[0] != NODE_FRAME_V1) return false;
+    uint8_t d = p[2];
+    if (!d || d > NODE_MAX_DEPTHS || n != (size_t)(3 + 4 * d + 2)) return false;
+
+    f.seq    = p[1];
+    f.depths = d;
+    const uint8_t* q = p + 3;
+    for (uint8_t i = 0; i < d; ++i, q += 2) f.temp[i]  = rdI16(q);
+    for (uint8_t i = 0; i < d; ++i, q += 2) f.moist[i] = rdI16(q);
+    f.battery_mV = (uint16_t)rdI16(q);
+    return true;
+}
+
+size_t nodeFrameEncode(const NodeFrame& f, uint8_t* out, size_t cap) {
+    if (!f.depths || f.depths > NODE_MAX_DEPTHS) return 0;
+    size_t n = 3 + 4 * f.depths + 2;
+    if (n > cap) return 0;
+
+    out[0] = NODE_FRAME_V1;
+    out[1] = f.seq;
+    out[2] = f.depths;
+    uint8_t* q = out + 3;
+    for (uint8_t i = 0; i < f.depths; ++i, q += 2) wrI16(q, f.temp[i]);
+    for (uint8_t i = 0; i < f.depths; ++i, q += 2) wrI16(q, f.moist[i]);
+    wrI16(q, (int16_t)f.battery_mV);
+    return n;
+}
+
+bool nodeFrameRow(const NodeFrame& f, const char* date, const char* time, TextBuf& out) {
+    out.add(date).add('\t').add(time).add('\t');
+    out.add('N').addUint(f.addr).add('\t');
+    for (uint8_t i = 0; i < f.depths; ++i) {
+        if (i) out.add(',');
+        addFixed(out, f.temp[i], 2);
+    }
+    out.add('\t');
+    for (uint8_t i = 0; i < f.depths; ++i) {
+        if (i) out.add(',');
+        addFixed(out, f.moist[i], 2);
+    }
+    out.add('\t');
+    addFixed(out, f.rssi, 0);
+    out.add(',');
+    addFixed(out, f.snr, 0);
+    out.add(',').addUint(f.battery_mV);
+    return out.ok;
+}
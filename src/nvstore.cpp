@@ -0,0 +1,184 @@
+#include <string.h>
+#include "nvstore.h"
+#include "record.h"
+
+static const uint16_t NV_MAGIC = 0x564E;             // "NV"
+static const uint16_t PAGES    = NVSTORE_ROWS * (NVSTORE_ROW / NVSTORE_PAGE);
+
+struct NvPage {
+    uint32_t seq;
+    uint16_t magic;
+    uint16_t len;
+    uint8_t  data[NVSTORE_DATA_MAX];
+    uint32_t crc;                                   // over everything before it
+};
+static_assert(sizeof(NvPage) == NVSTORE_PAGE, "one record per flash page");
+
+#ifdef ARDUINO_ARCH_SAMD
+/* ======================================================== */
+/* |------------------------ FLASH -----------------------| */
+/* ======================================================== */
+#include <Arduino.h>
+
+/* Row-aligned and zero in the image; zero pages fail the CRC, so each
+ * upload starts with no state. Read back through a volatile pointer so
+ * the compiler does not fold the reads into the initialiser. */
+__attribute__((aligned(NVSTORE_ROW)))
+static const uint8_t area[NVSTORE_ROWS * NVSTORE_ROW] = {};
+
+static void nvmWait() {
+    while (!NVMCTRL->INTFLAG.bit.READY);
+}
+
+static void flashRead(uint16_t page, NvPage& p) {
+    const volatile uint32_t* src = (const volatile uint32_t*)(area + page * NVSTORE_PAGE);
+    uint32_t* dst = (uint32_t*)&p;
+    for (uint8_t i = 0; i < NVSTORE_PAGE / 4; ++i) dst[i] = src[i];
+}
+
+static void flashEraseRow(uint16_t row) {
+    NVMCTRL->ADDR.reg = (uint32_t)(area + row * NVSTORE_ROW) / 2;   // 16-bit word address
+    NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
+    nvmWait();
+}
+
+/* Page buffer filled a word at a time, then written by hand (MANW):
+ * the page is never left half in the buffer with automatic writes */
+static void flashWrite(uint16_t page, const NvPage& p) {
+    volatile uint32_t* dst = (volatile uint32_t*)(area + page * NVSTORE_PAGE);
+    const uint32_t* src = (const uint32_t*)&p;
+    NVMCTRL->CTRLB.bit.MANW = 1;
+    NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_PBC;
+    nvmWait();
+    for (uint8_t i = 0; i < NVSTORE_PAGE / 4; ++i) dst[i] = src[i];
+    NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_WP;
+    nvmWait();
+}
+
+#else
+/* ======================================================== */
+/* |------------------------ HOST ------------------------| */
+/* ======================================================== */
+#include <stdio.h>
+
+static char path[256] = "NVSTATE.BIN";
+
+/* Missing file: an erased area. Writes AND into the old bytes as
+ * flash does, so writing an unerased page shows up as it would. */
+static void flashRead(uint16_t page, NvPage& p) {
+    memset(&p, 0xFF, sizeof(p));
+    FILE* f = fopen(path, "rb");
+    if (!f) return;
+    if (fseek(f, (long)page * NVSTORE_PAGE, SEEK_SET) == 0) fread(&p, 1, sizeof(p), f);
+    fclose(f);
+}
+
+static void flashPut(uint32_t at, const uint8_t* b, size_t n) {
+    FILE* f = fopen(path, "r+b");
+    if (!f) {
+        f = fopen(path, "w+b");
+        if (!f) return;
+        for (uint32_t i = 0; i < (uint32_t)NVSTORE_ROWS * NVSTORE_ROW; ++i) fputc(0xFF, f);
+    }
+    fseek(f, at, SEEK_SET);
+    fwrite(b, 1, n, f);
+    fclose(f);
+}
+
+static void flashEraseRow(uint16_t row) {
+    uint8_t ones[NVSTORE_ROW];
+    memset(ones, 0xFF, sizeof(ones));
+    flashPut((uint32_t)row * NVSTORE_ROW, ones, sizeof(ones));
+}
+
+static void flashWrite(uint16_t page, const NvPage& p) {
+    NvPage old;
+    flashRead(page, old);
+    uint8_t* o = (uint8_t*)&old;
+    const uint8_t* n = (const uint8_t*)&p;
+    for (uint8_t i = 0; i < NVSTORE_PAGE; ++i) o[i] &= n[i];
+    flashPut((uint32_t)page * NVSTORE_PAGE, o, NVSTORE_PAGE);
+}
+#endif
+
+/* ======================================================== */
+/* |------------------------- LOG ------------------------| */
+/* ======================================================== */
+static bool     scanned = false;
+static int32_t  newest  = -1;                       // page of the current state
+static uint32_t seq     = 0;
+
+static bool pageValid(const NvPage& p) {
+    return p.magic == NV_MAGIC && p.len <= NVSTORE_DATA_MAX
+           && p.crc == crc32(&p, offsetof(NvPage, crc));
+}
+
+/* Newest valid page; sequence numbers only grow, so the largest wins */
+static void scan() {
+    if (scanned) return;
+    scanned = true;
+    NvPage p;
+    for (uint16_t i = 0; i < PAGES; ++i) {
+        flashRead(i, p);
+        if (pageValid(p) && (newest < 0 || p.seq > seq)) {
+            newest = i;
+            seq = p.seq;
+        }
+    }
+}
+
+bool nvstoreLoad(void* data, size_t n) {
+    scan();
+    if (newest < 0) return false;
+    NvPage p;
+    flashRead(newest, p);
+    if (!pageValid(p) || p.len != n) return false;  // layout changed: start afresh
+    memcpy(data, p.data, n);
+    return true;
+}
+
+bool nvstoreCommit(const void* data, size_t n) {
+    if (n > NVSTORE_DATA_MAX) return false;
+    scan();
+
+    NvPage p;
+    if (newest >= 0) {                              // unchanged: spare the flash
+        flashRead(newest, p);
+        if (pageValid(p) && p.len == n && !memcmp(p.data, data, n)) return true;
+    }
+
+    memset(&p, 0, sizeof(p));
+    p.seq   = seq + 1;
+    p.magic = NV_MAGIC;
+    p.len   = n;
+    memcpy(p.data, data, n);
+    p.crc   = crc32(&p, offsetof(NvPage, crc));
+
+    /* A page that does not read back (left half-written by a reset
+     * before it was erased) is passed over; the next row start erases */
+    uint16_t at = newest < 0 ? 0 : (newest + 1) % PAGES;
+    for (uint8_t tries = 0; tries <= NVSTORE_ROW / NVSTORE_PAGE; ++tries) {
+        if (at % (NVSTORE_ROW / NVSTORE_PAGE) == 0) flashEraseRow(at / (NVSTORE_ROW / NVSTORE_PAGE));
+        flashWrite(at, p);
+        NvPage back;
+        flashRead(at, back);
+        if (!memcmp(&back, &p, sizeof(p))) {
+            newest = at;
+            seq = p.seq;
+            return true;
+        }
+        at = (at + 1) % PAGES;
+    }
+    return false;
+}
+
+#if !defined(ARDUINO_ARCH_SAMD)
+/* Like a power-up on that flash: the next call scans it afresh */
+void nvstoreFile(const char* p) {
+    strncpy(path, p, sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+    scanned = false;
+    newest = -1;
+    seq = 0;
+}
+#endif
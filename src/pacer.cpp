@@ -0,0 +1,39 @@
+#include "pacer.h"
+
+RatePacer::RatePacer(uint32_t p, uint8_t b)
+    : periodMs(p), burst(b ? b : 1), tokens(b ? b : 1), since(0) {}
+
+void RatePacer::setPeriod(uint32_t p) {
+    periodMs = p;
+}
+
+void RatePacer::refill(uint32_t now) {
+    if (!periodMs) { tokens = burst; return; }
+    uint32_t add = (now - since) / periodMs;
+    if (!add) return;
+    if (tokens + add >= burst) {
+        tokens = burst;
+        since = now;                            // a full bucket does not bank time
+    } else {
+        tokens += add;
+        since += add * periodMs;
+    }
+}
+
+uint32_t RatePacer::waitMs(uint32_t now) {
+    refill(now);
+    if (tokens) return 0;
+    uint32_t gone = now - since;
+    return gone < periodMs ? periodMs - gone : 1;
+}
+
+void RatePacer::take(uint32_t now) {
+    refill(now);
+    if (tokens == burst) since = now;           // the period starts with this request
+    if (tokens) tokens--;
+}
+
+void RatePacer::backoff(uint32_t now) {
+    tokens = 0;
+    since = now;
+}
@@ -0,0 +1,89 @@
+#include "rcvparser.h"
+
+static const char PREFIX[] = "+RCV=";
+static const uint8_t PREFIX_LEN = sizeof(PREFIX) - 1;
+
+RcvParser::RcvParser(FrameFn f, void* c)
+    : fn(f), ctx(c), nFrames(0), nErrors(0) {
+    reset();
+}
+
+void RcvParser::reset() {
+    st = MATCH;
+    matched = 0;
+    digits = 0;
+    neg = false;
+    addr = len = rssi = snr = 0;
+    got = 0;
+}
+
+void RcvParser::fail(uint8_t b) {
+    nErrors++;
+    reset();
+    if (b == '+') matched = 1;              // may be the start of the next line
+}
+
+/* Accumulate one decimal digit; false if b isn't part of the number */
+bool RcvParser::digit(uint8_t b, int32_t& acc, bool allowSign) {
+    if (b == '-' && allowSign && !digits && !neg) {
+        neg = true;
+        return true;
+    }
+    if (b < '0' || b > '9' || digits >= 6) return false;
+    acc = acc * 10 + (b - '0');
+    digits++;
+    return true;
+}
+
+void RcvParser::feed(uint8_t b) {
+    switch (st) {
+    case MATCH:
+        if (b == (uint8_t)PREFIX[matched]) {
+            if (++matched == PREFIX_LEN) { st = ADDR; digits = 0; }
+        } else {
+            matched = (b == '+') ? 1 : 0;
+        }
+        return;
+
+    case ADDR:
+        if (b == ',' && digits) { st = LEN; digits = 0; return; }
+        if (!digit(b, addr, false) || addr > 65535) fail(b);
+        return;
+
+    case LEN:
+        if (b == ',' && digits) {
+            if (len > RCV_PAYLOAD_MAX) { fail(b); return; }
+            st = DATA;
+            return;
+        }
+        if (!digit(b, len, false)) fail(b);
+        return;
+
+    case DATA:
+        if (got < len) { data[got++] = b; return; }
+        if (b != ',') { fail(b); return; }   // <len> didn't match what was sent
+        st = RSSI; digits = 0; neg = false;
+        return;
+
+    case RSSI:
+        if (b == ',' && digits) {
+            if (neg) rssi = -rssi;
+            st = SNR; digits = 0; neg = false;
+            return;
+        }
+        if (!digit(b, rssi, true)) fail(b);
+        return;
+
+    case SNR:
+        if ((b == '\r' || b == '\n') && digits) {
+            if (neg) snr = -snr;
+            RcvFrame f{(uint16_t)addr, (int16_t)rssi, (int16_t)snr, (uint8_t)len, data};
+            nFrames++;
+            reset();
+            fn(f, ctx);
+            return;
+        }
+        if (!digit(b, snr, true)) fail(b);
+        return;
+    }
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <string.h>
+#include "record.h"
+
+/* Nibble-wide table: 64 bytes of flash instead of 1 KB */
+static const uint32_t CRC_NIBBLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t crc32(const void* data, size_t n, uint32_t crc) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (n--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC_NIBBLE[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static int hexVal(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseHex(const char* s, uint8_t digits, uint32_t& v) {
+    v = 0;
+    for (uint8_t i = 0; i < digits; ++i) {
+        int d = hexVal(s[i]);
+        if (d < 0) return false;
+        v = (v << 4) | (uint32_t)d;
+    }
+    return true;
+}
+
+bool recordFrame(const char* row, char* out, size_t cap) {
+    size_t n = strlen(row);
+    if (n > 0xFFF || n + RECORD_OVERHEAD + 1 > cap) return false;
+    snprintf(out, cap, "@%03X:%08lX:", (unsigned)n, (unsigned long)crc32(row, n));
+    memcpy(out + RECORD_OVERHEAD, row, n + 1);
+    return true;
+}
+
+RecordCheck recordCheck(char* line, char** row) {
+    if (line[0] != '@') {
+        if (line[0] == '#' || !line[0]) return REC_BAD;    // neutralised torn write
+        *row = line;
+        return REC_LEGACY;
+    }
+
+    uint32_t n, crc;
+    if (!parseHex(line + 1, 3, n) || line[4] != ':' ||
+        !parseHex(line + 5, 8, crc) || line[13] != ':')
+        return REC_BAD;
+
+    char* p = line + RECORD_OVERHEAD;
+    if (strlen(p) != n || crc32(p, n) != crc) return REC_BAD;
+    *row = p;
+    return REC_OK;
+}
@@ -0,0 +1,34 @@
+#include "sample.h"
+
+bool sampleParse(const char* csv, int32_t* out, uint8_t max, uint8_t& n) {
+    const char* p = csv;
+    n = 0;
+    while (*p && n < max) {
+        while (*p == ' ') ++p;
+        if (!parseFixed(p, 2, out[n])) return false;
+        n++;
+        while (*p == ' ') ++p;
+        if (*p == ',') ++p;
+        else if (*p) return false;
+    }
+    return true;
+}
+
+bool sampleRow(const Sample& s, uint8_t types, const char* date, const char* time,
+               TextBuf& out) {
+    out.add(date).add('\t').add(time).add('\t');
+    formatFix(s.fix, out);
+    out.add('\t');
+
+    for (uint8_t t = 0; t < types && t < INGEST_TYPES_MAX; ++t) {
+        for (uint8_t d = 0; d < s.depths[t]; ++d) {
+            if (d) out.add(',');
+            addFixed(out, s.value[t][d], 2);
+        }
+        out.add('\t');
+    }
+
+    addFixed(out, s.irAir_dC, 1);
+    out.add(',');
+    return addFixed(out, s.irSurface_dC, 1);
+}
@@ -0,0 +1,171 @@
+#include <Arduino.h>
+#include "sdlog.h"
+#include "energy.h"
+#include "log.h"
+#include "storage.h"
+
+bool sdInit();                              // jacob-main.cpp
+
+uint32_t sdlogMaxAgeMs = 60000;
+
+static const char     WAL_FILE[] = "WAL.DAT";
+static const uint32_t WAL_MAGIC  = 0x314C4157;      // "WAL1"
+
+/* --- WRITE-AHEAD MARKER --- */
+struct WalMarker {
+    uint32_t magic;
+    char     name[13];
+    uint8_t  committed;         // 0 while the write is in flight
+    uint32_t before;            // rows' end before the write
+    uint32_t len;               // bytes being written
+};
+
+static char     buf[SDLOG_SECTOR];
+static uint16_t used = 0;
+static uint32_t firstAt = 0;    // millis() of the oldest buffered byte
+static char     curName[13] = "";
+static StoreFile cur;
+static uint32_t curEnd = 0;     // end of the rows; a preallocated tail follows
+static bool     open_ = false;
+static StoreFile wal;           // kept open with the day file
+
+/* The marker is fixed-size: overwrite it in place, so each write is one
+ * data sector and no FAT or directory churn */
+static void writeMarker(const WalMarker& m) {
+    if (!wal) wal = storeOpen(WAL_FILE, ST_RW);
+    if (!wal) return;
+    wal.seek(0);
+    wal.write(&m, sizeof(m));
+    wal.flush();
+}
+
+static void closeMarker() {
+    if (wal) wal.close();
+    wal = StoreFile();
+}
+
+static bool ensureOpen(const char* name) {
+    if (open_ && !strcmp(name, curName)) return true;
+    sdlogClose();
+    if (!sdInit()) return false;
+    cur = storeOpen(name, ST_RW);
+    if (!cur) return false;
+    curEnd = cur.size();
+    strncpy(curName, name, sizeof(curName) - 1);
+    curName[sizeof(curName) - 1] = '\0';
+    open_ = true;
+
+    /* new file: one contiguous run. Its size is now the whole run, so
+     * until close truncates it the marker is what says where rows end */
+    if (!curEnd && cur.preallocate(SDLOG_PREALLOC)) {
+        WalMarker m{WAL_MAGIC, {0}, 1, 0, 0};
+        strcpy(m.name, curName);
+        writeMarker(m);
+    }
+    return true;
+}
+
+/* ======================================================== */
+bool sdlogAppend(const char* file, const char* row) {
+    size_t n = strlen(row);
+    if (n + 2 > SDLOG_SECTOR) return false;
+
+    if (strcmp(file, curName)) sdlogClose();    // different day: write out the old one
+    if (used + n + 2 > SDLOG_SECTOR) sdlogFlush();
+    if (!ensureOpen(file)) return false;
+
+    if (!used) firstAt = millis();
+    memcpy(buf + used, row, n);
+    used += n;
+    buf[used++] = '\r';
+    buf[used++] = '\n';
+    return true;
+}
+
+bool sdlogFlush() {
+    if (!used) return true;
+    if (!open_) return false;
+    EnergyScope es(EN_SD);
+
+    WalMarker m{WAL_MAGIC, {0}, 0, curEnd, used};
+    strcpy(m.name, curName);
+    writeMarker(m);
+
+    cur.seek(curEnd);
+    size_t w = cur.write(buf, used);
+    cur.flush();                                // data + directory entry
+    if (w != used) {
+        LOG_ERROR("sdlog: short write %u/%u to %s", (unsigned)w, used, curName);
+        return false;                           // marker stays uncommitted
+    }
+
+    m.committed = 1;
+    writeMarker(m);
+    curEnd += used;
+    used = 0;
+    return true;
+}
+
+void sdlogClose() {
+    sdlogFlush();
+    if (open_) {
+        if (cur.size() > curEnd) cur.truncate(curEnd);  // preallocated tail
+        cur.close();
+    }
+    open_ = false;
+    curName[0] = '\0';
+    closeMarker();
+}
+
+void sdlogService() {
+    if (used && millis() - firstAt >= sdlogMaxAgeMs) sdlogFlush();
+}
+
+/* Cut the file the marker names back to where its rows end: a day file
+ * open at the brownout still carries its preallocated tail. Of an
+ * interrupted write, the complete rows are kept and a partial last row
+ * becomes a '#' line readers skip; if the tail was preallocated there
+ * is no telling written bytes from stale ones and the write is dropped. */
+void sdlogRecover() {
+    EnergyScope es(EN_SD);
+    if (!sdInit()) return;
+
+    StoreFile w = storeOpen(WAL_FILE, ST_READ);
+    if (!w) return;
+    WalMarker m;
+    bool valid = w.read(&m, sizeof(m)) == sizeof(m) && m.magic == WAL_MAGIC
+                 && m.name[sizeof(m.name) - 1] == '\0';
+    w.close();
+    if (!valid || !storeExists(m.name)) return;
+
+    StoreFile f = storeOpen(m.name, ST_RW);
+    if (!f) return;
+    uint32_t size = f.size();
+    uint32_t end = m.before + m.len;
+    if (!m.committed && size > end) {
+        end = m.before;
+        LOG_WARN("sdlog: interrupted write to %s at %lu dropped", m.name, (unsigned long)end);
+    } else if (!m.committed && size > m.before && size < end) {
+        /* find the end of the last complete row inside the torn region */
+        uint32_t keep = m.before;
+        f.seek(m.before);
+        for (uint32_t pos = m.before; pos < size; ++pos)
+            if (f.read() == '\n') keep = pos + 1;
+
+        if (keep < size) {
+            f.seek(keep);
+            for (uint32_t pos = keep; pos + 1 < size; ++pos) f.write('#');
+            f.write('\n');
+            LOG_WARN("sdlog: torn row in %s at %lu neutralised", m.name, (unsigned long)keep);
+        }
+    }
+    if (size > end) f.truncate(end);
+    f.close();
+
+    if (!m.committed) {
+        m.committed = 1;
+        m.len = end - m.before;
+        writeMarker(m);
+    }
+    closeMarker();
+}
@@ -0,0 +1,246 @@
+#include <string.h>
+#include "storage.h"
+
+#ifdef ARDUINO
+/* ======================================================== */
+/* |---------------------- SdFat ------------------------| */
+/* ======================================================== */
+#include "dmaspi.h"
+
+static SdFs sd;
+static bool mounted = false;
+
+/* The card is the only device on the bus: DEDICATED_SPI keeps it
+ * selected across calls, which is what lets SdFat stream
+ * multi-block reads and writes. 12 MHz is the SAMD21's SPI limit. */
+#if defined(ARDUINO_ARCH_SAMD) && SPI_DRIVER_SELECT == 3
+static DmaSpi spi;
+#define STORE_SPI(cs) SdSpiConfig(cs, DEDICATED_SPI, SD_SCK_MHZ(12), &spi)
+#else
+#define STORE_SPI(cs) SdSpiConfig(cs, DEDICATED_SPI, SD_SCK_MHZ(12))
+#endif
+
+bool storeBegin(uint8_t csPin) {
+    if (!mounted) mounted = sd.begin(STORE_SPI(csPin));
+    return mounted;
+}
+
+bool storeExists(const char* name) {
+    return mounted && sd.exists(name);
+}
+
+bool storeRemove(const char* name) {
+    return mounted && sd.remove(name);
+}
+
+StoreFile storeOpen(const char* name, StoreMode mode) {
+    static const oflag_t FLAGS[] = {
+        O_RDONLY,                               // ST_READ
+        O_RDWR | O_CREAT,                       // ST_RW
+        O_RDWR | O_CREAT | O_APPEND,            // ST_APPEND
+        O_RDWR | O_CREAT | O_TRUNC,             // ST_TRUNC
+    };
+    StoreFile s;
+    if (mounted) s.f = sd.open(name, FLAGS[mode]);
+    return s;
+}
+
+StoreFile::StoreFile() {}
+
+StoreFile::operator bool() const { return f.isOpen(); }
+int      StoreFile::read() { return f.read(); }
+int      StoreFile::read(void* buf, size_t n) { return f.read(buf, n); }
+size_t   StoreFile::write(const void* p, size_t n) { return f.write(p, n); }
+bool     StoreFile::seek(uint32_t pos) { return f.seekSet(pos); }
+uint32_t StoreFile::position() { return (uint32_t)f.curPosition(); }
+uint32_t StoreFile::size() { return (uint32_t)f.fileSize(); }
+void     StoreFile::flush() { f.sync(); }
+void     StoreFile::close() { f.close(); }
+
+bool StoreFile::preallocate(uint32_t bytes) {
+    return f.fileSize() == 0 && f.preAllocate(bytes);
+}
+
+bool StoreFile::truncate(uint32_t size) {
+    return f.truncate(size);
+}
+
+StoreDir::StoreDir() {}
+
+bool StoreDir::open() {
+    return mounted && dir.open("/", O_RDONLY);
+}
+
+bool StoreDir::next(char* name, size_t cap, uint32_t* size) {
+    FsFile e;
+    while (e.openNext(&dir, O_RDONLY)) {
+        bool file = !e.isDir();
+        if (file) {
+            e.getName(name, cap);
+            if (size) *size = (uint32_t)e.fileSize();
+        }
+        e.close();
+        if (file) return true;
+    }
+    return false;
+}
+
+void StoreDir::close() {
+    dir.close();
+}
+
+#else
+/* ======================================================== */
+/* |------------------- HOST DIRECTORY -------------------| */
+/* ======================================================== */
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char root[256] = ".";
+
+void storeRoot(const char* d) {
+    strncpy(root, d, sizeof(root) - 1);
+    root[sizeof(root) - 1] = '\0';
+}
+
+/* nullptr if root/name does not fit: a cut path could name another file */
+static const char* hostPath(const char* name, char* out, size_t cap) {
+    int n = snprintf(out, cap, "%s/%s", root, name);
+    return n >= 0 && (size_t)n < cap ? out : nullptr;
+}
+
+bool storeBegin(uint8_t) {
+    struct stat st;
+    return stat(root, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool storeExists(const char* name) {
+    char buf[320];
+    const char* p = hostPath(name, buf, sizeof(buf));
+    struct stat st;
+    return p && stat(p, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool storeRemove(const char* name) {
+    char buf[320];
+    const char* p = hostPath(name, buf, sizeof(buf));
+    return p && remove(p) == 0;
+}
+
+StoreFile storeOpen(const char* name, StoreMode mode) {
+    char buf[320];
+    const char* p = hostPath(name, buf, sizeof(buf));
+    StoreFile s;
+    if (!p) return s;
+    switch (mode) {
+    case ST_READ:   s.f = fopen(p, "rb"); break;
+    case ST_RW:     if (!(s.f = fopen(p, "r+b"))) s.f = fopen(p, "w+b"); break;
+    case ST_APPEND: s.f = fopen(p, "a+b"); break;
+    case ST_TRUNC:  s.f = fopen(p, "w+b"); break;
+    }
+    return s;
+}
+
+/* stdio wants a seek between a read and a write on the same stream;
+ * the card does not, so it is done here */
+StoreFile::StoreFile() : f(nullptr), lastOp(0) {}
+
+StoreFile::operator bool() const { return f != nullptr; }
+
+static void turn(FILE* f, uint8_t& last, uint8_t op) {
+    if (last && last != op) fseek(f, 0, SEEK_CUR);
+    last = op;
+}
+
+int StoreFile::read() {
+    turn(f, lastOp, 'r');
+    int c = fgetc(f);
+    return c == EOF ? -1 : c;
+}
+
+int StoreFile::read(void* buf, size_t n) {
+    turn(f, lastOp, 'r');
+    size_t got = fread(buf, 1, n, f);
+    return got == 0 && ferror(f) ? -1 : (int)got;
+}
+
+size_t StoreFile::write(const void* p, size_t n) {
+    turn(f, lastOp, 'w');
+    return fwrite(p, 1, n, f);
+}
+
+bool StoreFile::seek(uint32_t pos) {
+    lastOp = 0;
+    return fseek(f, pos, SEEK_SET) == 0;
+}
+
+uint32_t StoreFile::position() {
+    return (uint32_t)ftell(f);
+}
+
+uint32_t StoreFile::size() {
+    struct stat st;
+    fflush(f);
+    return fstat(fileno(f), &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+
+/* A host file system places blocks itself; what is copied here is the
+ * card's side effect, a file that reads as stale data up to its new
+ * size, so code that forgets its real end shows up in the tests */
+bool StoreFile::preallocate(uint32_t bytes) {
+    static const char STALE[] = "stale\trow\r\n";
+    if (size()) return false;
+    for (uint32_t left = bytes; left; ) {
+        size_t n = left < sizeof(STALE) - 1 ? left : sizeof(STALE) - 1;
+        if (write(STALE, n) != n) return false;
+        left -= n;
+    }
+    return seek(0);
+}
+
+bool StoreFile::truncate(uint32_t size) {
+    fflush(f);
+    lastOp = 0;
+    return ftruncate(fileno(f), size) == 0;
+}
+
+void StoreFile::flush() {
+    fflush(f);
+}
+
+void StoreFile::close() {
+    if (f) fclose(f);
+    f = nullptr;
+}
+
+StoreDir::StoreDir() : dir(nullptr) {}
+
+bool StoreDir::open() {
+    dir = opendir(root);
+    return dir != nullptr;
+}
+
+bool StoreDir::next(char* name, size_t cap, uint32_t* size) {
+    if (!dir) return false;
+    while (struct dirent* e = readdir(dir)) {
+        char buf[320];
+        const char* p = hostPath(e->d_name, buf, sizeof(buf));
+        struct stat st;
+        if (!p || stat(p, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        snprintf(name, cap, "%s", e->d_name);
+        if (size) *size = (uint32_t)st.st_size;
+        return true;
+    }
+    return false;
+}
+
+void StoreDir::close() {
+    if (dir) closedir(dir);
+    dir = nullptr;
+}
+#endif
+
+size_t StoreFile::println(const char* s) {
+    size_t n = write(s, strlen(s));
+    return n + write("\r\n", 2);
+}
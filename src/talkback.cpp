@@ -0,0 +1,106 @@
+#include "talkback.h"
+#include "config.h"
+#include "log.h"
+#include "watchdog.h"
+
+static void command(Stream& io, const char* cmd) {
+    LOG_DEBUG("[TB] >> %s", cmd);
+    io.print(cmd);
+    io.print("\r\n");
+}
+
+/* Read lines until one contains want (kept in line): 1, an ERROR
+ * line: 0, timeout: -1 */
+static int waitFor(Stream& io, const char* want, char* line, size_t cap, uint32_t to) {
+    wdCheckpoint(WD_MODEM, to + WD_SLACK_MS, to / 1000);
+    size_t n = 0;
+    uint32_t t0 = millis();
+    while (millis() - t0 < to) {
+        while (io.available()) {
+            char c = (char)io.read();
+            if (c == '\r') continue;
+            if (c != '\n') {
+                if (n + 1 < cap) line[n++] = c;
+                continue;
+            }
+            line[n] = '\0';
+            n = 0;
+            if (strstr(line, want)) return 1;
+            if (strstr(line, "ERROR")) return 0;
+        }
+    }
+    return -1;
+}
+
+/* Exactly n raw bytes: the body may hold anything, CR/LF included */
+static bool readBody(Stream& io, char* out, size_t n, uint32_t to) {
+    size_t got = 0;
+    uint32_t t0 = millis();
+    while (got < n && millis() - t0 < to)
+        while (got < n && io.available()) out[got++] = (char)io.read();
+    out[got] = '\0';
+    return got == n;
+}
+
+static long execute(Stream& io, const char* url, char* out, size_t cap) {
+    char line[200];
+    command(io, "AT+HTTPINIT");
+    if (waitFor(io, "OK", line, sizeof(line), 5000) != 1) return -1;
+    command(io, "AT+HTTPPARA=\"CID\",1");
+    waitFor(io, "OK", line, sizeof(line), 2000);
+
+    char cmd[200];
+    snprintf(cmd, sizeof(cmd), "AT+HTTPPARA=\"URL\",\"%s\"", url);
+    command(io, cmd);
+    if (waitFor(io, "OK", line, sizeof(line), 2000) != 1) return -1;
+
+    /* +HTTPACTION: 0,<status>,<len> */
+    command(io, "AT+HTTPACTION=0");
+    if (waitFor(io, "+HTTPACTION:", line, sizeof(line), 30000) != 1) return -1;
+    unsigned method, status;
+    long len;
+    if (sscanf(strstr(line, "+HTTPACTION:") + 12, "%u,%u,%ld", &method, &status, &len) != 3 ||
+        status != 200 || len < 0) {
+        LOG_WARN("[TB] %s", line);
+        return -1;
+    }
+    if (!len || (size_t)len >= cap) return len;
+
+    /* +HTTPREAD: <n>\r\n<data>\r\n+HTTPREAD: 0 */
+    snprintf(cmd, sizeof(cmd), "AT+HTTPREAD=0,%ld", len);
+    command(io, cmd);
+    if (waitFor(io, "+HTTPREAD:", line, sizeof(line), 3000) != 1 ||
+        atol(strstr(line, "+HTTPREAD:") + 10) != len || !readBody(io, out, len, 3000))
+        return -1;
+    waitFor(io, "+HTTPREAD: 0", line, sizeof(line), 1000);
+    return len;
+}
+
+long talkbackExecute(Stream& io, const char* url, char* out, size_t cap) {
+    char line[64];
+    command(io, "AT+HTTPTERM");                 // ERROR if no session was open
+    waitFor(io, "OK", line, sizeof(line), 1000);
+    long len = execute(io, url, out, cap);
+    command(io, "AT+HTTPTERM");
+    waitFor(io, "OK", line, sizeof(line), 1000);
+    return len;
+}
+
+bool talkbackFetchConfig(Stream& io, const char* url) {
+    char blob[CONFIG_BLOB_MAX];
+    long len = talkbackExecute(io, url, blob, sizeof(blob));
+    if (len <= 0) return false;
+    if (len >= (long)sizeof(blob)) {
+        LOG_WARN("Remote config rejected: %ld bytes", len);
+        return false;
+    }
+
+    GatewayConfig c = config;
+    if (!configParse(blob, c)) {
+        LOG_WARN("Remote config rejected: %s", blob);
+        return false;
+    }
+    config = c;
+    if (!configSave()) LOG_WARN("Config not persisted");
+    return true;
+}
@@ -0,0 +1,305 @@
+#include "tcpuplink.h"
+#include "energy.h"
+#include "log.h"
+#include "watchdog.h"
+
+TcpUplink::TcpUplink(Stream& modem, const char* h, uint16_t p, RowFormatFn fn)
+    : TcpUplink(modem, h, p, fn, "+IPD") {}
+
+TcpUplink::TcpUplink(Stream& modem, const char* h, uint16_t p, RowFormatFn fn,
+                     const char* ipdPrefix)
+    : io(modem), host(h), port(p), path(fn), connected(false), linger(false),
+      lastUse(0), ipAt(0), demux(ipdPrefix), bulkFmt(nullptr), bulkN(0) {
+    ip[0] = '\0';
+}
+
+/* ThingSpeak answers an update with 200 and the new entry id; "0"
+ * means it came too soon and was not stored. A bulk update answers
+ * 202 {"success":true}. Too-soon rows are retried after a backoff. */
+UploadResult TcpUplink::judge(uint16_t status, const char* body) {
+    if (status >= 200 && status < 300) {
+        if (!strcmp(body, "0") || strstr(body, "\"success\":false")) {
+            paceRefused();
+            return UP_FAILED;
+        }
+        return UP_OK;
+    }
+    if (status == 429) { paceRefused(); return UP_FAILED; }
+    if (status == 408) return UP_FAILED;
+    if (status >= 400 && status < 500) return UP_REJECTED;
+    return UP_FAILED;
+}
+
+/* One UART byte: socket payload goes to the response parser, the
+ * link-state URCs are noted, anything else is handed back. */
+IpdDemux::Kind TcpUplink::pump(uint8_t b) {
+    uint8_t pb;
+    IpdDemux::Kind k = demux.feed(b, &pb);
+    if (k == IpdDemux::PAYLOAD) {
+        if (resp.feed(pb)) {
+            inflight.answer(judge(resp.status(), resp.body()));
+            LOG_DEBUG("%s << %u %s", tag(), resp.status(), resp.body());
+            if (resp.closing()) connected = false;
+            lastUse = millis();
+            resp.reset();
+        }
+    } else if (k == IpdDemux::LINE) {
+        if (closedBy(demux.line())) connected = false;
+    }
+    return k;
+}
+
+int TcpUplink::waitFor(const char* ok, const char* err, uint32_t to, bool prompt) {
+    wdCheckpoint(WD_MODEM, to + WD_SLACK_MS, to / 1000);
+    uint32_t t0 = millis();
+    while (millis() - t0 < to) {
+        while (io.available()) {
+            IpdDemux::Kind k = pump((uint8_t)io.read());
+            if (k == IpdDemux::PROMPT && prompt) return 1;
+            if (k != IpdDemux::LINE) continue;
+            const char* l = demux.line();
+            if (ok && strstr(l, ok)) return 1;
+            if (err && strstr(l, err)) return 0;
+            if (strstr(l, "ERROR")) return 0;
+        }
+    }
+    return -1;                                  // timeout
+}
+
+void TcpUplink::command(const char* cmd) {
+    LOG_DEBUG("%s >> %s", tag(), cmd);
+    io.print(cmd);
+    io.print("\r\n");
+}
+
+/* AT+CDNSGIP="host" → +CDNSGIP: 1,"host","a.b.c.d" */
+bool TcpUplink::resolve() {
+    if (ipAt && millis() - ipAt < TCP_DNS_TTL_MS) return true;
+
+    char cmd[80];
+    snprintf(cmd, sizeof(cmd), "AT+CDNSGIP=\"%s\"", host);
+    command(cmd);
+    if (waitFor("+CDNSGIP:", nullptr, 15000) != 1) return false;
+
+    const char* l = demux.line();
+    if (strncmp(l, "+CDNSGIP: 1", 11)) return false;
+    const char* q = strrchr(l, ',');
+    if (!q || q[1] != '"') return false;
+    q += 2;
+    size_t n = strcspn(q, "\"");
+    if (!n || n >= sizeof(ip)) return false;
+    memcpy(ip, q, n);
+    ip[n] = '\0';
+    ipAt = millis() | 1;
+    LOG_DEBUG("[TCP] %s = %s", host, ip);
+    return true;
+}
+
+/* --- plain TCP dialect --- */
+bool TcpUplink::open() {
+    /* either way the stack is up; "already opened" has an ERROR of its
+     * own after it, which must not be read as the next command's */
+    command("AT+NETOPEN");
+    if (waitFor("+NETOPEN: 0", "already opened", 10000) == 0 && strstr(demux.line(), "already opened"))
+        waitFor("ERROR", nullptr, 1000);
+
+    if (!resolve()) { LOG_WARN("[TCP] DNS lookup failed"); return false; }
+
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "AT+CIPOPEN=0,\"TCP\",\"%s\",%u", ip, port);
+    command(cmd);
+    if (waitFor("+CIPOPEN: 0,0", "+CIPOPEN: 0,", 15000) != 1) {
+        forgetDns();                            // maybe the address moved
+        return false;
+    }
+    return true;
+}
+
+void TcpUplink::close() {
+    command("AT+CIPCLOSE=0");
+    /* a link that is already down answers +CIPCLOSE: 0,<err>, then ERROR */
+    if (waitFor("+CIPCLOSE: 0", nullptr, 5000) == 1 && strncmp(demux.line(), "+CIPCLOSE: 0,0", 14))
+        waitFor("ERROR", nullptr, 1000);
+}
+
+void TcpUplink::sendCommand(char* cmd, size_t cap, size_t len) const {
+    snprintf(cmd, cap, "AT+CIPSEND=0,%u", (unsigned)len);
+}
+
+bool TcpUplink::closedBy(const char* l) const {
+    return !strncmp(l, "+IPCLOSE: 0", 11) || !strncmp(l, "+CIPERROR", 9);
+}
+
+/* --- HTTP side --- */
+bool TcpUplink::connect() {
+    if (!open()) {
+        LOG_WARN("%s connect to %s:%u failed", tag(), host, port);
+        return false;
+    }
+    demux.reset();
+    resp.reset();
+    connected = true;
+    lastUse = millis();
+    return true;
+}
+
+bool TcpUplink::begin() {
+    EnergyScope es(EN_UPLOAD);
+    inflight.clear();
+    bulkN = 0;
+    if (connected) {
+        /* held since the last drain: pick up a close that came in
+         * while idle; a long-idle one is likely dropped by the server */
+        poll();
+        if (connected && millis() - lastUse < TCP_IDLE_MAX_MS) return true;
+        abandon();
+    }
+    return connect() || connect();              // second try starts from scratch
+}
+
+size_t TcpUplink::encode(const char* row, char* out, size_t cap) {
+    TextBuf tb(out, cap);
+    if (bulkFmt) {
+        if (!bulkFmt->item(row, tb)) return 0;
+        return tb.ok ? tb.len : 0;
+    }
+    tb.add("GET ");
+    if (!path(row, tb)) return 0;
+    tb.add(" HTTP/1.1\r\nHost: ").add(host).add("\r\nConnection: keep-alive\r\n\r\n");
+    return tb.ok ? tb.len : 0;
+}
+
+/* Write parts back to back, cut into sends of at most TCP_SEND_MAX */
+bool TcpUplink::sendv(const char* const* part, const size_t* len, uint8_t n) {
+    uint8_t i = 0;
+    size_t off = 0;
+    while (i < n) {
+        size_t total = 0, o = off;
+        for (uint8_t j = i; j < n && total < TCP_SEND_MAX; ) {
+            size_t take = len[j] - o;
+            if (take > TCP_SEND_MAX - total) take = TCP_SEND_MAX - total;
+            total += take;
+            o += take;
+            if (o == len[j]) { ++j; o = 0; }
+        }
+        if (!total) break;                      // only empty parts left
+
+        char cmd[32];
+        sendCommand(cmd, sizeof(cmd), total);
+        command(cmd);
+        if (waitFor(nullptr, nullptr, 5000, true) != 1) return false;
+        for (size_t left = total; left; ) {
+            size_t take = len[i] - off;
+            if (take > left) take = left;
+            io.write((const uint8_t*)part[i] + off, take);
+            left -= take;
+            off += take;
+            if (off == len[i]) { ++i; off = 0; }
+        }
+        if (waitFor(sendDone(), nullptr, 10000) != 1) return false;
+        while (i < n && !len[i]) ++i;
+    }
+    return true;
+}
+
+bool TcpUplink::post(const char* wire, size_t len) {
+    EnergyScope es(EN_UPLOAD);
+    if (bulkFmt) {                              // goes out with the window in collect()
+        if (bulkN >= UPLINK_WINDOW_MAX) return false;
+        bulkItem[bulkN] = wire;
+        bulkLen[bulkN++] = len;
+        return true;
+    }
+    if (inflight.full()) return false;
+    paceWait();
+    if (!connected) {
+        /* rows posted on the old connection are still owed answers that
+         * will never come; a new one must not hand them this row's */
+        if (inflight.received() < inflight.count()) return false;
+        if (!connect()) return false;
+    }
+
+    if (!sendv(&wire, &len, 1)) {
+        abandon();
+        return false;
+    }
+    inflight.sent();
+    return true;
+}
+
+/* "POST <target>" with prefix item,item,… suffix as the body */
+bool TcpUplink::sendBulk() {
+    size_t body = strlen(bulkFmt->prefix) + strlen(bulkFmt->suffix) + (bulkN - 1);
+    for (uint8_t i = 0; i < bulkN; ++i) body += bulkLen[i];
+
+    char head[192];
+    TextBuf h(head, sizeof(head));
+    h.add("POST ").add(bulkFmt->target).add(" HTTP/1.1\r\nHost: ").add(host)
+     .add("\r\nContent-Type: application/json\r\nContent-Length: ").addUint(body)
+     .add("\r\nConnection: keep-alive\r\n\r\n").add(bulkFmt->prefix);
+    if (!h.ok) return false;
+
+    const char* part[2 * UPLINK_WINDOW_MAX + 1];
+    size_t      len[2 * UPLINK_WINDOW_MAX + 1];
+    uint8_t n = 0;
+    part[n] = head;
+    len[n++] = h.len;
+    for (uint8_t i = 0; i < bulkN; ++i) {
+        if (i) { part[n] = ","; len[n++] = 1; }
+        part[n] = bulkItem[i];
+        len[n++] = bulkLen[i];
+    }
+    part[n] = bulkFmt->suffix;
+    len[n++] = strlen(bulkFmt->suffix);
+    return sendv(part, len, n);
+}
+
+void TcpUplink::poll() {
+    while (io.available()) pump((uint8_t)io.read());
+}
+
+uint8_t TcpUplink::collect(UploadResult* res, uint8_t n) {
+    EnergyScope es(EN_UPLOAD);
+    uint8_t rows = n;
+    if (bulkFmt) {
+        /* the whole window is one request with one answer */
+        if (n > bulkN) n = rows = bulkN;
+        if (!n) return 0;
+        paceWait();
+        bool sent = (connected || connect()) && sendBulk();
+        bulkN = 0;
+        if (!sent) {
+            abandon();
+            return 0;
+        }
+        inflight.sent();
+        n = 1;
+    }
+    uint8_t want = inflight.awaiting(n);
+
+    /* read until every request has its response or the link stalls */
+    uint32_t t0 = millis();
+    while (inflight.received() < want && connected && millis() - t0 < 10000UL + 2000UL * want)
+        poll();
+
+    uint8_t filled = inflight.fill(res, n);
+    if (inflight.received() < want) abandon();  // out of step: start clean next time
+    inflight.clear();
+
+    if (bulkFmt && filled)
+        for (filled = 1; filled < rows; ++filled) res[filled] = res[0];
+    return filled;
+}
+
+/* Give up on the connection; the socket is closed even if we think it
+ * already is, so the next open() does not find link 0 busy. */
+void TcpUplink::abandon() {
+    close();
+    connected = false;
+}
+
+void TcpUplink::end() {
+    if (connected && !linger) abandon();
+    inflight.clear();
+    bulkN = 0;
+}
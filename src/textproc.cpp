@@ -0,0 +1,177 @@
+#include <string.h>
+#include "textproc.h"
+
+/* ======================================================== */
+/* |---------------------- TextBuf -----------------------| */
+/* ======================================================== */
+TextBuf& TextBuf::add(const char* s, size_t n) {
+    if (!ok) return *this;
+    if (len + n >= cap) {                    // keep room for the terminator
+        ok = false;
+        return *this;
+    }
+    memcpy(p + len, s, n);
+    len += n;
+    p[len] = '\0';
+    return *this;
+}
+
+TextBuf& TextBuf::add(const char* s) {
+    return add(s, strlen(s));
+}
+
+TextBuf& TextBuf::add(char c) {
+    return add(&c, 1);
+}
+
+TextBuf& TextBuf::addUint(uint32_t v) {
+    char tmp[10];
+    uint8_t n = 0;
+    do { tmp[n++] = '0' + v % 10; v /= 10; } while (v);
+    char rev[10];
+    for (uint8_t i = 0; i < n; ++i) rev[i] = tmp[n - 1 - i];
+    return add(rev, n);
+}
+
+/* ======================================================== */
+/* |---------------------- TSV → URL ---------------------| */
+/* ======================================================== */
+bool tsvToFields(const char* tsv, TextBuf& out) {
+    uint32_t fieldNo = 1;
+    const char* p = tsv;
+
+    while (*p) {
+        out.add("field").addUint(fieldNo++).add('=');
+        for (; *p && *p != '\t'; ++p) {
+            if (*p == '+')      out.add("%2B", 3);
+            else if (*p == ' ') out.add("%20", 3);
+            else                out.add(*p);
+        }
+        if (*p == '\t' && *++p) out.add('&');      // no '&' after last field
+    }
+    return out.ok;
+}
+
+bool rowSanitize(char* row, size_t cap) {
+    /* pass 1: drop CR/LF, count spaces */
+    size_t w = 0, spaces = 0;
+    for (size_t r = 0; row[r]; ++r) {
+        if (row[r] == '\n' || row[r] == '\r') continue;
+        if (row[r] == ' ') spaces++;
+        row[w++] = row[r];
+    }
+    row[w] = '\0';
+    if (!spaces) return true;
+
+    /* pass 2: expand spaces back-to-front */
+    size_t outLen = w + 2 * spaces;
+    if (outLen >= cap) return false;
+    row[outLen] = '\0';
+    for (size_t r = w, o = outLen; r-- > 0;) {
+        if (row[r] == ' ') {
+            row[--o] = '0'; row[--o] = '2'; row[--o] = '%';
+        } else {
+            row[--o] = row[r];
+        }
+    }
+    return true;
+}
+
+/* ======================================================== */
+/* |------------------------ GNSS ------------------------| */
+/* ======================================================== */
+
+/* NMEA ddmm.mmmm / dddmm.mmmm → micro-degrees, integer only */
+static bool nmeaToMicroDeg(const char* s, int32_t& udeg) {
+    uint32_t ip = 0;
+    uint8_t  digits = 0;
+    while (*s >= '0' && *s <= '9' && digits < 5) { ip = ip * 10 + (*s++ - '0'); digits++; }
+    if (!digits) return false;
+
+    int32_t minE6 = (int32_t)(ip % 100) * 1000000;     // whole minutes
+    int32_t frac = 0;
+    if (*s == '.' && !parseFixed(s, 6, frac)) return false;
+    minE6 += frac;
+    udeg = (int32_t)(ip / 100) * 1000000 + (minE6 + 30) / 60;
+    return true;
+}
+
+bool parseCgpsInfo(const char* line, GpsFix& fix) {
+    const char* p = strchr(line, ':');
+    if (!p) return false;
+    ++p;
+    while (*p == ' ') ++p;
+
+    /* split into at most 7 fields: lat,N,lon,E,date,utc,alt */
+    const char* field[7];
+    uint8_t n = 0;
+    field[n++] = p;
+    for (; *p && *p != '\r' && *p != '\n' && n < 7; ++p)
+        if (*p == ',') field[n++] = p + 1;
+    if (n < 7) return false;
+
+    if (*field[0] == ',' || *field[2] == ',') return false;     // no fix
+
+    const char* alt = field[6];
+    int32_t altDm = 0;
+    if (*alt != ',' && !parseFixed(alt, 1, altDm)) return false;
+    if (!nmeaToMicroDeg(field[0], fix.latitude_udeg) ||
+        !nmeaToMicroDeg(field[2], fix.longitude_udeg)) return false;
+
+    fix.altitude_dm = altDm;
+    if (*field[1] == 'S') fix.latitude_udeg  = -fix.latitude_udeg;
+    if (*field[3] == 'W') fix.longitude_udeg = -fix.longitude_udeg;
+    return true;
+}
+
+static const int32_t POW10_FIXED[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+bool parseFixed(const char*& p, uint8_t decimals, int32_t& v) {
+    if (decimals > 6) decimals = 6;
+    const char* s = p;
+    bool neg = false;
+    if (*s == '-' || *s == '+') neg = *s++ == '-';
+    if ((*s < '0' || *s > '9') && !(*s == '.' && s[1] >= '0' && s[1] <= '9')) return false;
+
+    int64_t acc = 0;
+    while (*s >= '0' && *s <= '9') {
+        acc = acc * 10 + (*s++ - '0');
+        if (acc > INT32_MAX) return false;
+    }
+    acc *= POW10_FIXED[decimals];
+
+    if (*s == '.') {
+        ++s;
+        int32_t scale = POW10_FIXED[decimals];
+        while (*s >= '0' && *s <= '9' && (scale /= 10))
+            acc += (*s++ - '0') * scale;
+        if (*s >= '5' && *s <= '9') acc += 1;      // round on the first dropped digit
+        while (*s >= '0' && *s <= '9') ++s;
+    }
+    if (acc > INT32_MAX) return false;
+    v = neg ? -(int32_t)acc : (int32_t)acc;
+    p = s;
+    return true;
+}
+
+bool addFixed(TextBuf& out, int32_t v, uint8_t decimals) {
+    if (decimals > 6) decimals = 6;
+    uint32_t a = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+    if (v < 0) out.add('-');
+    out.addUint(a / POW10_FIXED[decimals]);
+    if (decimals) {
+        char frac[6];
+        uint32_t f = a % POW10_FIXED[decimals];
+        for (uint8_t i = decimals; i-- > 0;) { frac[i] = '0' + f % 10; f /= 10; }
+        out.add('.').add(frac, decimals);
+    }
+    return out.ok;
+}
+
+bool formatFix(const GpsFix& fix, TextBuf& out) {
+    addFixed(out, fix.latitude_udeg, 6);
+    out.add(',');
+    addFixed(out, fix.longitude_udeg, 6);
+    out.add(',');
+    return addFixed(out, fix.altitude_dm, 1);
+}
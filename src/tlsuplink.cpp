@@ -0,0 +1,52 @@
+#include "tlsuplink.h"
+#include "log.h"
+
+TlsUplink::TlsUplink(Stream& modem, const char* h, uint16_t p, RowFormatFn fn,
+                     const char* caCert)
+    : TcpUplink(modem, h, p, fn, "+CCHRECV: DATA,0,"), ca(caCert) {}
+
+/* SSL context 0 is set up on every open: the settings do not survive a
+ * modem reset and cost a few ms against a multi-second handshake. */
+bool TlsUplink::open() {
+    char cmd[96];
+
+    command("AT+CCHSET=0,0");                   // no send URC; data arrives as +CCHRECV
+    waitFor("OK", nullptr, 1000);
+    command("AT+CCHSTART");                     // ERROR: already started, fine
+    waitFor("+CCHSTART: 0", nullptr, 5000);
+
+    command("AT+CSSLCFG=\"sslversion\",0,4");   // TLS 1.0 – 1.2, server picks
+    waitFor("OK", nullptr, 1000);
+    snprintf(cmd, sizeof(cmd), "AT+CSSLCFG=\"authmode\",0,%u", ca ? 1 : 0);
+    command(cmd);
+    waitFor("OK", nullptr, 1000);
+    if (ca) {
+        snprintf(cmd, sizeof(cmd), "AT+CSSLCFG=\"cacert\",0,\"%s\"", ca);
+        command(cmd);
+        if (waitFor("OK", nullptr, 1000) != 1) LOG_WARN("[TLS] CA %s not on modem", ca);
+    }
+    command("AT+CSSLCFG=\"enableSNI\",0,1");
+    waitFor("OK", nullptr, 1000);
+    command("AT+CCHSSLCFG=0,0");
+    waitFor("OK", nullptr, 1000);
+
+    snprintf(cmd, sizeof(cmd), "AT+CCHOPEN=0,\"%s\",%u,2", host, port);
+    command(cmd);
+    return waitFor("+CCHOPEN: 0,0", "+CCHOPEN: 0,", 30000) == 1;
+}
+
+void TlsUplink::close() {
+    command("AT+CCHCLOSE=0");
+    waitFor("+CCHCLOSE: 0", nullptr, 5000);
+    command("AT+CCHSTOP");
+    waitFor("+CCHSTOP:", nullptr, 5000);
+}
+
+void TlsUplink::sendCommand(char* cmd, size_t cap, size_t len) const {
+    snprintf(cmd, cap, "AT+CCHSEND=0,%u", (unsigned)len);
+}
+
+bool TlsUplink::closedBy(const char* l) const {
+    return !strncmp(l, "+CCH_PEER_CLOSED: 0", 19) || !strncmp(l, "+CCHCLOSE: 0", 12) ||
+           !strncmp(l, "+CCH: CCH STOP", 14);
+}
@@ -0,0 +1,54 @@
+#include <string.h>
+#include "trigger.h"
+
+TriggerEngine::TriggerEngine(const TriggerRule* r, uint8_t n, uint32_t holdoffMs)
+    : rules(r), nRules(n), holdoff(holdoffMs), firedAt(0), armed(false), nFired(0) {
+    memset(lastN, 0, sizeof(lastN));
+    memset(lastAt, 0, sizeof(lastAt));
+}
+
+bool TriggerEngine::check(const TriggerRule& r, const int32_t* v, uint8_t n,
+                          uint32_t dtMs) const {
+    uint8_t m = n < lastN[r.type] ? n : lastN[r.type];
+    uint8_t from = 0, to = m;
+    if (r.depth != TRIG_ANY_DEPTH) {
+        if ((uint8_t)r.depth >= m) return false;
+        from = (uint8_t)r.depth;
+        to = from + 1;
+    }
+
+    for (uint8_t d = from; d < to; ++d) {
+        int64_t diff = (int64_t)v[d] - last[r.type][d];
+        if (diff < 0) diff = -diff;
+        if (r.kind == TRIG_RATE) {
+            if (dtMs < 1000) return false;          // too close to judge a rate
+            diff = diff * 60000 / dtMs;
+        }
+        if (diff > r.threshold) return true;
+    }
+    return false;
+}
+
+int8_t TriggerEngine::evaluate(uint8_t type, const int32_t* v, uint8_t n, uint32_t nowMs) {
+    if (type >= INGEST_TYPES_MAX) return -1;
+    if (n > SAMPLE_DEPTHS_MAX) n = SAMPLE_DEPTHS_MAX;
+
+    int8_t hit = -1;
+    bool quiet = armed && nowMs - firedAt < holdoff;
+    if (lastN[type] && !quiet) {
+        for (uint8_t i = 0; i < nRules && hit < 0; ++i)
+            if (rules[i].type == type && check(rules[i], v, n, nowMs - lastAt[type]))
+                hit = (int8_t)i;
+    }
+
+    memcpy(last[type], v, n * sizeof(v[0]));
+    lastN[type] = n;
+    lastAt[type] = nowMs;
+
+    if (hit >= 0) {
+        firedAt = nowMs;
+        armed = true;
+        nFired++;
+    }
+    return hit;
+}
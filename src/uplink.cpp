@@ -0,0 +1,18 @@
+#include <Arduino.h>
+#include "uplink.h"
+#include "watchdog.h"
+
+void Uplink::paceWait() {
+    if (!pacer) return;
+    uint32_t w;
+    while ((w = pacer->waitMs(millis())) != 0) {
+        wdCheckpoint(WD_UPLINK, 10000);         // waiting on the pacer is progress
+        poll();                                 // replies keep coming in meanwhile
+        delay(w < 20 ? w : 20);
+    }
+    pacer->take(millis());
+}
+
+void Uplink::paceRefused() {
+    if (pacer) pacer->backoff(millis());
+}
@@ -0,0 +1,499 @@
+#include <Arduino.h>
+#include "upqueue.h"
+#include "energy.h"
+#include "log.h"
+#include "memstat.h"
+#include "record.h"
+#include "sdlog.h"
+#include "storage.h"
+#include "textproc.h"
+#include "uplink.h"
+#include "watchdog.h"
+
+bool sdInit();                              // jacob-main.cpp
+
+static const char LATEST_FILE[] = "LATEST.TXT";
+static const char CURSOR_FILE[] = "QUEUE.CUR";
+static const size_t NAME_MAX_83 = 13;       // "D250710.CSV" + NUL
+static const size_t QROW_MAX    = 256;
+static const size_t QLINE_MAX   = QROW_MAX + RECORD_OVERHEAD;
+
+/* --- BACKLOG CURSOR: next unread byte of the oldest day file --- */
+struct QueueCursor {
+    char     name[NAME_MAX_83];
+    uint32_t offset;
+};
+
+/* On SD the cursor lives in two alternating slots, each with a
+ * sequence number and CRC, so a torn cursor write leaves the
+ * previous one readable. */
+struct CursorSlot {
+    uint32_t    seq;
+    QueueCursor c;
+    uint32_t    crc;
+};
+static uint32_t cursorSeq = 0;
+
+static bool isDayFile(const char* nm) {
+    size_t len = strlen(nm);
+    return len > 4 && len < NAME_MAX_83 && !strcmp(nm + len - 4, ".CSV");
+}
+
+static bool slotValid(const CursorSlot& s) {
+    return s.crc == crc32(&s, offsetof(CursorSlot, crc)) && s.c.name[NAME_MAX_83 - 1] == '\0';
+}
+
+static bool loadCursor(QueueCursor& c) {
+    StoreFile f = storeOpen(CURSOR_FILE, ST_READ);
+    if (!f) return false;
+    CursorSlot s[2];
+    bool ok[2];
+    for (uint8_t i = 0; i < 2; ++i)
+        ok[i] = f.read(&s[i], sizeof(s[i])) == sizeof(s[i]) && slotValid(s[i]);
+    f.close();
+
+    if (!ok[0] && !ok[1]) return false;
+    uint8_t pick = (ok[0] && ok[1]) ? (s[1].seq > s[0].seq) : ok[1];
+    c = s[pick].c;
+    cursorSeq = s[pick].seq;
+    return true;
+}
+
+static void saveCursor(const QueueCursor& c) {
+    StoreFile f = storeOpen(CURSOR_FILE, ST_RW);
+    if (!f) return;
+    CursorSlot s;
+    memset(&s, 0, sizeof(s));
+    s.seq = ++cursorSeq;
+    s.c   = c;
+    s.crc = crc32(&s, offsetof(CursorSlot, crc));
+    f.seek((s.seq & 1) * sizeof(s));            // overwrite the older slot
+    f.write(&s, sizeof(s));
+    f.close();
+}
+
+/* Oldest day file by name (names sort chronologically) */
+static bool oldestDayFile(char* out) {
+    bool found = false;
+    char nm[NAME_MAX_83 + 1];                   // one over: longer names are not day files
+    StoreDir dir;
+    if (!dir.open()) return false;
+    while (dir.next(nm, sizeof(nm))) {
+        if (isDayFile(nm) && (!found || strcmp(nm, out) < 0)) {
+            strcpy(out, nm);
+            found = true;
+        }
+    }
+    dir.close();
+    return found;
+}
+
+/* Backlog appends go through the sector buffer; the day file stays open */
+static bool appendRow(const char* file, const char* row) {
+    char line[QLINE_MAX];
+    return recordFrame(row, line, sizeof(line)) && sdlogAppend(file, line);
+}
+
+/* --- RAM LANE: rows taken while the card is missing ---
+ * Entries are "<dayFile>\0<row>\0", oldest first. */
+static char     ramBuf[QUEUE_RAM_BYTES];
+static uint16_t ramUsed = 0;
+
+static size_t ramEntry(size_t at) {             // bytes of the entry at offset at
+    size_t d = strlen(ramBuf + at) + 1;
+    return d + strlen(ramBuf + at + d) + 1;
+}
+
+static const char* ramRow(size_t at) {
+    return ramBuf + at + strlen(ramBuf + at) + 1;
+}
+
+static size_t ramNewest() {                     // offset of the newest entry
+    size_t at = 0;
+    while (at + ramEntry(at) < ramUsed) at += ramEntry(at);
+    return at;
+}
+
+static void ramDropOldest() {
+    size_t n = ramEntry(0);
+    memmove(ramBuf, ramBuf + n, ramUsed - n);
+    ramUsed -= n;
+}
+
+static bool ramPush(const char* row, const char* dayFile) {
+    size_t d = strlen(dayFile) + 1, r = strlen(row) + 1;
+    if (d + r > sizeof(ramBuf)) return false;
+    while (ramUsed + d + r > sizeof(ramBuf)) {
+        ramDropOldest();
+        LOG_WARN("Queue: RAM full, oldest row dropped");
+    }
+    memcpy(ramBuf + ramUsed, dayFile, d);
+    memcpy(ramBuf + ramUsed + d, row, r);
+    ramUsed += d + r;
+    return true;
+}
+
+/* The card is back: RAM rows join their day files, oldest first */
+static void ramSpill() {
+    uint16_t moved = 0;
+    while (ramUsed && appendRow(ramBuf, ramRow(0))) {
+        ramDropOldest();
+        moved++;
+    }
+    sdlogFlush();
+    LOG_INFO("Queue: %u rows moved from RAM to SD", moved);
+}
+
+/* Card mounted, with anything held in RAM moved onto it */
+static bool sdReady() {
+    if (!sdInit()) return false;
+    if (ramUsed) ramSpill();
+    return true;
+}
+
+/* Read LATEST.TXT: first line is the day file, second the framed row */
+static bool readLatest(char* dayFile, char* line, char** row) {
+    StoreFile f = storeOpen(LATEST_FILE, ST_READ);
+    if (!f) return false;
+    LineReader<StoreFile> lines(f);
+    bool ok = lines.next(dayFile, NAME_MAX_83) > 0 && isDayFile(dayFile) &&
+              lines.next(line, QLINE_MAX) > 0 && recordCheck(line, row) != REC_BAD;
+    f.close();
+    return ok;
+}
+
+/* Move the unsent latest row into its day file. It goes through the
+ * sector buffer with whatever backlog is waiting there, then is flushed:
+ * LATEST.TXT is overwritten next, and until then it is the only copy on
+ * the card. Only an unsent row pays for the write. False: the card
+ * refused it. */
+static bool demoteLatest() {
+    char day[NAME_MAX_83], line[QLINE_MAX], *row;
+    if (!readLatest(day, line, &row)) return true;  // empty or torn: nothing to keep
+    if (!appendRow(day, row) || !sdlogFlush()) return false;
+    LOG_DEBUG("Queue: latest demoted to %s", day);
+    return true;
+}
+
+/* ======================================================== */
+bool queuePush(const char* row, const char* dayFile) {
+    EnergyScope es(EN_SD);
+    if (!sdReady()) return ramPush(row, dayFile);
+
+    if (storeExists(LATEST_FILE) && !demoteLatest())
+        return appendRow(dayFile, row);         // keep the old latest rather than lose it
+
+    char line[QLINE_MAX];
+    if (!recordFrame(row, line, sizeof(line))) return false;
+
+    /* overwritten in place: no remove and re-create per sample */
+    StoreFile f = storeOpen(LATEST_FILE, ST_TRUNC);
+    if (!f) {                                   // fall back to the backlog
+        storeRemove(LATEST_FILE);               // its row was demoted already
+        return appendRow(dayFile, row);
+    }
+    f.println(dayFile);
+    f.println(line);
+    f.close();
+    return true;
+}
+
+bool queueAppend(const char* row, const char* dayFile) {
+    EnergyScope es(EN_SD);
+    return sdReady() ? appendRow(dayFile, row) : ramPush(row, dayFile);
+}
+
+/* Local-only copy (.RAW next to the day file): framed, never drained */
+bool queueArchive(const char* row, const char* dayFile) {
+    if (!isDayFile(dayFile)) return false;
+    char name[NAME_MAX_83];
+    size_t stem = strlen(dayFile) - 4;
+    memcpy(name, dayFile, stem);
+    strcpy(name + stem, ".RAW");
+
+    EnergyScope es(EN_SD);
+    return sdReady() && appendRow(name, row);  // not kept in RAM
+}
+
+bool queueHasLatest() {
+    EnergyScope es(EN_SD);
+    return sdReady() ? storeExists(LATEST_FILE) : ramUsed > 0;
+}
+
+bool queueHasBacklog() {
+    EnergyScope es(EN_SD);
+    char name[NAME_MAX_83];
+    if (!sdReady()) return ramUsed && ramNewest() > 0;
+    sdlogClose();                               // buffered rows count too
+    return oldestDayFile(name);
+}
+
+/* Bytes still to send: every day file, less what the cursor has passed */
+uint32_t queueBacklogBytes() {
+    EnergyScope es(EN_SD);
+    if (!sdReady()) return ramUsed;
+    sdlogClose();
+    QueueCursor cur;
+    if (!loadCursor(cur)) cur = QueueCursor{{0}, 0};
+
+    uint32_t total = 0, sz;
+    char nm[NAME_MAX_83 + 1];
+    StoreDir dir;
+    if (!dir.open()) return 0;
+    while (dir.next(nm, sizeof(nm), &sz)) {
+        if (!isDayFile(nm)) continue;
+        if (!strcmp(nm, cur.name)) sz = sz > cur.offset ? sz - cur.offset : 0;
+        total += sz;
+    }
+    dir.close();
+    return total;
+}
+
+/* --- DRAIN PIPELINE ---
+ * Two batches alternate: while one is on the air (posted, waiting
+ * for its results), the next is read from SD and encoded into the
+ * other. Each stage packs the wire forms of up to a window of rows;
+ * the bytes stay put until the batch is collected. */
+static const size_t DRAIN_STAGE_BYTES = 1536;  // ~4 typical rows; a worst-case one always fits
+
+enum RowKind : uint8_t { ROW_SEND, ROW_CORRUPT, ROW_REFUSED };
+
+/* Sector-sized reads: on a contiguous day file SdFat serves them
+ * straight from the card, several sectors per command */
+typedef LineReader<StoreFile, SDLOG_SECTOR> DrainReader;
+
+struct DrainStage {
+    uint8_t  n;
+    bool     eof;                           // the file ended while filling
+    uint16_t used;
+    uint16_t at[UPLINK_WINDOW_MAX];         // wire form of row i: buf + at[i]
+    uint16_t len[UPLINK_WINDOW_MAX];
+    uint32_t next[UPLINK_WINDOW_MAX];       // file offset after row i
+    RowKind  kind[UPLINK_WINDOW_MAX];
+    char     buf[DRAIN_STAGE_BYTES];
+};
+static DrainStage stages[2];
+
+/* Stage one: read and encode up to max rows. The uplink is polled
+ * before every SD read so replies to the batch in flight are taken
+ * off the UART as they come, not left to overflow it. */
+static void stageFill(DrainStage& s, DrainReader& lines, StoreFile& f, Uplink& up, uint8_t max) {
+    char line[QLINE_MAX], *row;
+    s.n = 0;
+    s.used = 0;
+    s.eof = false;
+    while (s.n < max) {
+        if (s.n && sizeof(s.buf) - s.used < UPLINK_WIRE_MAX) break;
+        up.poll();
+        if (lines.next(line, sizeof(line)) < 0) { s.eof = true; break; }
+
+        uint8_t i = s.n++;
+        s.next[i] = f.position() - lines.buffered();
+        s.at[i] = s.used;
+        s.len[i] = 0;
+        if (recordCheck(line, &row) == REC_BAD) { s.kind[i] = ROW_CORRUPT; continue; }
+        size_t len = up.encode(row, s.buf + s.used, sizeof(s.buf) - s.used);
+        if (!len) { s.kind[i] = ROW_REFUSED; continue; }
+        s.kind[i] = ROW_SEND;
+        s.len[i] = len;
+        s.used += len + 1;
+    }
+}
+
+/* Stage two: put a batch on the air. Stops at the first row the
+ * uplink could not send; rows from there on are dropped from the
+ * batch and read again next time. */
+static uint8_t stagePost(DrainStage& s, Uplink& up, bool& stop) {
+    uint8_t posted = 0;
+    for (uint8_t i = 0; i < s.n; ++i) {
+        if (s.kind[i] != ROW_SEND) continue;
+        if (!up.post(s.buf + s.at[i], s.len[i])) { s.n = i; stop = true; break; }
+        posted++;
+    }
+    return posted;
+}
+
+/* One row on its own: encode, post, wait for its answer */
+static UploadResult sendOne(Uplink& up, const char* row) {
+    UploadResult r = UP_FAILED;
+    char* wire = stages[0].buf;                 // no drain running: borrow a stage
+    size_t len = up.encode(row, wire, sizeof(stages[0].buf));
+    if (!len) return UP_REJECTED;
+    if (up.post(wire, len)) up.collect(&r, 1);
+    return r;
+}
+
+UploadResult queueSendLatest(Uplink& up) {
+    EnergyScope es(EN_SD);
+    MemPhaseScope mp(MP_UPLOAD);
+    if (!sdReady()) {
+        if (!ramUsed) return UP_REJECTED;
+        size_t at = ramNewest();
+        UploadResult r = sendOne(up, ramRow(at));
+        if (r != UP_FAILED) ramUsed = at;       // the newest entry is the last one
+        return r;
+    }
+
+    char day[NAME_MAX_83], line[QLINE_MAX], *row;
+    if (!readLatest(day, line, &row)) {
+        storeRemove(LATEST_FILE);               // empty or torn
+        return UP_REJECTED;
+    }
+
+    UploadResult r = sendOne(up, row);
+    if (r == UP_OK || r == UP_REJECTED) storeRemove(LATEST_FILE);
+    return r;                                   // UP_FAILED: demoted on next push
+}
+
+/* Rows go out a window at a time, pipelined: batch N+1 is read and
+ * encoded while batch N waits for its results. The cursor advances
+ * past every row up to the first one that failed and is saved once
+ * per batch; a batch read ahead of a failure is simply dropped. */
+DrainStats queueDrain(Uplink& up, uint32_t budgetMs, uint16_t maxRows) {
+    EnergyScope es(EN_SD);                      // the uplink charges itself
+    MemPhaseScope mp(MP_UPLOAD);
+    DrainStats st{0, 0, false};
+    uint32_t t0 = millis();
+    uint8_t w = up.window();
+    if (w < 1) w = 1;
+    if (w > UPLINK_WINDOW_MAX) w = UPLINK_WINDOW_MAX;
+    auto allowance = [&](uint16_t inFlight) -> uint8_t {   // rows the next batch may take
+        if (!maxRows) return w;
+        uint16_t done = st.sent + st.skipped + inFlight;
+        return done >= maxRows ? 0 : (maxRows - done < w ? maxRows - done : w);
+    };
+
+    if (!sdReady()) {                           // card missing: RAM rows, one at a time
+        while (ramUsed && millis() - t0 < budgetMs && allowance(0)) {
+            wdCheckpoint(WD_UPLINK, 10000, st.sent);
+            UploadResult r = sendOne(up, ramRow(0));
+            if (r == UP_FAILED) break;
+            if (r == UP_OK) st.sent++;
+            else st.skipped++;
+            ramDropOldest();
+        }
+        st.empty = !ramUsed;
+        return st;
+    }
+    sdlogClose();                               // reader sees every buffered row
+
+    char line[QLINE_MAX];
+    QueueCursor cur;
+    if (!loadCursor(cur)) cur = QueueCursor{{0}, 0};
+
+    while (millis() - t0 < budgetMs && allowance(0)) {
+        /* pick the file: cursor's if it still exists, else the oldest */
+        if (!cur.name[0] || !storeExists(cur.name)) {
+            if (!oldestDayFile(cur.name)) { st.empty = true; break; }
+            cur.offset = 0;
+        }
+
+        StoreFile f = storeOpen(cur.name, ST_READ);
+        if (!f) break;
+        f.seek(cur.offset);
+
+        DrainReader lines(f);
+        bool stop = false;
+        uint8_t a = 0;
+        stageFill(stages[a], lines, f, up, allowance(0));
+
+        while (stages[a].n && !stop) {
+            wdCheckpoint(WD_UPLINK, 10000, st.sent);
+            DrainStage& s = stages[a];
+            DrainStage& ahead = stages[a ^ 1];
+
+            /* 1 ── batch N on the air; corrupt and refused rows are not sent */
+            uint8_t posted = stagePost(s, up, stop);
+
+            /* 2 ── batch N+1 off the SD card meanwhile */
+            ahead.n = 0;
+            if (!stop && !s.eof && millis() - t0 < budgetMs)
+                stageFill(ahead, lines, f, up, allowance(s.n));
+
+            /* 3 ── batch N results in order; stop at the first failure */
+            UploadResult res[UPLINK_WINDOW_MAX];
+            uint8_t got = posted ? up.collect(res, posted) : 0;
+            uint8_t k = 0;
+            for (uint8_t i = 0; i < s.n; ++i) {
+                UploadResult r = s.kind[i] != ROW_SEND ? UP_REJECTED
+                               : (k < got ? res[k++] : UP_FAILED);
+                if (r == UP_FAILED) { stop = true; break; }
+                if (r == UP_OK) st.sent++;
+                else {
+                    st.skipped++;
+                    LOG_WARN("Queue: %s row in %s at %lu",
+                             s.kind[i] == ROW_CORRUPT ? "corrupt" : "skipped",
+                             cur.name, (unsigned long)cur.offset);
+                }
+                cur.offset = s.next[i];
+            }
+            saveCursor(cur);                    // committed once per batch
+            a ^= 1;
+        }
+
+        bool done = !stop && lines.next(line, sizeof(line)) < 0;
+        f.close();
+        if (stop) break;
+        if (!done) break;                       // budget or row cap hit mid-file
+
+        storeRemove(cur.name);
+        LOG_DEBUG("Queue: drained %s", cur.name);
+        cur = QueueCursor{{0}, 0};
+        saveCursor(cur);
+    }
+    return st;
+}
+
+/* Boot-time repair. Bounded on any card: it reads LATEST.TXT, the two
+ * cursor slots and at most one line of the cursor's file, never a whole
+ * day file. Corrupt rows elsewhere are dropped by the drain as it meets
+ * them. A crash between an upload and its cursor save resends that one
+ * row; nothing is skipped. */
+void queueRecover() {
+    EnergyScope es(EN_SD);
+    if (!sdInit()) return;
+
+    char day[NAME_MAX_83], line[QLINE_MAX], *row;
+    if (storeExists(LATEST_FILE) && !readLatest(day, line, &row)) {
+        storeRemove(LATEST_FILE);
+        LOG_WARN("Queue: torn %s dropped", LATEST_FILE);
+    }
+
+    QueueCursor cur;
+    if (!loadCursor(cur)) {
+        if (storeExists(CURSOR_FILE)) {
+            storeRemove(CURSOR_FILE);
+            LOG_WARN("Queue: cursor unreadable, restarting at oldest file");
+        }
+        return;
+    }
+    if (!cur.name[0]) return;
+
+    StoreFile f = storeOpen(cur.name, ST_READ);
+    if (!f) {                                   // removed before the cursor was reset
+        cur = QueueCursor{{0}, 0};
+        saveCursor(cur);
+        return;
+    }
+
+    /* the cursor must sit on a line start: move up to the next one */
+    uint32_t size = f.size();
+    uint32_t at = cur.offset < size ? cur.offset : size;
+    if (at > 0) {
+        uint32_t limit = at + QLINE_MAX;
+        f.seek(at - 1);
+        int c = f.read();
+        while (c != '\n' && c >= 0 && at < size && at < limit) {
+            c = f.read();
+            at++;
+        }
+    }
+    f.close();
+
+    if (at != cur.offset) {
+        LOG_WARN("Queue: cursor %s %lu -> %lu", cur.name,
+                 (unsigned long)cur.offset, (unsigned long)at);
+        cur.offset = at;
+        saveCursor(cur);
+    }
+}
@@ -0,0 +1,140 @@
+#include <Arduino.h>
+#include "watchdog.h"
+
+const char* const WD_TASK_NAME[WD_TASK_COUNT] = {
+    "boot", "loop", "idle", "sample", "modem", "uplink", "sd",
+};
+const char* const RC_NAME[] = {
+    "power-on", "brownout", "reset pin", "watchdog", "software",
+};
+
+static const uint32_t WD_MAGIC = 0x57444F47;        // "WDOG"
+
+/* --- LAST CHECKPOINT: survives a warm reset --- */
+struct WdState {
+    uint32_t magic;
+    uint32_t at;                // millis() of the checkpoint
+    uint32_t budget;
+    uint32_t overMs;            // set by the early warning when it stops feeding
+    uint16_t arg;
+    uint8_t  task;
+    uint8_t  soft;              // wdRestart() asked for this reset
+    uint16_t restarts;
+    uint16_t check;             // ~restarts: tells a kept record from RAM noise
+};
+static WdState last __attribute__((section(".noinit")));
+
+#ifdef ARDUINO_ARCH_SAMD
+/* ======================================================== */
+/* |------------------------ WDT -------------------------| */
+/* ======================================================== */
+static const uint8_t WD_GCLK = 5;                   // free generator: OSCULP32K / 32
+
+struct IrqLock {
+    uint32_t primask;
+    IrqLock() : primask(__get_PRIMASK()) { __disable_irq(); }
+    ~IrqLock() { __set_PRIMASK(primask); }
+};
+
+static void wdtSync() {
+    while (WDT->STATUS.bit.SYNCBUSY);
+}
+
+static ResetCause resetCause() {
+    uint8_t rc = PM->RCAUSE.reg;
+    if (rc & PM_RCAUSE_WDT)  return RC_WATCHDOG;
+    if (rc & PM_RCAUSE_SYST) return RC_SOFT;
+    if (rc & PM_RCAUSE_EXT)  return RC_PIN;
+    if (rc & (PM_RCAUSE_BOD12 | PM_RCAUSE_BOD33)) return RC_BROWNOUT;
+    return RC_POWER;
+}
+
+static void wdtArm() {
+    /* 1.024 kHz from the ultra-low-power oscillator, independent
+     * of the crystal the RTC runs on */
+    GCLK->GENDIV.reg = GCLK_GENDIV_ID(WD_GCLK) | GCLK_GENDIV_DIV(4);
+    GCLK->GENCTRL.reg = GCLK_GENCTRL_ID(WD_GCLK) | GCLK_GENCTRL_GENEN |
+                        GCLK_GENCTRL_SRC_OSCULP32K | GCLK_GENCTRL_DIVSEL;
+    while (GCLK->STATUS.bit.SYNCBUSY);
+    GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID_WDT | GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN(WD_GCLK);
+
+    WDT->CTRL.reg = 0;
+    wdtSync();
+    WDT->CONFIG.reg = WDT_CONFIG_PER_8K;            // 8 s
+    WDT->EWCTRL.reg = WDT_EWCTRL_EWOFFSET_4K;       // early warning at 4 s
+    WDT->INTFLAG.reg = WDT_INTFLAG_EW;
+    WDT->INTENSET.reg = WDT_INTENSET_EW;
+    NVIC_SetPriority(WDT_IRQn, 3);                  // lowest: a stuck ISR above it starves it
+    NVIC_ClearPendingIRQ(WDT_IRQn);
+    NVIC_EnableIRQ(WDT_IRQn);
+    WDT->CTRL.reg = WDT_CTRL_ENABLE;
+    wdtSync();
+}
+
+static void wdtFeed() {
+    WDT->CLEAR.reg = WDT_CLEAR_CLEAR_KEY;
+    wdtSync();
+}
+
+/* Early warning: feed while the current task is inside its budget,
+ * otherwise note by how much it overran and let the WDT bite */
+void WDT_Handler() {
+    WDT->INTFLAG.reg = WDT_INTFLAG_EW;
+    uint32_t in = millis() - last.at;
+    if (in <= last.budget) {
+        wdtFeed();
+        return;
+    }
+    last.overMs = in - last.budget;
+}
+
+#else
+/* ======================================================== */
+/* |------------------------ HOST ------------------------| */
+/* ======================================================== */
+struct IrqLock { IrqLock() {} };
+static ResetCause resetCause() { return RC_POWER; }
+static void wdtArm() {}
+#endif
+
+/* ======================================================== */
+WdReport wdBegin() {
+    ResetCause rc = resetCause();
+    bool kept = last.magic == WD_MAGIC && last.check == (uint16_t)~last.restarts
+                && last.task < WD_TASK_COUNT;
+    if (rc == RC_SOFT && !(kept && last.soft)) rc = RC_PIN;   // a reset request from USB (upload)
+
+    WdReport r{rc, WD_BOOT, 0, 0, 0};
+    if (kept && rc != RC_POWER && rc != RC_BROWNOUT) {
+        r.task     = (WdTask)last.task;
+        r.arg      = last.arg;
+        r.overMs   = last.overMs;
+        r.restarts = last.restarts;
+        if (rc == RC_WATCHDOG || rc == RC_SOFT) r.restarts++;
+    }
+
+    last.magic    = WD_MAGIC;
+    last.restarts = r.restarts;
+    last.check    = ~r.restarts;
+    last.soft     = 0;
+    last.overMs   = 0;
+    wdCheckpoint(WD_BOOT, 10000);
+    wdtArm();
+    return r;
+}
+
+void wdCheckpoint(WdTask t, uint32_t budgetMs, uint16_t arg) {
+    IrqLock lock;                                   // the early warning reads these together
+    last.at     = millis();
+    last.budget = budgetMs;
+    last.task   = t;
+    last.arg    = arg;
+}
+
+void wdRestart(WdTask t, uint16_t arg) {
+    wdCheckpoint(t, 0, arg);
+    last.soft = 1;
+#ifdef ARDUINO_ARCH_SAMD
+    NVIC_SystemReset();
+#endif
+}
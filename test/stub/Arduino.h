@@ -0,0 +1,192 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <algorithm>
+
+/* ========================================================
+ *  ARDUINO CORE STAND-IN (native env only)
+ *  Just the parts of the core the host-portable modules
+ *  touch, so `pio test -e native` can link src/ without a
+ *  board. ARDUINO and ARDUINO_ARCH_SAMD stay undefined, so
+ *  every module takes its host branch (storage on a
+ *  directory, nvstore on a file, no registers).
+ *  String keeps its bytes in malloc/realloc like the real
+ *  WString, so MEM_COUNT_ALLOCS counts it the same way.
+ *  Clock and serial control for tests: host.h.
+ * ======================================================== */
+
+using std::min;
+using std::max;
+
+#define F(s)      (s)
+#define PROGMEM
+#define HIGH      1
+#define LOW       0
+#define INPUT     0
+#define OUTPUT    1
+#define constrain(a, lo, hi) ((a) < (lo) ? (lo) : ((a) > (hi) ? (hi) : (a)))
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int v);
+int  digitalRead(int pin);
+void noInterrupts();
+void interrupts();
+long random(long hi);
+long random(long lo, long hi);
+
+/* ======================================================== */
+/* |------------------------ String ----------------------| */
+/* ======================================================== */
+class String {
+public:
+    String(const char* s = "");
+    String(const String& o);
+    explicit String(char c);
+    explicit String(int v, unsigned char base = 10);
+    explicit String(unsigned int v, unsigned char base = 10);
+    explicit String(long v, unsigned char base = 10);
+    explicit String(unsigned long v, unsigned char base = 10);
+    explicit String(double v, unsigned char decimals = 2);
+    ~String();
+    String& operator=(const String& o);
+    String& operator=(const char* s);
+
+    unsigned int length() const { return len; }
+    const char*  c_str() const { return buf ? buf : ""; }
+    bool         reserve(unsigned int n);
+    bool         concat(const char* s, unsigned int n);
+    bool         concat(const char* s) { return concat(s, s ? strlen(s) : 0); }
+    bool         concat(const String& s) { return concat(s.c_str(), s.len); }
+    bool         concat(char c) { return concat(&c, 1); }
+
+    String& operator+=(const String& s) { concat(s); return *this; }
+    String& operator+=(const char* s) { concat(s); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+    String& operator+=(int v) { concat(String(v)); return *this; }
+    String& operator+=(unsigned int v) { concat(String(v)); return *this; }
+    String& operator+=(long v) { concat(String(v)); return *this; }
+    String& operator+=(unsigned long v) { concat(String(v)); return *this; }
+
+    char  operator[](unsigned int i) const { return i < len ? buf[i] : '\0'; }
+    char& operator[](unsigned int i);
+    char  charAt(unsigned int i) const { return (*this)[i]; }
+    bool  operator==(const String& o) const { return len == o.len && !memcmp(c_str(), o.c_str(), len); }
+    bool  operator==(const char* s) const { return !strcmp(c_str(), s ? s : ""); }
+    bool  operator!=(const String& o) const { return !(*this == o); }
+    bool  operator!=(const char* s) const { return !(*this == s); }
+    bool  operator<(const String& o) const { return strcmp(c_str(), o.c_str()) < 0; }
+    bool  equals(const String& o) const { return *this == o; }
+
+    int    indexOf(char c, unsigned int from = 0) const;
+    int    indexOf(const char* s, unsigned int from = 0) const;
+    int    indexOf(const String& s, unsigned int from = 0) const { return indexOf(s.c_str(), from); }
+    int    lastIndexOf(char c) const;
+    bool   startsWith(const String& s) const;
+    bool   endsWith(const String& s) const;
+    String substring(unsigned int from) const { return substring(from, len); }
+    String substring(unsigned int from, unsigned int to) const;
+    void   remove(unsigned int at, unsigned int n = (unsigned int)-1);
+    void   replace(const String& what, const String& with);
+    void   trim();
+    void   toCharArray(char* out, unsigned int cap) const;
+    long   toInt() const { return atol(c_str()); }
+    float  toFloat() const { return (float)atof(c_str()); }
+
+private:
+    char*        buf;
+    unsigned int cap;
+    unsigned int len;
+};
+
+String operator+(const String& a, const String& b);
+String operator+(const String& a, const char* b);
+String operator+(const char* a, const String& b);
+String operator+(const String& a, char b);
+
+/* ======================================================== */
+/* |------------------ Print / Stream --------------------| */
+/* ======================================================== */
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) write(p[i]);
+        return n;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t write(const char* s, size_t n) { return write((const uint8_t*)s, n); }
+    virtual int  availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v, int base = 10) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = 10) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+    size_t print(unsigned long v, int base = 10) { return print(String(v, (unsigned char)base)); }
+    size_t print(double v, int decimals = 2) { return print(String(v, (unsigned char)decimals)); }
+    size_t println() { return write("\r\n"); }
+    template <class T> size_t println(const T& v) { return print(v) + println(); }
+    template <class T> size_t println(const T& v, int fmt) { return print(v, fmt) + println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void   setTimeout(unsigned long ms) { timeout = ms; }
+    size_t readBytes(char* out, size_t n);
+protected:
+    unsigned long timeout = 1000;
+};
+
+class HardwareSerial : public Stream {
+public:
+    virtual void begin(unsigned long) {}
+    virtual void begin(unsigned long baud, uint16_t) { begin(baud); }
+    virtual void end() {}
+    virtual operator bool() { return true; }
+    int    available() override { return 0; }
+    int    read() override { return -1; }
+    int    peek() override { return -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+};
+
+/* --- SERCOM UART: no wire behind it; tests attach their own Stream --- */
+class SERCOM {};
+extern SERCOM sercom0, sercom1, sercom2, sercom3, sercom4, sercom5;
+enum SercomRXPad { SERCOM_RX_PAD_0, SERCOM_RX_PAD_1, SERCOM_RX_PAD_2, SERCOM_RX_PAD_3 };
+enum SercomUartTXPad { UART_TX_PAD_0, UART_TX_PAD_2 };
+
+class Uart : public HardwareSerial {
+public:
+    Uart(SERCOM*, uint8_t, uint8_t, SercomRXPad, SercomUartTXPad) {}
+    void IrqHandler() {}
+};
+
+/* SerialUSB: the log console, see hostEcho() */
+class HostConsole : public HardwareSerial {
+public:
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* p, size_t n) override;
+    using Print::write;
+};
+
+extern HostConsole SerialUSB;
+extern Uart        Serial1;
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdio.h>
+#include "host.h"
+#include "memstat.h"
+
+/* ========================================================
+ *  MICRO-BENCHMARK
+ *  Runs a kernel `iters` times and reports wall time, heap
+ *  allocations and peak live heap per call. Allocations are
+ *  counted by memstat's --wrap allocator (MP_UPLOAD phase is
+ *  borrowed for the run), so they are 0 without mem_flags.
+ *  Host ns are only a ratio between implementations: the
+ *  M0+ has no cache, no FPU and a 48 MHz clock.
+ * ======================================================== */
+
+struct BenchResult {
+    double   nsPerOp;
+    double   allocsPerOp;
+    uint32_t peakBytes;         // live heap above the starting level
+};
+
+template <class Fn>
+BenchResult bench(const char* name, uint32_t iters, Fn fn) {
+    for (uint32_t i = 0; i < iters / 10 + 1; ++i) fn();     // warm up
+
+    memReport();                // clear the phase counts
+    MemPhase old = memPhase(MP_UPLOAD);
+    uint32_t live = memStats().liveBytes;
+    memPeakReset();
+    uint64_t t0 = hostNanos();
+    for (uint32_t i = 0; i < iters; ++i) fn();
+    uint64_t ns = hostNanos() - t0;
+    memPhase(old);
+
+    BenchResult r;
+    r.nsPerOp     = (double)ns / iters;
+    r.allocsPerOp = (double)memStats().allocs[MP_UPLOAD] / iters;
+    r.peakBytes   = memStats().heapPeak - live;
+    printf("  %-28s %10.1f ns/op %8.2f allocs/op %7lu B peak\n",
+           name, r.nsPerOp, r.allocsPerOp, (unsigned long)r.peakBytes);
+    return r;
+}
@@ -0,0 +1,331 @@
+#include <Arduino.h>
+#include <chrono>
+#include "host.h"
+#include "storage.h"
+
+/* ======================================================== */
+/* |------------------------ CLOCK -----------------------| */
+/* ======================================================== */
+static uint32_t nowMs = 0;
+static uint32_t tickMs = 1;
+
+void hostClockSet(uint32_t ms, uint32_t tick) {
+    nowMs = ms;
+    tickMs = tick;
+}
+
+void hostClockAdvance(uint32_t ms) {
+    nowMs += ms;
+}
+
+uint32_t hostClockNow() {
+    return nowMs;
+}
+
+unsigned long millis() {
+    uint32_t t = nowMs;
+    nowMs += tickMs;
+    return t;
+}
+
+unsigned long micros() {
+    return (unsigned long)nowMs * 1000UL;
+}
+
+void delay(unsigned long ms) {
+    nowMs += ms;
+}
+
+void delayMicroseconds(unsigned int) {}
+void pinMode(int, int) {}
+void digitalWrite(int, int) {}
+int  digitalRead(int) { return LOW; }
+void noInterrupts() {}
+void interrupts() {}
+long random(long hi) { return hi > 0 ? rand() % hi : 0; }
+long random(long lo, long hi) { return hi > lo ? lo + rand() % (hi - lo) : lo; }
+
+uint64_t hostNanos() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/* ======================================================== */
+/* |------------------------- CARD -----------------------| */
+/* ======================================================== */
+const char* hostCardReset() {
+    static char dir[64];
+    if (dir[0]) {
+        char cmd[96];
+        snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+        if (system(cmd) != 0) return nullptr;
+    }
+    strcpy(dir, "/tmp/gwcardXXXXXX");
+    if (!mkdtemp(dir)) return nullptr;
+    storeRoot(dir);
+    return dir;
+}
+
+std::string hostCardRead(const char* name) {
+    std::string s;
+    StoreFile f = storeOpen(name, ST_READ);
+    if (!f) return s;
+    char b[256];
+    int n;
+    while ((n = f.read(b, sizeof(b))) > 0) s.append(b, n);
+    f.close();
+    return s;
+}
+
+/* ======================================================== */
+/* |------------------------ SERIAL ----------------------| */
+/* ======================================================== */
+SERCOM sercom0, sercom1, sercom2, sercom3, sercom4, sercom5;
+HostConsole SerialUSB;
+Uart        Serial1(&sercom0, 0, 1, SERCOM_RX_PAD_3, UART_TX_PAD_2);
+
+static bool echo = false;
+static std::string console;
+
+void hostEcho(bool on) {
+    echo = on;
+}
+
+std::string& hostConsole() {
+    return console;
+}
+
+size_t HostConsole::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t HostConsole::write(const uint8_t* p, size_t n) {
+    console.append((const char*)p, n);
+    if (echo) fwrite(p, 1, n, stderr);
+    return n;
+}
+
+size_t Stream::readBytes(char* out, size_t n) {
+    size_t got = 0;
+    unsigned long t0 = millis();
+    while (got < n && millis() - t0 < timeout) {
+        int c = read();
+        if (c >= 0) out[got++] = (char)c;
+    }
+    return got;
+}
+
+int ScriptedPort::available() {
+    if (rx.empty()) onIdle();
+    return (int)rx.size();
+}
+
+int ScriptedPort::read() {
+    if (!available()) return -1;
+    uint8_t c = (uint8_t)rx[0];
+    rx.erase(0, 1);
+    return c;
+}
+
+int ScriptedPort::peek() {
+    return available() ? (uint8_t)rx[0] : -1;
+}
+
+size_t ScriptedPort::write(uint8_t b) {
+    sent += (char)b;
+    if (raw) {
+        block += (char)b;
+        if (!--raw) onBlock(block);
+        return 1;
+    }
+    if (b == '\r') return 1;
+    if (b != '\n') {
+        line += (char)b;
+        return 1;
+    }
+    if (line.empty()) return 1;
+    std::string l;
+    l.swap(line);
+    onLine(l);
+    return 1;
+}
+
+/* ======================================================== */
+/* |------------------------ String ----------------------| */
+/* ======================================================== */
+String::String(const char* s) : buf(nullptr), cap(0), len(0) {
+    concat(s);
+}
+
+String::String(const String& o) : buf(nullptr), cap(0), len(0) {
+    concat(o);
+}
+
+String::String(char c) : buf(nullptr), cap(0), len(0) {
+    concat(c);
+}
+
+static void formatInt(String& s, unsigned long v, bool neg, unsigned char base) {
+    char tmp[8 * sizeof(long) + 2];
+    char* p = tmp + sizeof(tmp);
+    *--p = '\0';
+    if (base < 2) base = 10;
+    do {
+        unsigned d = v % base;
+        *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+        v /= base;
+    } while (v);
+    if (neg) *--p = '-';
+    s.concat(p);
+}
+
+String::String(int v, unsigned char base) : String((long)v, base) {}
+String::String(unsigned int v, unsigned char base) : String((unsigned long)v, base) {}
+
+String::String(long v, unsigned char base) : buf(nullptr), cap(0), len(0) {
+    bool neg = v < 0 && base == 10;
+    formatInt(*this, neg ? 0UL - (unsigned long)v : (unsigned long)v, neg, base);
+}
+
+String::String(unsigned long v, unsigned char base) : buf(nullptr), cap(0), len(0) {
+    formatInt(*this, v, false, base);
+}
+
+String::String(double v, unsigned char decimals) : buf(nullptr), cap(0), len(0) {
+    char tmp[40];
+    snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+    concat(tmp);
+}
+
+String::~String() {
+    free(buf);
+}
+
+String& String::operator=(const String& o) {
+    if (this != &o) {
+        len = 0;
+        concat(o);
+    }
+    return *this;
+}
+
+String& String::operator=(const char* s) {
+    len = 0;
+    concat(s);
+    return *this;
+}
+
+bool String::reserve(unsigned int n) {
+    if (buf && cap >= n) return true;
+    char* p = (char*)realloc(buf, n + 1);
+    if (!p) return false;
+    if (!buf) p[0] = '\0';
+    buf = p;
+    cap = n;
+    return true;
+}
+
+bool String::concat(const char* s, unsigned int n) {
+    if (!s) return false;
+    if (!reserve(len + n)) return false;
+    memmove(buf + len, s, n);
+    len += n;
+    buf[len] = '\0';
+    return true;
+}
+
+char& String::operator[](unsigned int i) {
+    static char dummy;
+    if (i >= len) return dummy = '\0';
+    return buf[i];
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    if (from >= len) return -1;
+    const char* p = (const char*)memchr(buf + from, c, len - from);
+    return p ? (int)(p - buf) : -1;
+}
+
+int String::indexOf(const char* s, unsigned int from) const {
+    if (from > len) return -1;
+    const char* p = strstr(c_str() + from, s);
+    return p ? (int)(p - c_str()) : -1;
+}
+
+int String::lastIndexOf(char c) const {
+    for (unsigned int i = len; i-- > 0; )
+        if (buf[i] == c) return (int)i;
+    return -1;
+}
+
+bool String::startsWith(const String& s) const {
+    return s.len <= len && !memcmp(c_str(), s.c_str(), s.len);
+}
+
+bool String::endsWith(const String& s) const {
+    return s.len <= len && !memcmp(c_str() + len - s.len, s.c_str(), s.len);
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (to > len) to = len;
+    String out;
+    if (from < to) out.concat(buf + from, to - from);
+    return out;
+}
+
+void String::remove(unsigned int at, unsigned int n) {
+    if (at >= len) return;
+    if (n > len - at) n = len - at;
+    memmove(buf + at, buf + at + n, len - at - n + 1);
+    len -= n;
+}
+
+void String::replace(const String& what, const String& with) {
+    if (!what.len) return;
+    String out;
+    unsigned int i = 0;
+    for (int at; (at = indexOf(what, i)) >= 0; i = at + what.len) {
+        out.concat(buf + i, at - i);
+        out.concat(with);
+    }
+    out.concat(c_str() + i, len - i);
+    *this = out;
+}
+
+void String::trim() {
+    unsigned int a = 0, b = len;
+    while (a < b && isspace((unsigned char)buf[a])) ++a;
+    while (b > a && isspace((unsigned char)buf[b - 1])) --b;
+    remove(b);
+    remove(0, a);
+}
+
+void String::toCharArray(char* out, unsigned int n) const {
+    if (!n) return;
+    unsigned int k = len < n - 1 ? len : n - 1;
+    memcpy(out, c_str(), k);
+    out[k] = '\0';
+}
+
+String operator+(const String& a, const String& b) { String s(a); s += b; return s; }
+String operator+(const String& a, const char* b)   { String s(a); s += b; return s; }
+String operator+(const char* a, const String& b)   { String s(a); s += b; return s; }
+String operator+(const String& a, char b)          { String s(a); s += b; return s; }
+
+/* ======================================================== */
+/* |--------------- FIRMWARE HOOKS (weak) ----------------| */
+/* ======================================================== */
+__attribute__((weak)) bool sdInit() {
+    return storeBegin(4);
+}
+
+__attribute__((weak)) void timestampRtc(char* date, char* time, char* dayFile) {
+    strcpy(date, "25/08/01");
+    strcpy(time, "12:00:00");
+    strcpy(dayFile, "D250801.CSV");
+}
+
+__attribute__((weak)) uint32_t rtcSecondsOfDay() {
+    return (hostClockNow() / 1000UL) % 86400UL;
+}
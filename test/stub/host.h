@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+/* ========================================================
+ *  HOST TEST SUPPORT
+ *  A clock the test drives, a console it can read back, and
+ *  a scripted modem/radio for the code that talks AT over a
+ *  Stream. Firmware hooks that live in jacob-main.cpp
+ *  (sdInit(), timestampRtc(), rtcSecondsOfDay()) have weak
+ *  defaults in host.cpp; a test defines its own to override.
+ * ======================================================== */
+
+/* --- Clock: millis() advances by `tick` on every read, so bounded
+ * waits in the firmware run out instead of spinning --- */
+void     hostClockSet(uint32_t ms, uint32_t tick = 1);
+void     hostClockAdvance(uint32_t ms);
+uint32_t hostClockNow();
+
+/* --- SerialUSB: kept in hostConsole(); echoed to stderr if asked --- */
+void               hostEcho(bool on);
+std::string&       hostConsole();
+
+/* --- Card: a fresh, empty temp directory as the store root --- */
+const char*        hostCardReset();
+std::string        hostCardRead(const char* name);     // whole file, "" if missing
+
+/* --- Wall clock for the benchmarks --- */
+uint64_t hostNanos();
+
+/* --- Scripted peer on the far side of a UART ---
+ * Bytes the firmware writes are collected into lines and handed
+ * to onLine(); whatever the script puts in rx (say()) is what the
+ * firmware reads back. raw > 0 switches to a counted block (a
+ * CIPSEND body, an MQTT payload) delivered through onBlock(). */
+class ScriptedPort : public Stream {
+public:
+    int    available() override;
+    int    read() override;
+    int    peek() override;
+    size_t write(uint8_t b) override;
+    using Print::write;
+
+    void say(const std::string& s) { rx += s; }
+    void expectBlock(size_t n) { raw = n; block.clear(); }
+
+    std::string rx;             // waiting for the firmware to read
+    std::string sent;           // everything the firmware wrote
+
+protected:
+    virtual void onLine(const std::string& line) = 0;   // CR/LF stripped
+    virtual void onBlock(const std::string&) {}
+    virtual void onIdle() {}                            // firmware polled an empty rx
+
+    std::string line;
+    std::string block;
+    size_t      raw = 0;
+};
@@ -0,0 +1,6 @@
+#pragma once
+#include <Arduino.h>
+
+/* Pin multiplexing has nothing to act on off-target */
+enum EPioType { PIO_SERCOM = 2, PIO_SERCOM_ALT = 3 };
+inline int pinPeripheral(uint32_t, EPioType) { return 0; }
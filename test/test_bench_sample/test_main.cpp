@@ -0,0 +1,135 @@
+#include <unity.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "sample.h"
+#include "textproc.h"
+#include "../test_bench_text/legacy.h"
+
+/* ========================================================
+ *  One whole sample, fix line and EnviroPro blocks in,
+ *  upload fields out: the float / String path the firmware
+ *  had against the scaled-integer Sample path. Reports the
+ *  time, allocations and heap saved per sample.
+ *  The host has an FPU, so the float path looks cheaper
+ *  here than on the M0+, where every atof, float divide and
+ *  String(x, n) is a soft-float library call. The saving
+ *  printed is a lower bound.
+ * ======================================================== */
+
+static const uint32_t ITERS = 20000;
+
+struct Input {
+    std::string fix;            // +CGPSINFO reply
+    std::string temp, moist;    // labelled blocks as assembled
+};
+
+static std::vector<Input> inputs;
+
+static void depthList(std::string& out, int base, int step) {
+    char v[16];
+    for (int d = 0; d < 8; ++d) {
+        TextBuf tb(v, sizeof(v));
+        addFixed(tb, base + d * step, 2);
+        if (d) out += ',';
+        out += v;
+    }
+}
+
+static void buildInputs() {
+    for (int i = 0; i < 32; ++i) {
+        Input in;
+        char l[96];
+        snprintf(l, sizeof(l), "+CGPSINFO: 31%02d.%06d,%c,121%02d.%06d,%c,110825,0728%02d.0,%d.%d,0.0,0",
+                 13 + i % 40, 343286 + i * 997, i & 1 ? 'S' : 'N', 21 + i % 30, 234064 + i * 311,
+                 i & 2 ? 'W' : 'E', i % 60, 40 + i, i % 10);
+        in.fix = l;
+        in.temp = "Temp,";
+        depthList(in.temp, 1800 + i * 7, -25);
+        in.temp += ',';
+        in.moist = "Moist,";
+        depthList(in.moist, 2400 + i * 13, 35);
+        in.moist += ',';
+        inputs.push_back(in);
+    }
+}
+
+/* --- sampleData() and the upload as they were: floats and Strings --- */
+static String legacySample(const Input& in) {
+    String moist = String(in.moist.c_str()).substring(6);
+    String temp  = String(in.temp.c_str()).substring(5);
+    if (moist.endsWith(",")) moist.remove(moist.length() - 1);
+    if (temp.endsWith(","))  temp.remove(temp.length() - 1);
+
+    String gps = parseCoordinates(String(in.fix.c_str()));
+    float airTemp = 25.0, surfaceTemp = 30.0;
+    String ir = String(airTemp, 1) + "," + String(surfaceTemp, 1);
+
+    String row = String("25/08/01") + "\t" + "12:00:00" + "\t";
+    row += gps + "\t";
+    row += temp + "\t" + moist + "\t" + ir;
+    row.replace(" ", "%20");
+    return tsvToFieldString(row);
+}
+
+/* --- the same through Sample: parsed once, formatted once --- */
+static size_t sample(const Input& in, char* row, size_t rowCap, char* fields, size_t fieldCap) {
+    Sample s;
+    if (!parseCgpsInfo(in.fix.c_str(), s.fix)) s.fix = GpsFix{0, 0, 0};
+    sampleParse(in.temp.c_str() + 5, s.value[0], SAMPLE_DEPTHS_MAX, s.depths[0]);
+    sampleParse(in.moist.c_str() + 6, s.value[1], SAMPLE_DEPTHS_MAX, s.depths[1]);
+    s.irAir_dC = 250;
+    s.irSurface_dC = 300;
+
+    TextBuf tb(row, rowCap);
+    sampleRow(s, 2, "25/08/01", "12:00:00", tb);
+    rowSanitize(row, rowCap);
+    TextBuf fb(fields, fieldCap);
+    tsvToFields(row, fb);
+    return fb.len;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_same_fields() {
+    char row[320], fields[512];
+    for (const Input& in : inputs) {
+        String old = legacySample(in);
+        sample(in, row, sizeof(row), fields, sizeof(fields));
+        /* values agree to the float path's rounding; the field layout is identical */
+        std::string a(old.c_str()), b(fields);
+        TEST_ASSERT_EQUAL_INT(std::count(a.begin(), a.end(), '&'), std::count(b.begin(), b.end(), '&'));
+        TEST_ASSERT_EQUAL_INT(std::count(a.begin(), a.end(), ','), std::count(b.begin(), b.end(), ','));
+        TEST_ASSERT_TRUE(b.find("field6=25.0,30.0") != std::string::npos);
+    }
+}
+
+void test_bench_per_sample() {
+    size_t i = 0;
+    char row[320], fields[512];
+    BenchResult old = bench("sample, float + String", ITERS, [&] {
+        volatile unsigned n = legacySample(inputs[i++ % inputs.size()]).length();
+        (void)n;
+    });
+    BenchResult now = bench("sample, scaled integers", ITERS, [&] {
+        volatile size_t n = sample(inputs[i++ % inputs.size()], row, sizeof(row), fields, sizeof(fields));
+        (void)n;
+    });
+    printf("  saved per sample: %.1f ns (%.0f %%), %.2f allocs, %lu B peak heap\n",
+           old.nsPerOp - now.nsPerOp, 100.0 * (old.nsPerOp - now.nsPerOp) / old.nsPerOp,
+           old.allocsPerOp - now.allocsPerOp, (unsigned long)(old.peakBytes - now.peakBytes));
+
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)(now.allocsPerOp * 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, now.peakBytes);
+    TEST_ASSERT_TRUE_MESSAGE(now.nsPerOp < old.nsPerOp, "slower than the float path");
+}
+
+int main() {
+    buildInputs();
+    UNITY_BEGIN();
+    RUN_TEST(test_same_fields);
+    RUN_TEST(test_bench_per_sample);
+    return UNITY_END();
+}
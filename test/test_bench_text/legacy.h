@@ -0,0 +1,132 @@
+#pragma once
+#include <Arduino.h>
+
+/* ========================================================
+ *  The String-based kernels as they were in jacob-main.cpp
+ *  before textproc / ingest / sample replaced them, kept as
+ *  the baseline the benchmark compares against. Debug
+ *  prints and globals stripped; logic unchanged.
+ * ======================================================== */
+
+inline String tsvToFieldString(const String& tsvLine) {
+    String out;
+    int start = 0, fieldNo = 1;
+
+    while (start < (int)tsvLine.length()) {
+        int end = tsvLine.indexOf('\t', start);
+        if (end == -1) end = tsvLine.length();
+
+        String fieldValue = tsvLine.substring(start, end);
+        fieldValue.replace("+", "%2B");
+        fieldValue.replace(" ", "%20");
+
+        out += "field";
+        out += fieldNo++;
+        out += '=';
+        out += fieldValue;
+
+        if (end < (int)tsvLine.length()) out += '&';
+        start = end + 1;
+    }
+    return out;
+}
+
+inline String parseCoordinates(const String& nmeaLine) {
+    int idx = nmeaLine.indexOf(":");
+    if (idx < 0) return "";
+
+    String data = nmeaLine.substring(idx + 1);
+    data.trim();
+
+    int firstComma = data.indexOf(',');
+    if (firstComma < 0 || data[firstComma + 1] == ',') return "";
+
+    String lat = data.substring(0, firstComma);
+    int secondComma = data.indexOf(',', firstComma + 1);
+    String ns = data.substring(firstComma + 1, secondComma);
+    int thirdComma = data.indexOf(',', secondComma + 1);
+    String lon = data.substring(secondComma + 1, thirdComma);
+    int fourthComma = data.indexOf(',', thirdComma + 1);
+    String ew = data.substring(thirdComma + 1, fourthComma);
+
+    int altStart = data.indexOf(',', fourthComma + 1);
+    for (int i = 0; i < 2; i++) altStart = data.indexOf(',', altStart + 1);
+    int altEnd = data.indexOf(',', altStart + 1);
+    String alt = data.substring(altStart + 1, altEnd);
+
+    if (lat.length() == 0 || lon.length() == 0) return "";
+
+    float latDeg = lat.toFloat() / 100.0;
+    float lonDeg = lon.toFloat() / 100.0;
+    float altM = alt.toFloat();
+    if (ns == "S") latDeg = -latDeg;
+    if (ew == "W") lonDeg = -lonDeg;
+
+    return String(latDeg, 6) + "," + String(lonDeg, 6) + "," + String(altM, 1);
+}
+
+/* processChunk(): block assembly into moistBuf / tempBuf */
+struct LegacyChunks {
+    String moistBuf, tempBuf, curType;
+    bool   assembling = false;
+
+    void processChunk(const String& data) {
+        if (data.startsWith("Moist,")) {
+            curType = "Moist";
+            moistBuf = data;
+            assembling = true;
+            return;
+        }
+        if (data.startsWith("Temp,")) {
+            curType = "Temp";
+            tempBuf = data;
+            assembling = true;
+            return;
+        }
+        if (assembling) {
+            if (curType == "Moist")     moistBuf += data;
+            else if (curType == "Temp") tempBuf  += data;
+            if (data.length() < 15) assembling = false;
+        }
+    }
+};
+
+/* sampleData() steps 3, 5-7: strip labels, compose, URL-encode */
+inline String composeRow(const String& moistBuf, const String& tempBuf,
+                         const char* dateStr, const char* timeStr,
+                         float lat, float lon, float alt, float air, float surface) {
+    String moistValues = moistBuf.substring(6);
+    String tempValues  = tempBuf.substring(5);
+    if (moistValues.endsWith(",")) moistValues.remove(moistValues.length() - 1);
+    if (tempValues.endsWith(","))  tempValues.remove(tempValues.length() - 1);
+
+    String gpsData = String(lat, 6) + "," + String(lon, 6) + "," + String(alt, 1);
+    String irData  = String(air, 1) + "," + String(surface, 1);
+
+    String row = String(dateStr) + "\t" + timeStr + "\t";
+    row += gpsData + "\t";
+    row += tempValues + "\t" + moistValues + "\t" + irData;
+    row.replace("\n", "");
+    row.replace(" ", "%20");
+    return row;
+}
+
+/* sdUploadChrono() step 3: a byte at a time into a String */
+template <class Src, class Fn>
+uint32_t readRowsLegacy(Src& f, Fn onRow) {
+    uint32_t rows = 0;
+    String row = "";
+    int c;
+    while ((c = f.read()) >= 0) {
+        if (c == '\n') {
+            row.trim();
+            if (!row.length()) continue;
+            onRow(row.c_str());
+            rows++;
+            row = "";
+        } else if (c != '\r') {
+            row += (char)c;
+        }
+    }
+    return rows;
+}
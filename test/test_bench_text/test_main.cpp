@@ -0,0 +1,210 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "ingest.h"
+#include "legacy.h"
+#include "sample.h"
+#include "textproc.h"
+
+/* ========================================================
+ *  Text kernels, current vs the String versions they
+ *  replaced (legacy.h), over corpora shaped like the field
+ *  data. Each pair prints ns/op, allocs/op and peak heap;
+ *  the test fails if a current kernel allocates or falls
+ *  behind the one it replaced.
+ * ======================================================== */
+
+static const uint32_t ITERS = 20000;
+
+static std::vector<std::string> rows;          // stored TSV rows
+static std::vector<std::string> fixes;         // +CGPSINFO replies
+static std::vector<std::string> packets;       // I²C packets, Temp then Moist block
+static std::string              dayFile;       // rows as on the card
+
+static void depthList(char* out, size_t cap, int base, int step) {
+    TextBuf tb(out, cap);
+    for (int d = 0; d < 8; ++d) {
+        if (d) tb.add(',');
+        addFixed(tb, base + d * step, 2);
+    }
+}
+
+static void buildCorpora() {
+    char temp[96], moist[96], row[320];
+    for (int i = 0; i < 48; ++i) {
+        depthList(temp, sizeof(temp), 1800 + i * 7, -25);
+        depthList(moist, sizeof(moist), 2400 + i * 13, 35);
+        snprintf(row, sizeof(row),
+                 "25/08/%02d\t%02d:%02d:00\t31.%06d,-121.%06d,4%d.%d\t%s\t%s\t2%d.%d,3%d.%d",
+                 1 + i / 24, i % 24, (i * 7) % 60, 222238 + i * 31, 354401 + i * 17,
+                 i % 10, i % 7, temp, moist, i % 10, i % 9, i % 5, i % 3);
+        rows.push_back(row);
+        dayFile += row;
+        dayFile += "\r\n";
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        char l[96];
+        snprintf(l, sizeof(l), "+CGPSINFO: 31%02d.%06d,%c,121%02d.%06d,%c,110825,0728%02d.0,%d.%d,0.0,0",
+                 13 + i % 40, 343286 + i * 997, i & 1 ? 'S' : 'N', 21 + i % 30, 234064 + i * 311,
+                 i & 2 ? 'W' : 'E', i % 60, 40 + i, i % 10);
+        fixes.push_back(l);
+    }
+    fixes.push_back("+CGPSINFO: ,,,,,,,,");
+
+    /* 20-byte packets: both blocks end on a packet shorter than
+     * INGEST_END_LEN, as the EnviroPro's do */
+    const char* blocks[] = {"Temp,", "Moist,"};
+    for (int b = 0; b < 2; ++b) {
+        char vals[96];
+        depthList(vals, sizeof(vals), b ? 2400 : 1800, b ? 35 : -25);
+        std::string block = std::string(blocks[b]) + vals + ",";
+        for (size_t at = 0; at < block.size(); at += 20) packets.push_back(block.substr(at, 20));
+    }
+}
+
+/* The card file, read as StoreFile would hand it over */
+struct MemFile {
+    const std::string& s;
+    size_t at;
+    explicit MemFile(const std::string& src) : s(src), at(0) {}
+    int read() { return at < s.size() ? (uint8_t)s[at++] : -1; }
+    int read(void* out, size_t n) {
+        if (n > s.size() - at) n = s.size() - at;
+        memcpy(out, s.data() + at, n);
+        at += n;
+        return (int)n;
+    }
+};
+
+static void gate(const BenchResult& legacy, const BenchResult& now) {
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)(now.allocsPerOp * 1000));
+    TEST_ASSERT_EQUAL_UINT32(0, now.peakBytes);
+    TEST_ASSERT_TRUE_MESSAGE(now.nsPerOp < legacy.nsPerOp, "slower than the String version");
+}
+
+void setUp() {}
+void tearDown() {}
+
+/* ======================================================== */
+void test_tsv_fields_match_legacy() {
+    char out[512];
+    for (size_t i = 0; i < rows.size(); ++i) {
+        TextBuf tb(out, sizeof(out));
+        TEST_ASSERT_TRUE(tsvToFields(rows[i].c_str(), tb));
+        String legacy = tsvToFieldString(rows[i].c_str());
+        TEST_ASSERT_EQUAL_STRING(legacy.c_str(), out);
+    }
+}
+
+void test_bench_tsv_fields() {
+    size_t i = 0;
+    char out[512];
+    String in;
+    BenchResult old = bench("tsvToFieldString", ITERS, [&] {
+        in = rows[i++ % rows.size()].c_str();       // the row arrived as a String
+        volatile unsigned n = tsvToFieldString(in).length();
+        (void)n;
+    });
+    BenchResult now = bench("tsvToFields", ITERS, [&] {
+        TextBuf tb(out, sizeof(out));
+        tsvToFields(rows[i++ % rows.size()].c_str(), tb);
+    });
+    gate(old, now);
+}
+
+void test_bench_coordinates() {
+    size_t i = 0;
+    char out[48];
+    String in;
+    BenchResult old = bench("parseCoordinates", ITERS, [&] {
+        in = fixes[i++ % fixes.size()].c_str();
+        volatile unsigned n = parseCoordinates(in).length();
+        (void)n;
+    });
+    BenchResult now = bench("parseCgpsInfo+formatFix", ITERS, [&] {
+        GpsFix f;
+        TextBuf tb(out, sizeof(out));
+        if (parseCgpsInfo(fixes[i++ % fixes.size()].c_str(), f)) formatFix(f, tb);
+    });
+    gate(old, now);
+}
+
+void test_bench_chunk_assembly() {
+    static const IngestType TYPES[] = {{"Temp", true}, {"Moist", true}};
+    std::vector<String> asStrings;
+    for (size_t k = 0; k < packets.size(); ++k) asStrings.push_back(String(packets[k].c_str()));
+
+    LegacyChunks lc;
+    BenchResult old = bench("processChunk (String)", ITERS, [&] {
+        for (size_t k = 0; k < asStrings.size(); ++k) lc.processChunk(asStrings[k]);
+    });
+    Ingest ing(TYPES, 2);
+    BenchResult now = bench("Ingest::feed", ITERS, [&] {
+        for (size_t k = 0; k < packets.size(); ++k) ing.feed(packets[k].data(), packets[k].size());
+    });
+    TEST_ASSERT_TRUE(ing.ready());
+    String temp = lc.tempBuf.substring(5);         // label and trailing ',' off, as sampleData() did
+    if (temp.endsWith(",")) temp.remove(temp.length() - 1);
+    TEST_ASSERT_EQUAL_STRING(temp.c_str(), ing.values(0));
+    gate(old, now);
+}
+
+void test_bench_row_composition() {
+    char temp[96], moist[96];
+    depthList(temp, sizeof(temp), 1800, -25);
+    depthList(moist, sizeof(moist), 2400, 35);
+    String tempBuf = String("Temp,") + temp + ",";
+    String moistBuf = String("Moist,") + moist + ",";
+
+    BenchResult old = bench("sampleData row (String)", ITERS, [&] {
+        volatile unsigned n = composeRow(moistBuf, tempBuf, "25/08/01", "12:00:00",
+                                         31.222238f, -121.354401f, 44.1f, 25.0f, 30.0f).length();
+        (void)n;
+    });
+
+    const char* values[2] = {temp, moist};
+    char row[320];
+    BenchResult now = bench("sampleParse+sampleRow", ITERS, [&] {
+        Sample s;
+        s.fix = GpsFix{31222238, -121354401, 441};
+        for (uint8_t t = 0; t < 2; ++t) sampleParse(values[t], s.value[t], SAMPLE_DEPTHS_MAX, s.depths[t]);
+        s.irAir_dC = 250;
+        s.irSurface_dC = 300;
+        TextBuf tb(row, sizeof(row));
+        sampleRow(s, 2, "25/08/01", "12:00:00", tb);
+        rowSanitize(row, sizeof(row));
+    });
+    gate(old, now);
+}
+
+void test_bench_line_reader() {
+    uint32_t oldRows = 0, newRows = 0;
+    BenchResult old = bench("row += c (String)", ITERS / 100, [&] {
+        MemFile f(dayFile);
+        oldRows = readRowsLegacy(f, [](const char*) {});
+    });
+    char line[320];
+    BenchResult now = bench("LineReader<512>", ITERS / 100, [&] {
+        MemFile f(dayFile);
+        LineReader<MemFile, 512> lr(f);
+        newRows = 0;
+        while (lr.next(line, sizeof(line)) >= 0) newRows++;
+    });
+    TEST_ASSERT_EQUAL_UINT32(rows.size(), oldRows);
+    TEST_ASSERT_EQUAL_UINT32(rows.size(), newRows);
+    gate(old, now);
+}
+
+int main() {
+    buildCorpora();
+    UNITY_BEGIN();
+    RUN_TEST(test_tsv_fields_match_legacy);
+    RUN_TEST(test_bench_tsv_fields);
+    RUN_TEST(test_bench_coordinates);
+    RUN_TEST(test_bench_chunk_assembly);
+    RUN_TEST(test_bench_row_composition);
+    RUN_TEST(test_bench_line_reader);
+    return UNITY_END();
+}
@@ -0,0 +1,205 @@
+#include <unity.h>
+#include <string.h>
+#include "dmaring.h"
+
+/* ========================================================
+ *  DMA descriptors and the circular RX ring, against a
+ *  stand-in DMAC that writes the buffer round and round and
+ *  reports what the real one does: BTCNT of the current
+ *  block and the laps counted by the block interrupt, in
+ *  either order around a block end.
+ * ======================================================== */
+
+static const uint16_t RING = 64;
+
+/* Writes the ring like the channel does; byte i of the stream is pattern(i) */
+struct FakeDmac {
+    uint8_t* buf;
+    uint32_t total = 0;
+
+    explicit FakeDmac(uint8_t* b) : buf(b) {}
+
+    static uint8_t pattern(uint32_t i) { return (uint8_t)(i * 7 + (i >> 8) + 3); }
+
+    void receive(uint32_t n) {
+        while (n--) {
+            buf[total % RING] = pattern(total);
+            total++;
+        }
+    }
+    uint16_t left() const { return RING - total % RING; }
+    uint32_t laps() const { return total / RING; }
+};
+
+static uint8_t buf[RING];
+
+void setUp() {
+    memset(buf, 0, sizeof(buf));
+}
+
+void tearDown() {}
+
+/* ======================================================== */
+void test_descriptor_layout() {
+    TEST_ASSERT_EQUAL_size_t(16, sizeof(DmaDesc));
+
+    static uint8_t data[32];
+    const uint32_t REG = 0x42000828;            // SERCOM DATA
+    DmaDesc tx = dmaDescToPeriph(data, 32, REG);
+    TEST_ASSERT_EQUAL_HEX16(DMA_BT_VALID | DMA_BT_BLOCKINT | DMA_BT_SRCINC, tx.btctrl);
+    TEST_ASSERT_EQUAL_UINT16(32, tx.btcnt);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)(data + 32), tx.srcaddr);   // one past the end
+    TEST_ASSERT_EQUAL_HEX32(REG, tx.dstaddr);
+    TEST_ASSERT_EQUAL_HEX32(0, tx.descaddr);
+
+    DmaDesc rx = dmaDescFromPeriph(REG, data, 16);
+    TEST_ASSERT_EQUAL_HEX16(DMA_BT_VALID | DMA_BT_BLOCKINT | DMA_BT_DSTINC, rx.btctrl);
+    TEST_ASSERT_EQUAL_HEX32(REG, rx.srcaddr);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)(data + 16), rx.dstaddr);
+
+    static const uint8_t ff = 0xFF;
+    DmaDesc fill = dmaDescFill(&ff, 512, REG);
+    TEST_ASSERT_EQUAL_HEX16(0, fill.btctrl & DMA_BT_SRCINC);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)&ff, fill.srcaddr);           // not advanced
+    TEST_ASSERT_EQUAL_UINT16(512, fill.btcnt);
+
+    uint8_t sink;
+    DmaDesc drain = dmaDescDrain(REG, &sink, 512);
+    TEST_ASSERT_EQUAL_HEX16(0, drain.btctrl & DMA_BT_DSTINC);
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)&sink, drain.dstaddr);
+}
+
+void test_read_in_order() {
+    DmaRxRing r(buf, RING);
+    FakeDmac d(buf);
+    TEST_ASSERT_EQUAL_INT(-1, r.read());
+
+    d.receive(10);
+    r.sync(d.laps(), d.left());
+    TEST_ASSERT_EQUAL_UINT16(10, r.available());
+    TEST_ASSERT_EQUAL_INT(FakeDmac::pattern(0), r.peek());
+    for (uint32_t i = 0; i < 10; ++i) TEST_ASSERT_EQUAL_INT(FakeDmac::pattern(i), r.read());
+    TEST_ASSERT_EQUAL_INT(-1, r.peek());
+}
+
+/* A bulk read that runs over the end of the buffer */
+void test_bulk_read_across_the_wrap() {
+    DmaRxRing r(buf, RING);
+    FakeDmac d(buf);
+    d.receive(50);
+    r.sync(d.laps(), d.left());
+    uint8_t out[RING];
+    TEST_ASSERT_EQUAL_size_t(50, r.read(out, 50));
+
+    d.receive(40);                              // 14 to the end, 26 from the start
+    r.sync(d.laps(), d.left());
+    TEST_ASSERT_EQUAL_size_t(40, r.read(out, sizeof(out)));
+    for (uint32_t i = 0; i < 40; ++i) TEST_ASSERT_EQUAL_UINT8(FakeDmac::pattern(50 + i), out[i]);
+    TEST_ASSERT_EQUAL_UINT32(0, r.overruns());
+}
+
+/* Around a block end the two counts change separately. Both
+ * consistent views give the same total; a reloaded block whose
+ * interrupt hasn't run yet reads as a step back and is ignored. */
+void test_block_end_orders() {
+    DmaRxRing r(buf, RING);
+    FakeDmac d(buf);
+    d.receive(RING);
+
+    r.sync(0, 0);                               // block done, lap not counted
+    TEST_ASSERT_EQUAL_UINT16(RING, r.available());
+    r.sync(1, RING);                            // counted, next block loaded
+    TEST_ASSERT_EQUAL_UINT16(RING, r.available());
+
+    uint8_t out[RING];
+    r.read(out, RING);
+    d.receive(3);
+    r.sync(1, RING - 3);
+    TEST_ASSERT_EQUAL_UINT16(3, r.available());
+    r.sync(0, RING - 5);                        // reloaded again, interrupt pending
+    TEST_ASSERT_EQUAL_UINT16(3, r.available());
+    TEST_ASSERT_EQUAL_UINT32(0, r.overruns());
+    r.sync(1, RING + 1);                        // BTCNT out of range: ignored
+    TEST_ASSERT_EQUAL_UINT16(3, r.available());
+}
+
+/* Lapped by the DMAC: the oldest bytes are gone, counted, and
+ * reading resumes at the oldest one still there */
+void test_overrun() {
+    DmaRxRing r(buf, RING);
+    FakeDmac d(buf);
+    d.receive(10);
+    r.sync(d.laps(), d.left());
+    TEST_ASSERT_EQUAL_INT(FakeDmac::pattern(0), r.read());
+
+    d.receive(2 * RING + 5);
+    r.sync(d.laps(), d.left());
+    TEST_ASSERT_EQUAL_UINT16(RING, r.available());
+    TEST_ASSERT_EQUAL_UINT32(d.total - 1 - RING, r.overruns());
+    TEST_ASSERT_EQUAL_INT(FakeDmac::pattern(d.total - RING), r.read());
+}
+
+/* The running counts wrap at 2^32; a power-of-two size keeps them
+ * aligned with the buffer */
+void test_counter_wrap() {
+    DmaRxRing r(buf, RING);
+    uint32_t laps = 0xFFFFFFFFu / RING;         // last lap before the byte count wraps
+    r.sync(laps, RING);
+    uint8_t out[RING];
+    r.read(out, sizeof(out));
+    TEST_ASSERT_EQUAL_UINT16(0, r.available());
+
+    for (uint16_t i = 0; i < RING; ++i) buf[i] = (uint8_t)i;
+    r.sync(laps + 1, 0);                        // one full block later
+    TEST_ASSERT_EQUAL_UINT16(RING, r.available());
+    r.sync(laps + 1, RING);
+    TEST_ASSERT_EQUAL_UINT16(RING, r.available());
+    for (uint16_t i = 0; i < RING; ++i) TEST_ASSERT_EQUAL_INT(i, r.read());
+    TEST_ASSERT_EQUAL_UINT32(0, r.overruns());
+}
+
+/* Bursts of any length, syncs seen from either side of a block end,
+ * reads of any size: every byte that comes out is the next one of
+ * the stream, and every byte that doesn't is counted as lost */
+void test_random_traffic() {
+    uint32_t rng = 0xDEC0DE;
+    auto rnd = [&](uint32_t n) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng % n;
+    };
+
+    DmaRxRing r(buf, RING);
+    FakeDmac d(buf);
+    uint32_t readCount = 0;
+    uint8_t out[RING];
+    for (int step = 0; step < 200000; ++step) {
+        d.receive(rnd(3 * RING / 2));
+        uint32_t laps = d.laps();
+        uint16_t left = d.left();
+        if (left == RING && laps && rnd(2)) { laps--; left = 0; }  // interrupt not run yet
+        r.sync(laps, left);
+
+        size_t n = r.read(out, 1 + rnd(RING));
+        uint32_t start = readCount + r.overruns();
+        for (size_t i = 0; i < n; ++i) TEST_ASSERT_EQUAL_UINT8(FakeDmac::pattern(start + i), out[i]);
+        readCount += n;
+    }
+    r.sync(d.laps(), d.left());
+    readCount += r.read(out, sizeof(out));
+    TEST_ASSERT_EQUAL_UINT32(d.total, readCount + r.overruns());
+    TEST_ASSERT_GREATER_THAN(0, r.overruns());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_descriptor_layout);
+    RUN_TEST(test_read_in_order);
+    RUN_TEST(test_bulk_read_across_the_wrap);
+    RUN_TEST(test_block_end_orders);
+    RUN_TEST(test_overrun);
+    RUN_TEST(test_counter_wrap);
+    RUN_TEST(test_random_traffic);
+    return UNITY_END();
+}
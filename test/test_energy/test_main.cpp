@@ -0,0 +1,66 @@
+#include <unity.h>
+#include <string>
+#include "energy.h"
+#include "host.h"
+
+/* ========================================================
+ *  Energy accounting on the host clock: nesting deeper
+ *  than the scope stack, and the status text cut to fit
+ *  the upload field.
+ * ======================================================== */
+
+void setUp() {
+    TEST_ASSERT_NOT_NULL(hostCardReset());
+    hostClockSet(0, 0);
+    energyBegin();
+}
+
+void tearDown() {}
+
+/* Scopes past the stack's depth charge the deepest recorded state
+ * and still unwind in step */
+void test_nesting_past_stack_depth() {
+    energyEnter(EN_UPLOAD);
+    for (int i = 0; i < 12; ++i) energyEnter(EN_SD);
+    hostClockAdvance(1000);
+    for (int i = 0; i < 12; ++i) energyExit();
+    hostClockAdvance(2000);
+    energyExit();
+    hostClockAdvance(4000);
+    energyCycleEnd();
+
+    const EnergyRecord& r = energyLastCycle();
+    TEST_ASSERT_EQUAL_UINT32(1000, r.ms[EN_SD]);
+    TEST_ASSERT_EQUAL_UINT32(2000, r.ms[EN_UPLOAD]);
+    TEST_ASSERT_EQUAL_UINT32(4000, r.ms[EN_AWAKE]);
+}
+
+/* A short buffer ends on a whole field, never inside a %20 */
+void test_status_stops_at_last_whole_field() {
+    static const EnergyState STATES[] = {EN_LTE, EN_UPLOAD, EN_SAMPLE, EN_GPS, EN_SD, EN_SLEEP};
+    for (EnergyState s : STATES) {
+        energyEnter(s);
+        hostClockAdvance(12000);
+        energyExit();
+    }
+    energyCycleEnd();
+
+    char full[96];
+    TEST_ASSERT_TRUE(energyStatus(full, sizeof(full)));
+    std::string all = full;
+    for (size_t len = 1; len <= all.size() + 1; ++len) {
+        char out[96];
+        TEST_ASSERT_TRUE(energyStatus(out, len));
+        std::string got = out;
+        TEST_ASSERT_TRUE(got.size() < len);
+        TEST_ASSERT_TRUE(all.compare(0, got.size(), got) == 0);
+        TEST_ASSERT_TRUE(got.empty() || got.size() == all.size() || all.compare(got.size(), 3, "%20") == 0);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_nesting_past_stack_depth);
+    RUN_TEST(test_status_stops_at_last_whole_field);
+    return UNITY_END();
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include "host.h"
+#include "nodeframe.h"
+
+/* ========================================================
+ *  RYLR993 STAND-IN
+ *  Answers the AT commands lora.cpp sends (+OK, +READY),
+ *  takes AT+SEND payloads as raw bytes, and turns frames
+ *  from virtual field nodes into "+RCV=" lines, the way the
+ *  module reports them. A sleeping module (AT+MODE=1) hears
+ *  nothing: frames sent meanwhile are lost and counted.
+ * ======================================================== */
+
+class Rylr993 : public ScriptedPort {
+public:
+    struct Sent {
+        uint16_t             to;
+        std::vector<uint8_t> data;
+    };
+
+    bool              awake = true;
+    uint16_t          address = 0;
+    uint32_t          lost = 0;           // frames that arrived while asleep
+    std::vector<Sent> sends;
+
+    /* A field node transmits; the gateway's module reports it */
+    void receive(uint16_t from, const uint8_t* p, size_t n, int rssi = -72, int snr = 9) {
+        if (!awake) { lost++; return; }
+        char head[32], tail[24];
+        snprintf(head, sizeof(head), "+RCV=%u,%u,", from, (unsigned)n);
+        snprintf(tail, sizeof(tail), ",%d,%d\r\n", rssi, snr);
+        rx += head;
+        rx.append((const char*)p, n);
+        rx += tail;
+    }
+
+    void receive(const NodeFrame& f, int rssi = -72, int snr = 9) {
+        uint8_t b[NODE_FRAME_MAX];
+        size_t n = nodeFrameEncode(f, b, sizeof(b));
+        receive(f.addr, b, n, rssi, snr);
+    }
+
+    /* AT+SEND=<addr>,<len>,<bytes>: the payload is binary, so it is
+     * counted off as soon as the header is complete */
+    size_t write(uint8_t b) override {
+        if (!awake) {                       // any UART byte wakes it
+            awake = true;
+            say("+READY\r\n");
+        }
+        if (sendLeft) {
+            sends.back().data.push_back(b);
+            if (!--sendLeft) say("+OK\r\n");
+            return 1;
+        }
+        if (sendDone && (b == '\r' || b == '\n')) return 1;
+        sendDone = false;
+        ScriptedPort::write(b);
+        unsigned to, len;
+        char comma;
+        if (b == ',' && sscanf(line.c_str(), "AT+SEND=%u,%u%c", &to, &len, &comma) == 3 &&
+            line.size() > 8 && std::count(line.begin(), line.end(), ',') == 2) {
+            line.clear();
+            sends.push_back(Sent{(uint16_t)to, {}});
+            sendLeft = len;
+            sendDone = true;
+            if (!len) say("+OK\r\n");
+        }
+        return 1;
+    }
+    using Print::write;
+
+protected:
+    void onLine(const std::string& l) override {
+        if (l == "AT+MODE=0") { awake = true; say("+OK\r\n"); }
+        else if (l == "AT+MODE=1") { say("+OK\r\n"); awake = false; }
+        else if (!l.compare(0, 11, "AT+ADDRESS=")) { address = atoi(l.c_str() + 11); say("+OK\r\n"); }
+        else if (!l.compare(0, 2, "AT")) say("+OK\r\n");
+    }
+
+private:
+    size_t sendLeft = 0;
+    bool   sendDone = false;
+};
@@ -0,0 +1,128 @@
+#include <unity.h>
+#include <string>
+#include "host.h"
+#include "lora.h"
+#include "rylr993.h"
+#include "sdlog.h"
+
+/* ========================================================
+ *  LoRa ingest against the RYLR993 stand-in: node frames in
+ *  over "+RCV=", rows out into the backlog day file.
+ * ======================================================== */
+
+static Rylr993* radio;
+
+static NodeFrame frame(uint16_t addr, uint8_t seq, uint8_t depths) {
+    NodeFrame f;
+    memset(&f, 0, sizeof(f));
+    f.addr = addr;
+    f.seq = seq;
+    f.depths = depths;
+    for (uint8_t i = 0; i < depths; ++i) {
+        f.temp[i]  = (int16_t)(2150 - 25 * i);
+        f.moist[i] = (int16_t)(3100 + 40 * i);
+    }
+    f.battery_mV = 3710;
+    return f;
+}
+
+static std::string dayFile() {
+    sdlogFlush();
+    return hostCardRead("D250801.CSV");         // host.cpp's timestampRtc()
+}
+
+void setUp() {
+    sdlogClose();
+    TEST_ASSERT_NOT_NULL(hostCardReset());
+    hostClockSet(0);
+    radio = new Rylr993;
+    loraAttach(*radio);
+}
+
+void tearDown() {
+    sdlogClose();
+    delete radio;
+}
+
+void test_wake_and_sleep() {
+    radio->awake = false;
+    TEST_ASSERT_TRUE(loraOn());
+    TEST_ASSERT_TRUE(radio->awake);
+    loraOff();
+    TEST_ASSERT_FALSE(radio->awake);
+    TEST_ASSERT_TRUE(radio->sent.find("AT+MODE=1\r\n") != std::string::npos);
+}
+
+void test_frames_become_rows() {
+    radio->receive(frame(2, 7, 3), -80, 6);
+    radio->receive(frame(3, 1, 1), -101, -4);
+    TEST_ASSERT_EQUAL_UINT8(2, loraService());
+
+    std::string rows = dayFile();
+    TEST_ASSERT_TRUE(rows.find("\tN2\t21.50,21.25,21.00\t31.00,31.40,31.80\t-80,6,3710") != std::string::npos);
+    TEST_ASSERT_TRUE(rows.find("\tN3\t21.50\t31.00\t-101,-4,3710") != std::string::npos);
+}
+
+/* Payload bytes that look like the line syntax (',', CR, LF) are data */
+void test_binary_payload_is_taken_by_length() {
+    NodeFrame f = frame(4, ',', 2);
+    f.temp[0] = 0x0A0D;                         // CR LF
+    f.temp[1] = 0x2C2C;                         // ",,"
+    f.battery_mV = 0x0A2C;
+    radio->receive(f);
+    TEST_ASSERT_EQUAL_UINT8(1, loraService());
+    TEST_ASSERT_TRUE(dayFile().find("\tN4\t25.73,113.08\t") != std::string::npos);
+}
+
+/* The UART hands bytes over in whatever pieces it likes */
+void test_frame_split_across_services() {
+    Rylr993 whole;
+    whole.receive(frame(5, 9, 4));
+    std::string line = whole.rx;
+    for (size_t at = 0; at < line.size(); at += 7) {
+        radio->say(line.substr(at, 7));
+        uint8_t n = loraService();
+        TEST_ASSERT_EQUAL_UINT8(at + 7 >= line.size() ? 1 : 0, n);
+    }
+}
+
+void test_bad_frames_are_dropped() {
+    const uint8_t wrongVersion[] = {0x02, 1, 1, 0, 0, 0, 0, 0, 0};
+    const uint8_t shortFrame[]   = {NODE_FRAME_V1, 1, 3, 0, 0};
+    radio->receive(6, wrongVersion, sizeof(wrongVersion));
+    radio->receive(6, shortFrame, sizeof(shortFrame));
+    radio->say("+RCV=6,xx,garbage\r\n+ERR=2\r\n");
+    radio->receive(frame(7, 1, 1));
+    TEST_ASSERT_EQUAL_UINT8(1, loraService());
+    std::string rows = dayFile();
+    TEST_ASSERT_TRUE(rows.find("\tN6\t") == std::string::npos);
+    TEST_ASSERT_TRUE(rows.find("\tN7\t") != std::string::npos);
+}
+
+void test_send_is_binary_safe() {
+    const uint8_t beacon[] = {'B', 0x0D, 0x0A, ',', 0x00, 0xFF};
+    TEST_ASSERT_TRUE(loraSend(LORA_BROADCAST, beacon, sizeof(beacon)));
+    TEST_ASSERT_EQUAL_size_t(1, radio->sends.size());
+    TEST_ASSERT_EQUAL_UINT16(LORA_BROADCAST, radio->sends[0].to);
+    TEST_ASSERT_EQUAL_size_t(sizeof(beacon), radio->sends[0].data.size());
+    TEST_ASSERT_EQUAL_MEMORY(beacon, radio->sends[0].data.data(), sizeof(beacon));
+}
+
+void test_sleeping_radio_loses_frames() {
+    loraOff();
+    radio->receive(frame(2, 1, 1));
+    TEST_ASSERT_EQUAL_UINT8(0, loraService());
+    TEST_ASSERT_EQUAL_UINT32(1, radio->lost);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_wake_and_sleep);
+    RUN_TEST(test_frames_become_rows);
+    RUN_TEST(test_binary_payload_is_taken_by_length);
+    RUN_TEST(test_frame_split_across_services);
+    RUN_TEST(test_bad_frames_are_dropped);
+    RUN_TEST(test_send_is_binary_safe);
+    RUN_TEST(test_sleeping_radio_loses_frames);
+    return UNITY_END();
+}
@@ -0,0 +1,101 @@
+#include <unity.h>
+#include "host.h"
+#include "memstat.h"
+#include "textproc.h"
+
+/* ========================================================
+ *  memstat: the counting allocator under the native env's
+ *  --wrap flags. Catches String-heavy paths that start to
+ *  allocate, and kernels that stop being allocation-free.
+ * ======================================================== */
+
+static void* volatile keep;         // stops the compiler pairing up malloc/free
+
+static void* grab(size_t n) {
+    return keep = malloc(n);
+}
+
+void setUp() {
+    memReport();                    // clear the per-phase counts
+}
+
+void tearDown() {
+    memPhase(MP_IDLE);
+}
+
+void test_counts_string_growth_in_phase() {
+    MemPhase old = memPhase(MP_SAMPLE);
+    {
+        String s;
+        for (int i = 0; i < 40; ++i) s += "0123456789";
+        TEST_ASSERT_EQUAL_UINT(400, s.length());
+    }
+    memPhase(old);
+
+    const MemStats& m = memStats();
+    TEST_ASSERT_GREATER_OR_EQUAL(1, m.allocs[MP_SAMPLE]);
+    TEST_ASSERT_GREATER_OR_EQUAL(400, m.allocBytes[MP_SAMPLE]);
+    TEST_ASSERT_EQUAL_UINT32(0, m.allocs[MP_UPLOAD]);
+}
+
+void test_scope_attributes_and_restores() {
+    memPhase(MP_IDLE);
+    {
+        MemPhaseScope ms(MP_UPLOAD);
+        free(grab(100));
+    }
+    TEST_ASSERT_EQUAL(MP_IDLE, memPhase(MP_IDLE));
+    TEST_ASSERT_EQUAL_UINT32(1, memStats().allocs[MP_UPLOAD]);
+    TEST_ASSERT_EQUAL_UINT32(100, memStats().allocBytes[MP_UPLOAD]);
+}
+
+void test_live_bytes_return_after_free() {
+    uint32_t live = memStats().liveBytes;
+    void* a = grab(1000);
+    void* b = keep = realloc(grab(10), 3000);
+    TEST_ASSERT_GREATER_OR_EQUAL(live + 4000, memStats().liveBytes);
+    TEST_ASSERT_GREATER_OR_EQUAL(live + 4000, memStats().heapPeak);
+    free(a);
+    free(b);
+    TEST_ASSERT_EQUAL_UINT32(live, memStats().liveBytes);
+}
+
+void test_report_clears_phase_counts() {
+    memPhase(MP_SAMPLE);
+    free(grab(16));
+    memPhase(MP_IDLE);
+    TEST_ASSERT_GREATER_OR_EQUAL(1, memStats().allocs[MP_SAMPLE]);
+    memReport();
+    for (uint8_t i = 0; i < MP_COUNT; ++i) TEST_ASSERT_EQUAL_UINT32(0, memStats().allocs[i]);
+}
+
+/* The row / URL / fix kernels replaced String code in the sample
+ * and upload paths; they must not allocate at all */
+void test_text_kernels_do_not_allocate() {
+    memPhase(MP_UPLOAD);
+    char out[256];
+    TextBuf tb(out, sizeof(out));
+    tsvToFields("25/08/01\t12:00:00\t1.25\t-3.5\t0.00 0.01", tb);
+    char row[64] = "25/08/01\t12:00:00\t1 2\r\n";
+    rowSanitize(row, sizeof(row));
+    GpsFix fix;
+    parseCgpsInfo("+CGPSINFO: 3113.343286,N,12121.234064,E,250811,072809.3,44.1,0.0,0", fix);
+    TextBuf fb(out, sizeof(out));
+    formatFix(fix, fb);
+    memPhase(MP_IDLE);
+    TEST_ASSERT_EQUAL_UINT32(0, memStats().allocs[MP_UPLOAD]);
+}
+
+int main() {
+#ifndef MEM_COUNT_ALLOCS
+    return 0;                       // nothing to count without the --wrap flags
+#endif
+    memBegin();
+    UNITY_BEGIN();
+    RUN_TEST(test_counts_string_growth_in_phase);
+    RUN_TEST(test_scope_attributes_and_restores);
+    RUN_TEST(test_live_bytes_return_after_free);
+    RUN_TEST(test_report_clears_phase_counts);
+    RUN_TEST(test_text_kernels_do_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "host.h"
+
+/* ========================================================
+ *  SIM7600 CMQTT STAND-IN, WITH A THINGSPEAK-LIKE BROKER
+ *  Client 0 only. By default the broker takes QoS 0 and
+ *  nothing else: a QoS 1 or 2 publish is never acked, and
+ *  the broker drops the connection (+CMQTTCONNLOST). maxQos
+ *  1 makes it a broker that acks. failPub makes the modem
+ *  refuse the next publishes with ERROR; lostAfter lets that
+ *  many more publishes through, then drops the connection
+ *  under the next one before its PUBACK.
+ * ======================================================== */
+
+class CmqttBroker : public ScriptedPort {
+public:
+    struct Message {
+        std::string topic, payload;
+    };
+
+    std::vector<Message> got;               // what reached the broker
+    bool     session = false;
+    unsigned connects = 0;
+    unsigned failPub = 0;                   // publishes the modem refuses
+    int      maxQos = 0;
+    int      lostAfter = -1;                // publishes acked before the link drops
+
+    void lose() {                           // network drops the session
+        session = false;
+        say("\r\n+CMQTTCONNLOST: 0,3\r\n");
+    }
+
+protected:
+    void onLine(const std::string& l) override {
+        if (l == "AT+CMQTTSTART") {
+            say(started ? "+CMQTTSTART: 23\r\n\r\nERROR\r\n" : "OK\r\n\r\n+CMQTTSTART: 0\r\n");
+            started = true;
+        } else if (!l.compare(0, 12, "AT+CMQTTACCQ")) {
+            say(acquired ? "ERROR\r\n" : "OK\r\n");
+            acquired = true;
+        } else if (!l.compare(0, 16, "AT+CMQTTCONNECT=")) {
+            session = true;
+            connects++;
+            say("OK\r\n\r\n+CMQTTCONNECT: 0,0\r\n");
+        } else if (l == "AT+CMQTTCONNECT?") {
+            say(session ? "+CMQTTCONNECT: 0,\"tcp://mqtt3.thingspeak.com:1883\",300,0\r\n\r\nOK\r\n"
+                        : "+CMQTTCONNECT: 0\r\n\r\nOK\r\n");
+        } else if (!l.compare(0, 16, "AT+CMQTTTOPIC=0,")) {
+            into = &topic;
+            expectBlock(std::stoul(l.substr(16)));
+            say(">");
+        } else if (!l.compare(0, 18, "AT+CMQTTPAYLOAD=0,")) {
+            into = &payload;
+            expectBlock(std::stoul(l.substr(18)));
+            say(">");
+        } else if (!l.compare(0, 14, "AT+CMQTTPUB=0,")) {
+            int qos = l[14] - '0';
+            if (failPub) { failPub--; say("ERROR\r\n"); return; }
+            if (!session) { say("+CMQTTPUB: 0,11\r\n\r\nERROR\r\n"); return; }
+            say("OK\r\n");
+            if (qos > maxQos || lostAfter == 0) {   // not for this broker, or link gone
+                lose();
+                return;
+            }
+            if (lostAfter > 0) lostAfter--;
+            got.push_back(Message{topic, payload});
+            say("\r\n+CMQTTPUB: 0,0\r\n");
+        } else if (!l.compare(0, 13, "AT+CMQTTDISC=")) {
+            session = false;
+            say("OK\r\n\r\n+CMQTTDISC: 0,0\r\n");
+        } else if (l == "AT+CMQTTREL=0") {
+            acquired = false;
+            say("OK\r\n");
+        } else if (l == "AT+CMQTTSTOP") {
+            started = false;
+            say("OK\r\n\r\n+CMQTTSTOP: 0\r\n");
+        } else {
+            say("ERROR\r\n");
+        }
+    }
+
+    void onBlock(const std::string& data) override {
+        *into = data;
+        say("\r\nOK\r\n");
+    }
+
+private:
+    bool         started = false, acquired = false;
+    std::string  topic, payload;
+    std::string* into = &payload;
+};
@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <string>
+#include "broker.h"
+#include "host.h"
+#include "mqttuplink.h"
+
+/* ========================================================
+ *  MqttUplink against the CMQTT stand-in: at QoS 0 with a
+ *  broker that, like ThingSpeak's, takes nothing higher, and
+ *  at QoS 1 with one that acks.
+ * ======================================================== */
+
+static const char TOPIC[] = "channels/42/publish";
+
+static bool payload(const char* row, TextBuf& out) {
+    out.add("field1=").add(row);
+    return true;
+}
+
+static CmqttBroker* modem;
+static MqttUplink*  up;
+static char         wire[MQTT_WINDOW][64];
+
+static bool post(uint8_t i, const char* row) {
+    size_t n = up->encode(row, wire[i], sizeof(wire[i]));
+    TEST_ASSERT_TRUE(n > 0);
+    return up->post(wire[i], n);
+}
+
+static void makeUplink(uint8_t qos) {
+    delete up;
+    up = new MqttUplink(*modem, "tcp://mqtt3.thingspeak.com:1883", "id", "user", "pass",
+                        TOPIC, payload, qos);
+}
+
+void setUp() {
+    hostClockSet(0);
+    modem = new CmqttBroker;
+    up = nullptr;
+    makeUplink(0);
+}
+
+void tearDown() {
+    delete up;
+    delete modem;
+}
+
+void test_window_published_at_qos0() {
+    TEST_ASSERT_TRUE(up->begin());
+    const char* rows[] = {"1.00", "2.00", "3.00", "4.00"};
+    for (uint8_t i = 0; i < MQTT_WINDOW; ++i) TEST_ASSERT_TRUE(post(i, rows[i]));
+
+    uint32_t t0 = hostClockNow();
+    UploadResult res[MQTT_WINDOW];
+    TEST_ASSERT_EQUAL_UINT8(MQTT_WINDOW, up->collect(res, MQTT_WINDOW));
+    TEST_ASSERT_LESS_THAN(1000, hostClockNow() - t0);       // nothing to wait for
+    for (UploadResult r : res) TEST_ASSERT_EQUAL(UP_OK, r);
+
+    TEST_ASSERT_EQUAL_size_t(MQTT_WINDOW, modem->got.size());
+    for (uint8_t i = 0; i < MQTT_WINDOW; ++i) {
+        TEST_ASSERT_EQUAL_STRING(TOPIC, modem->got[i].topic.c_str());
+        std::string want = std::string("field1=") + rows[i];
+        TEST_ASSERT_EQUAL_STRING(want.c_str(), modem->got[i].payload.c_str());
+    }
+    TEST_ASSERT_TRUE(modem->sent.find("AT+CMQTTPUB=0,0,") != std::string::npos);
+    TEST_ASSERT_EQUAL_UINT(1, modem->connects);
+    TEST_ASSERT_TRUE(up->isConnected());
+    up->end();
+    TEST_ASSERT_FALSE(modem->session);
+}
+
+/* A publish the modem refuses: that row fails, the ones before it
+ * keep their result, and the next post starts a new session */
+void test_refused_publish_reconnects() {
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "A"));
+    modem->failPub = 1;
+    TEST_ASSERT_FALSE(post(1, "B"));
+    TEST_ASSERT_FALSE(up->isConnected());
+
+    UploadResult res[2] = {UP_FAILED, UP_FAILED};
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 2));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+
+    TEST_ASSERT_TRUE(post(0, "B"));
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    TEST_ASSERT_EQUAL_UINT(2, modem->connects);
+    TEST_ASSERT_EQUAL_size_t(2, modem->got.size());
+    TEST_ASSERT_EQUAL_STRING("field1=B", modem->got[1].payload.c_str());
+    up->end();
+}
+
+/* Held session lost while idle: the next drain connects again */
+void test_held_session_lost() {
+    up->keepOpen(true);
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "A"));
+    UploadResult r;
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(&r, 1));
+    up->end();
+    TEST_ASSERT_TRUE(modem->session);
+
+    TEST_ASSERT_TRUE(up->begin());                  // still up: reused
+    TEST_ASSERT_EQUAL_UINT(1, modem->connects);
+    up->end();
+
+    modem->lose();
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_EQUAL_UINT(2, modem->connects);
+    TEST_ASSERT_TRUE(post(0, "B"));
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(&r, 1));
+    TEST_ASSERT_EQUAL(UP_OK, r);
+    up->keepOpen(false);
+    up->end();
+}
+
+/* QoS 1: each row is counted on its PUBACK */
+void test_window_acked_at_qos1() {
+    modem->maxQos = 1;
+    makeUplink(1);
+    TEST_ASSERT_TRUE(up->begin());
+    for (uint8_t i = 0; i < MQTT_WINDOW; ++i) TEST_ASSERT_TRUE(post(i, "1.00"));
+
+    UploadResult res[MQTT_WINDOW];
+    TEST_ASSERT_EQUAL_UINT8(MQTT_WINDOW, up->collect(res, MQTT_WINDOW));
+    for (UploadResult r : res) TEST_ASSERT_EQUAL(UP_OK, r);
+    TEST_ASSERT_TRUE(modem->sent.find("AT+CMQTTPUB=0,1,") != std::string::npos);
+    TEST_ASSERT_EQUAL_size_t(MQTT_WINDOW, modem->got.size());
+    up->end();
+}
+
+/* QoS 1, connection lost under B before its PUBACK: only A counts,
+ * C is not sent on a new session while B is owed, and B goes again */
+void test_qos1_lost_ack_keeps_row() {
+    modem->maxQos = 1;
+    modem->lostAfter = 1;
+    makeUplink(1);
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "A"));
+    TEST_ASSERT_TRUE(post(1, "B"));                 // modem took it; the ack never comes
+    TEST_ASSERT_FALSE(post(2, "C"));
+    TEST_ASSERT_EQUAL_UINT(1, modem->connects);
+
+    UploadResult res[3];
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 3));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+
+    modem->lostAfter = -1;
+    TEST_ASSERT_TRUE(post(0, "B"));
+    TEST_ASSERT_TRUE(post(1, "C"));
+    TEST_ASSERT_EQUAL_UINT8(2, up->collect(res, 2));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    TEST_ASSERT_EQUAL(UP_OK, res[1]);
+    TEST_ASSERT_EQUAL_UINT(2, modem->connects);
+    TEST_ASSERT_EQUAL_STRING("field1=B", modem->got[1].payload.c_str());
+    TEST_ASSERT_EQUAL_STRING("field1=C", modem->got[2].payload.c_str());
+    up->end();
+}
+
+/* QoS 0 gives no such guarantee: rows the modem accepted count as
+ * sent even though the connection went down under them */
+void test_qos0_is_at_most_once() {
+    modem->lostAfter = 1;
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "A"));
+    TEST_ASSERT_TRUE(post(1, "B"));
+    UploadResult res[2];
+    TEST_ASSERT_EQUAL_UINT8(2, up->collect(res, 2));
+    TEST_ASSERT_EQUAL(UP_OK, res[1]);
+    TEST_ASSERT_EQUAL_size_t(1, modem->got.size());
+    up->end();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_window_published_at_qos0);
+    RUN_TEST(test_refused_publish_reconnects);
+    RUN_TEST(test_held_session_lost);
+    RUN_TEST(test_window_acked_at_qos1);
+    RUN_TEST(test_qos1_lost_ack_keeps_row);
+    RUN_TEST(test_qos0_is_at_most_once);
+    return UNITY_END();
+}
@@ -0,0 +1,157 @@
+#include <unity.h>
+#include <string>
+#include "host.h"
+#include "nvstore.h"
+
+/* ========================================================
+ *  NVM state store on its host file: load and commit, the
+ *  log wrapping round the area, and recovery from pages a
+ *  reset left torn or half-written.
+ * ======================================================== */
+
+static const uint16_t PAGES = NVSTORE_ROWS * (NVSTORE_ROW / NVSTORE_PAGE);
+
+struct State {
+    uint32_t n;
+    uint8_t  pad[20];
+};
+
+static std::string flash;           // path of the file standing in for it
+
+static State make(uint32_t n) {
+    State s;
+    memset(&s, 0, sizeof(s));
+    s.n = n;
+    memset(s.pad, (int)(n & 0xFF), sizeof(s.pad));
+    return s;
+}
+
+static void reboot() {
+    nvstoreFile(flash.c_str());
+}
+
+static std::string image() {
+    std::string b;
+    FILE* f = fopen(flash.c_str(), "rb");
+    if (!f) return b;
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) b.append(buf, n);
+    fclose(f);
+    return b;
+}
+
+/* AND a pattern into one page, as a write cut short would leave it */
+static void damage(uint16_t page, uint8_t at, uint8_t mask) {
+    FILE* f = fopen(flash.c_str(), "r+b");
+    TEST_ASSERT_NOT_NULL(f);
+    fseek(f, (long)page * NVSTORE_PAGE + at, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, (long)page * NVSTORE_PAGE + at, SEEK_SET);
+    fputc(c & mask, f);
+    fclose(f);
+}
+
+static uint32_t loaded() {
+    State s;
+    TEST_ASSERT_TRUE(nvstoreLoad(&s, sizeof(s)));
+    State want = make(s.n);
+    TEST_ASSERT_EQUAL_MEMORY(&want, &s, sizeof(s));
+    return s.n;
+}
+
+void setUp() {
+    const char* dir = hostCardReset();
+    TEST_ASSERT_NOT_NULL(dir);
+    flash = std::string(dir) + "/NVSTATE.BIN";
+    reboot();
+}
+
+void tearDown() {}
+
+void test_empty_then_commit() {
+    State s;
+    TEST_ASSERT_FALSE(nvstoreLoad(&s, sizeof(s)));
+    s = make(7);
+    TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    TEST_ASSERT_EQUAL_UINT32(7, loaded());
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(7, loaded());
+    TEST_ASSERT_EQUAL_size_t((size_t)NVSTORE_ROWS * NVSTORE_ROW, image().size());
+}
+
+void test_unchanged_commit_writes_nothing() {
+    State s = make(1);
+    TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    std::string before = image();
+    TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    TEST_ASSERT_TRUE(before == image());
+}
+
+void test_oversize_and_layout_change() {
+    uint8_t big[NVSTORE_DATA_MAX + 1] = {0};
+    TEST_ASSERT_FALSE(nvstoreCommit(big, sizeof(big)));
+    State s = make(3);
+    TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    uint8_t other[sizeof(State) + 4];
+    TEST_ASSERT_FALSE(nvstoreLoad(other, sizeof(other)));    // layout changed: start afresh
+}
+
+/* Several laps round the area, with a power-up now and then */
+void test_log_wraps() {
+    for (uint32_t n = 1; n <= 3u * PAGES + 5; ++n) {
+        State s = make(n);
+        TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+        if (n % 37 == 0) reboot();
+        TEST_ASSERT_EQUAL_UINT32(n, loaded());
+    }
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(3u * PAGES + 5, loaded());
+    TEST_ASSERT_EQUAL_size_t((size_t)NVSTORE_ROWS * NVSTORE_ROW, image().size());
+}
+
+/* Reset during the newest write: its CRC fails, the state before it
+ * is still whole */
+void test_torn_newest_page_falls_back() {
+    for (uint32_t n = 1; n <= 6; ++n) {
+        State s = make(n);
+        TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    }
+    damage(5, 12, 0xF0);                                    // page of commit 6, in its data
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(5, loaded());
+
+    State s = make(7);                                      // and the log carries on
+    TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(7, loaded());
+}
+
+/* A page left half-written and never erased is passed over; the page
+ * holding the current state is never the one written */
+void test_dirty_page_passed_over() {
+    for (uint32_t n = 1; n <= 2; ++n) {
+        State s = make(n);
+        TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    }
+    damage(2, 0, 0x00);                                     // next page, mid-row
+    std::string before = image();
+
+    State s = make(3);
+    TEST_ASSERT_TRUE(nvstoreCommit(&s, sizeof(s)));
+    std::string after = image();
+    TEST_ASSERT_TRUE(before.compare(0, 2 * NVSTORE_PAGE, after, 0, 2 * NVSTORE_PAGE) == 0);
+    reboot();
+    TEST_ASSERT_EQUAL_UINT32(3, loaded());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_then_commit);
+    RUN_TEST(test_unchanged_commit_writes_nothing);
+    RUN_TEST(test_oversize_and_layout_change);
+    RUN_TEST(test_log_wraps);
+    RUN_TEST(test_torn_newest_page_falls_back);
+    RUN_TEST(test_dirty_page_passed_over);
+    return UNITY_END();
+}
@@ -0,0 +1,222 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "lora.h"
+#include "rcvparser.h"
+
+/* ========================================================
+ *  RcvParser under hostile input: random bytes, valid
+ *  frames cut up, bit-flipped and glued to garbage. It must
+ *  never hand out a frame it wasn't sent intact, never read
+ *  or write outside its buffer (run with -fsanitize=address
+ *  to check), and pick up clean frames again once the junk
+ *  is behind it. Ends with the per-byte cost against what
+ *  the RYLR993 UART can deliver.
+ * ======================================================== */
+
+static uint32_t rng;
+static uint32_t rnd(uint32_t n) {               // xorshift32: same run every time
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng % n;
+}
+
+struct Seen {
+    uint16_t             from;
+    int16_t              rssi, snr;
+    std::vector<uint8_t> data;
+};
+
+static std::vector<Seen> seen;
+
+static void onFrame(const RcvFrame& f, void*) {
+    TEST_ASSERT_LESS_OR_EQUAL(RCV_PAYLOAD_MAX, f.len);
+    seen.push_back(Seen{f.from, f.rssi, f.snr, std::vector<uint8_t>(f.data, f.data + f.len)});
+}
+
+static std::string frameText(const Seen& f) {
+    char head[32], tail[24];
+    snprintf(head, sizeof(head), "+RCV=%u,%u,", f.from, (unsigned)f.data.size());
+    snprintf(tail, sizeof(tail), ",%d,%d\r\n", f.rssi, f.snr);
+    return head + std::string(f.data.begin(), f.data.end()) + tail;
+}
+
+/* Payloads are binary: any byte, including , \r \n and '+' */
+static Seen randomFrame() {
+    Seen f{(uint16_t)rnd(65536), (int16_t)(-(int)rnd(130)), (int16_t)((int)rnd(41) - 20), {}};
+    size_t n = 1 + rnd(64);
+    if (!rnd(8)) n = RCV_PAYLOAD_MAX;
+    for (size_t i = 0; i < n; ++i) f.data.push_back((uint8_t)rnd(256));
+    return f;
+}
+
+static bool same(const Seen& a, const Seen& b) {
+    return a.from == b.from && a.rssi == b.rssi && a.snr == b.snr && a.data == b.data;
+}
+
+static void feed(RcvParser& p, const std::string& s) {
+    p.feed((const uint8_t*)s.data(), s.size());
+}
+
+void setUp() {
+    rng = 0xC0FFEE;
+    seen.clear();
+}
+
+void tearDown() {}
+
+void test_random_bytes_never_crash() {
+    RcvParser p(onFrame);
+    for (uint32_t i = 0; i < 2000000; ++i) p.feed((uint8_t)rnd(256));
+    TEST_ASSERT_EQUAL_UINT32(seen.size(), p.frames());
+}
+
+/* Prefixes followed by the characters a +RCV line is made of, so
+ * the parser gets deep into every state before failing */
+void test_random_grammar_never_crash() {
+    static const char alphabet[] = "0123456789,-\r\n";
+    RcvParser p(onFrame);
+    for (uint32_t i = 0; i < 2000000; ++i) {
+        if (!rnd(16)) p.feed((const uint8_t*)"+RCV=", 5);
+        p.feed((uint8_t)alphabet[rnd(sizeof(alphabet) - 1)]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(seen.size(), p.frames());
+    TEST_ASSERT_GREATER_THAN(0, p.errors());
+}
+
+void test_clean_stream_exact() {
+    RcvParser p(onFrame);
+    std::vector<Seen> sent;
+    std::string stream;
+    for (int i = 0; i < 2000; ++i) {
+        sent.push_back(randomFrame());
+        stream += frameText(sent.back());
+    }
+    /* delivered in UART-sized pieces of any length */
+    for (size_t at = 0; at < stream.size(); ) {
+        size_t n = 1 + rnd(97);
+        if (n > stream.size() - at) n = stream.size() - at;
+        p.feed((const uint8_t*)stream.data() + at, n);
+        at += n;
+    }
+    TEST_ASSERT_EQUAL_size_t(sent.size(), seen.size());
+    for (size_t i = 0; i < sent.size(); ++i) TEST_ASSERT_TRUE(same(sent[i], seen[i]));
+    TEST_ASSERT_EQUAL_UINT32(0, p.errors());
+}
+
+/* Clean frames with mutated ones and junk between them. A mutation
+ * may still parse (a flipped payload bit), so only the clean frames
+ * are checked: every one must come out unless it started within a
+ * maximum-length payload of the junk (a corrupted <len> can swallow
+ * that much before the parser notices). */
+void test_mutated_stream_resyncs() {
+    RcvParser p(onFrame);
+    std::vector<Seen> clean;
+    std::vector<bool> mustSee;
+    size_t junkEnd = 0;
+    std::string stream;
+
+    for (int i = 0; i < 5000; ++i) {
+        Seen f = randomFrame();
+        std::string t = frameText(f);
+        switch (rnd(6)) {
+        case 0:                                     // truncated
+            stream += t.substr(0, rnd(t.size()));
+            junkEnd = stream.size();
+            continue;
+        case 1:                                     // bit flip
+            t[rnd(t.size())] ^= (char)(1 << rnd(8));
+            stream += t;
+            junkEnd = stream.size();
+            continue;
+        case 2:                                     // noise
+            for (uint32_t k = rnd(40); k--; ) stream += (char)rnd(256);
+            junkEnd = stream.size();
+            continue;
+        default:
+            break;
+        }
+        mustSee.push_back(stream.size() >= junkEnd + RCV_PAYLOAD_MAX + 32);
+        clean.push_back(f);
+        stream += t;
+    }
+    feed(p, stream);
+
+    size_t j = 0, found = 0;
+    for (size_t i = 0; i < clean.size(); ++i) {
+        size_t k = j;
+        while (k < seen.size() && !same(seen[k], clean[i])) ++k;
+        if (k < seen.size()) {
+            j = k + 1;
+            found++;
+        } else if (mustSee[i]) {
+            TEST_FAIL_MESSAGE("clean frame lost after resync");
+        }
+    }
+    printf("  %u clean frames, %u found, %lu errors\n",
+           (unsigned)clean.size(), (unsigned)found, (unsigned long)p.errors());
+    TEST_ASSERT_GREATER_THAN(clean.size() * 3 / 4, found);
+    TEST_ASSERT_GREATER_THAN(0, p.errors());
+}
+
+/* A header that overflows its limits is dropped without reading on */
+void test_limits() {
+    RcvParser p(onFrame);
+    feed(p, "+RCV=65536,1,x,-1,1\r\n");                 // address out of range
+    feed(p, "+RCV=1,241,");                             // longer than the module allows
+    feed(p, "+RCV=1234567,1,x,-1,1\r\n");               // too many digits
+    feed(p, "+RCV=1,1,x,--1,1\r\n");
+    feed(p, "+RCV=,1,x,-1,1\r\n");
+    TEST_ASSERT_EQUAL_size_t(0, seen.size());
+    TEST_ASSERT_EQUAL_UINT32(5, p.errors());
+
+    feed(p, "+RCV=7,1,x,-1,1\r\n");
+    TEST_ASSERT_EQUAL_size_t(1, seen.size());
+    TEST_ASSERT_EQUAL_UINT16(7, seen[0].from);
+}
+
+/* Worst case for the parser: maximum payloads back to back. The
+ * module's UART delivers LORA_BAUD / 10 bytes a second. */
+static std::string maxFrames;
+static uint32_t    benchFrames;
+static void countFrame(const RcvFrame&, void*) { benchFrames++; }
+
+void test_throughput() {
+    for (int i = 0; i < 16; ++i) {
+        Seen f{65535, -120, -20, {}};
+        for (int k = 0; k < RCV_PAYLOAD_MAX; ++k) f.data.push_back((uint8_t)rnd(256));
+        maxFrames += frameText(f);
+    }
+    RcvParser p(countFrame);
+    ByteRing<256> ring;
+    BenchResult r = bench("rcv parse, 16 max frames", 2000, [&] {
+        for (size_t at = 0; at < maxFrames.size(); ) {
+            while (at < maxFrames.size() && ring.push((uint8_t)maxFrames[at])) ++at;
+            p.drain(ring);
+        }
+    });
+    double nsPerByte = r.nsPerOp / maxFrames.size();
+    double uartNsPerByte = 1e9 / (LORA_BAUD / 10);
+    printf("  %.2f ns/byte, %.0f frames/s; UART max %d B/s, %.0fx headroom\n",
+           nsPerByte, 1e9 / (r.nsPerOp / 16), LORA_BAUD / 10, uartNsPerByte / nsPerByte);
+
+    TEST_ASSERT_EQUAL_UINT32(0, p.errors());
+    TEST_ASSERT_EQUAL_UINT32(benchFrames, p.frames());
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)(r.allocsPerOp * 1000));
+    /* the M0+ is a few hundred times slower than the host; keep
+     * parsing far under the time the bytes take to arrive */
+    TEST_ASSERT_TRUE(nsPerByte * 1000 < uartNsPerByte);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_random_bytes_never_crash);
+    RUN_TEST(test_random_grammar_never_crash);
+    RUN_TEST(test_clean_stream_exact);
+    RUN_TEST(test_mutated_stream_resyncs);
+    RUN_TEST(test_limits);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
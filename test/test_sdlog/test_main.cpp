@@ -0,0 +1,187 @@
+#include <unity.h>
+#include <string>
+#include "host.h"
+#include "sdlog.h"
+#include "storage.h"
+
+/* ========================================================
+ *  Buffered SD append path on a host directory: write-out
+ *  points, the WAL marker, the preallocated tail (the host
+ *  backend fills it with stale rows, as a card would hand
+ *  back old clusters) and recovery after a brownout.
+ * ======================================================== */
+
+static const char DAY[] = "D250801.CSV";
+
+/* sdlog.cpp's marker, as it sits in WAL.DAT */
+struct WalMarker {
+    uint32_t magic;
+    char     name[13];
+    uint8_t  committed;
+    uint32_t before;
+    uint32_t len;
+};
+
+static WalMarker readMarker() {
+    WalMarker m;
+    memset(&m, 0, sizeof(m));
+    std::string w = hostCardRead("WAL.DAT");
+    if (w.size() >= sizeof(m)) memcpy(&m, w.data(), sizeof(m));
+    return m;
+}
+
+/* The day file as far as the rows go while it is open: the marker
+ * holds the end, the rest is preallocated */
+static std::string rows() {
+    WalMarker m = readMarker();
+    std::string day = hostCardRead(DAY);
+    if (m.committed && m.before + m.len < day.size()) day.resize(m.before + m.len);
+    return day;
+}
+
+void setUp() {
+    sdlogClose();
+    TEST_ASSERT_NOT_NULL(hostCardReset());
+    hostClockSet(0);
+}
+
+void tearDown() {
+    sdlogClose();
+}
+
+void test_rows_wait_for_a_flush() {
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "a\t1"));
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "b\t2"));
+    TEST_ASSERT_EQUAL_size_t(0, rows().size());
+    sdlogFlush();
+    std::string day = rows();
+    TEST_ASSERT_EQUAL_STRING("a\t1\r\nb\t2\r\n", day.c_str());
+}
+
+void test_flush_by_age() {
+    sdlogMaxAgeMs = 1000;
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "a\t1"));
+    sdlogService();
+    TEST_ASSERT_EQUAL_size_t(0, rows().size());
+    hostClockAdvance(1500);
+    sdlogService();
+    TEST_ASSERT_EQUAL_size_t(5, rows().size());
+    sdlogMaxAgeMs = 60000;
+}
+
+void test_full_sector_writes_out() {
+    std::string row(100, 'x');
+    for (int i = 0; i < 5; ++i) TEST_ASSERT_TRUE(sdlogAppend(DAY, row.c_str()));
+    TEST_ASSERT_EQUAL_size_t(0, rows().size());
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, row.c_str()));        // 6 x 102 > 512
+    TEST_ASSERT_EQUAL_size_t(5 * 102, rows().size());
+}
+
+/* One fixed-size marker, rewritten in place on every write-out */
+void test_marker_overwritten_in_place() {
+    for (int i = 0; i < 8; ++i) {
+        TEST_ASSERT_TRUE(sdlogAppend(DAY, "row\t1"));
+        sdlogFlush();
+        TEST_ASSERT_EQUAL_size_t(sizeof(WalMarker), hostCardRead("WAL.DAT").size());
+    }
+    WalMarker m = readMarker();
+    TEST_ASSERT_EQUAL_STRING(DAY, m.name);
+    TEST_ASSERT_EQUAL_UINT8(1, m.committed);
+    TEST_ASSERT_EQUAL_UINT32(7 * 7, m.before);
+    TEST_ASSERT_EQUAL_UINT32(7, m.len);
+}
+
+/* Power lost halfway through a write-out: the marker is still
+ * uncommitted and the file ends in part of a row */
+void test_torn_row_neutralised() {
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "good\t1"));
+    sdlogClose();
+    WalMarker m = readMarker();
+    m.committed = 0;
+    m.before = 8;
+    m.len = 16;
+    StoreFile w = storeOpen("WAL.DAT", ST_TRUNC);
+    w.write(&m, sizeof(m));
+    w.close();
+    StoreFile f = storeOpen(DAY, ST_APPEND);
+    f.write("more\t2\r\nhal", 11);
+    f.close();
+
+    sdlogRecover();
+    std::string day = hostCardRead(DAY);
+    TEST_ASSERT_EQUAL_STRING("good\t1\r\nmore\t2\r\n##\n", day.c_str());
+    TEST_ASSERT_EQUAL_UINT8(1, readMarker().committed);
+}
+
+/* Rows start at offset 0 of the preallocated run; closing cuts the rest */
+void test_preallocated_tail_cut_on_close() {
+    std::string day;
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "a\t1"));
+    sdlogFlush();
+    TEST_ASSERT_EQUAL_size_t(SDLOG_PREALLOC, hostCardRead(DAY).size());
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "b\t2"));
+    sdlogClose();
+    day = hostCardRead(DAY);
+    TEST_ASSERT_EQUAL_STRING("a\t1\r\nb\t2\r\n", day.c_str());
+
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "c\t3"));            // reopened: appends after b
+    sdlogClose();
+    day = hostCardRead(DAY);
+    TEST_ASSERT_EQUAL_STRING("a\t1\r\nb\t2\r\nc\t3\r\n", day.c_str());
+}
+
+/* Power lost with the day file open: the card holds the preallocated
+ * run, the committed marker says where the rows end */
+void test_brownout_cuts_preallocated_tail() {
+    std::string day;
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "a\t1"));
+    sdlogFlush();
+    sdlogRecover();
+    day = hostCardRead(DAY);
+    TEST_ASSERT_EQUAL_STRING("a\t1\r\n", day.c_str());
+}
+
+/* ... and opened but never written: nothing survives */
+void test_brownout_before_first_write() {
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "a\t1"));
+    sdlogRecover();
+    TEST_ASSERT_EQUAL_size_t(0, hostCardRead(DAY).size());
+}
+
+/* ... and mid-write: the sector may hold new bytes or stale ones, so
+ * the write is dropped and the rows before it kept */
+void test_brownout_mid_write_into_preallocated_tail() {
+    std::string day;
+    TEST_ASSERT_TRUE(sdlogAppend(DAY, "a\t1"));
+    sdlogFlush();
+    WalMarker m = readMarker();
+    m.committed = 0;
+    m.before = 5;
+    m.len = 5;
+    StoreFile w = storeOpen("WAL.DAT", ST_RW);
+    w.write(&m, sizeof(m));
+    w.close();
+    StoreFile f = storeOpen(DAY, ST_RW);
+    f.seek(5);
+    f.write("b\t", 2);
+    f.close();
+
+    sdlogRecover();
+    day = hostCardRead(DAY);
+    TEST_ASSERT_EQUAL_STRING("a\t1\r\n", day.c_str());
+    TEST_ASSERT_EQUAL_UINT8(1, readMarker().committed);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_rows_wait_for_a_flush);
+    RUN_TEST(test_flush_by_age);
+    RUN_TEST(test_full_sector_writes_out);
+    RUN_TEST(test_marker_overwritten_in_place);
+    RUN_TEST(test_torn_row_neutralised);
+    RUN_TEST(test_preallocated_tail_cut_on_close);
+    RUN_TEST(test_brownout_cuts_preallocated_tail);
+    RUN_TEST(test_brownout_before_first_write);
+    RUN_TEST(test_brownout_mid_write_into_preallocated_tail);
+    return UNITY_END();
+}
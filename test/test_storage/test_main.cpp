@@ -0,0 +1,81 @@
+#include <unity.h>
+#include <string>
+#include "host.h"
+#include "storage.h"
+
+/* ========================================================
+ *  Host storage backend: open modes, and names that do not
+ *  fit a path.
+ * ======================================================== */
+
+void setUp() {
+    TEST_ASSERT_NOT_NULL(hostCardReset());
+}
+
+void tearDown() {}
+
+void test_open_modes() {
+    StoreFile f = storeOpen("A.TXT", ST_TRUNC);
+    TEST_ASSERT_TRUE((bool)f);
+    f.println("one");
+    f.close();
+
+    f = storeOpen("A.TXT", ST_APPEND);
+    f.println("two");
+    f.close();
+    TEST_ASSERT_EQUAL_STRING("one\r\ntwo\r\n", hostCardRead("A.TXT").c_str());
+
+    f = storeOpen("A.TXT", ST_RW);                      // from offset 0, nothing cut
+    f.write("ONE", 3);
+    f.close();
+    TEST_ASSERT_EQUAL_STRING("ONE\r\ntwo\r\n", hostCardRead("A.TXT").c_str());
+
+    TEST_ASSERT_FALSE((bool)storeOpen("NONE.TXT", ST_READ));
+    TEST_ASSERT_TRUE(storeRemove("A.TXT"));
+    TEST_ASSERT_FALSE(storeExists("A.TXT"));
+}
+
+/* "<root>/././…//A.TXT" filling storage.cpp's 320-byte path buffer
+ * exactly, then more: cut to fit, it would name A.TXT */
+void test_overlong_name_fails() {
+    const char* root = hostCardReset();
+    storeOpen("A.TXT", ST_TRUNC).close();
+
+    std::string name;
+    while (strlen(root) + 1 + name.size() + 2 + 5 <= 319) name += "./";
+    name += std::string(319 - strlen(root) - 1 - name.size() - 5, '/');
+    name += "A.TXT.part";
+
+    TEST_ASSERT_FALSE(storeExists(name.c_str()));
+    TEST_ASSERT_FALSE((bool)storeOpen(name.c_str(), ST_READ));
+    TEST_ASSERT_FALSE(storeRemove(name.c_str()));
+    TEST_ASSERT_TRUE(storeExists("A.TXT"));
+}
+
+void test_dir_lists_files() {
+    storeOpen("B.CSV", ST_TRUNC).close();
+    StoreFile f = storeOpen("C.CSV", ST_TRUNC);
+    f.write("12345", 5);
+    f.close();
+
+    StoreDir d;
+    TEST_ASSERT_TRUE(d.open());
+    char name[16];
+    uint32_t size, total = 0;
+    int n = 0;
+    while (d.next(name, sizeof(name), &size)) {
+        n++;
+        total += size;
+    }
+    d.close();
+    TEST_ASSERT_EQUAL_INT(2, n);
+    TEST_ASSERT_EQUAL_UINT32(5, total);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_open_modes);
+    RUN_TEST(test_overlong_name_fails);
+    RUN_TEST(test_dir_lists_files);
+    return UNITY_END();
+}
@@ -0,0 +1,167 @@
+#include <unity.h>
+#include <deque>
+#include <string>
+#include "config.h"
+#include "host.h"
+#include "storage.h"
+#include "talkback.h"
+
+/* ========================================================
+ *  Remote config against a stand-in TalkBack server behind
+ *  the SIM7600 HTTP service: fetch, validate, persist, and
+ *  the config the next boot loads.
+ * ======================================================== */
+
+static const char URL[] = "http://tb.local/talkbacks/7/commands/execute?api_key=KEY";
+
+/* The modem's HTTP service and the TalkBack queue behind it */
+class TalkBackModem : public ScriptedPort {
+public:
+    std::deque<std::string> queue;      // commands waiting; execute pops one
+    unsigned status = 200;
+    bool     session = false;
+    unsigned executes = 0;
+    std::string url, body;
+
+protected:
+    void onLine(const std::string& l) override {
+        if (l == "AT+HTTPTERM") {
+            say(session ? "OK\r\n" : "ERROR\r\n");
+            session = false;
+        } else if (l == "AT+HTTPINIT") {
+            say(session ? "ERROR\r\n" : "OK\r\n");
+            session = true;
+        } else if (!l.compare(0, 19, "AT+HTTPPARA=\"URL\",\"")) {
+            url = l.substr(19, l.size() - 20);
+            say("OK\r\n");
+        } else if (!l.compare(0, 11, "AT+HTTPPARA")) {
+            say("OK\r\n");
+        } else if (l == "AT+HTTPACTION=0") {
+            body.clear();
+            unsigned st = status;
+            if (url.find("api_key=KEY") == std::string::npos) st = 401;
+            else if (url.find("/commands/execute") != std::string::npos) {
+                executes++;
+                if (!queue.empty()) {
+                    body = queue.front();
+                    queue.pop_front();
+                }
+            }
+            char r[64];
+            snprintf(r, sizeof(r), "OK\r\n\r\n+HTTPACTION: 0,%u,%u\r\n", st, (unsigned)body.size());
+            say(r);
+        } else if (!l.compare(0, 14, "AT+HTTPREAD=0,")) {
+            size_t n = std::stoul(l.substr(14));
+            std::string part = body.substr(0, n);
+            char r[48];
+            snprintf(r, sizeof(r), "OK\r\n\r\n+HTTPREAD: %u\r\n", (unsigned)part.size());
+            say(r + part + "\r\n+HTTPREAD: 0\r\n");
+        } else {
+            say("ERROR\r\n");
+        }
+    }
+};
+
+static TalkBackModem* tb;
+
+void setUp() {
+    TEST_ASSERT_NOT_NULL(hostCardReset());
+    hostClockSet(0);
+    configDefaults(config);
+    tb = new TalkBackModem;
+}
+
+void tearDown() {
+    delete tb;
+}
+
+void test_blob_applied_and_persisted() {
+    tb->queue.push_back("v1;si=900;cy=4;bs=50;pp=1;apn=iot.example.net");
+    TEST_ASSERT_TRUE(talkbackFetchConfig(*tb, URL));
+    TEST_ASSERT_EQUAL_STRING(URL, tb->url.c_str());
+    TEST_ASSERT_FALSE(tb->session);                     // HTTPTERM after the read
+
+    TEST_ASSERT_EQUAL_UINT32(900, config.sampleIntervalS);
+    TEST_ASSERT_EQUAL_UINT8(4, config.cycleWaits);
+    TEST_ASSERT_EQUAL_UINT16(50, config.batchRows);
+    TEST_ASSERT_EQUAL_UINT8(PWR_MODEM_OFF, config.powerPolicy);
+    TEST_ASSERT_EQUAL_UINT16(120, config.uploadBudgetS);   // left out: kept
+    TEST_ASSERT_EQUAL_STRING("iot.example.net", config.apn);
+
+    /* next boot */
+    configDefaults(config);
+    TEST_ASSERT_TRUE(configLoad());
+    TEST_ASSERT_EQUAL_UINT32(900, config.sampleIntervalS);
+    TEST_ASSERT_EQUAL_STRING("iot.example.net", config.apn);
+}
+
+void test_invalid_blob_rejected() {
+    const char* bad[] = {
+        "v1;si=2",                      // below range
+        "v1;si=900;zz=1",               // unknown key
+        "v2;si=900",                    // unknown version
+        "v1;apn=bad apn",
+        "reboot",                       // some other TalkBack command
+    };
+    for (const char* b : bad) tb->queue.push_back(b);
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        TEST_ASSERT_FALSE(talkbackFetchConfig(*tb, URL));
+        TEST_ASSERT_EQUAL_UINT32(15, config.sampleIntervalS);
+    }
+    TEST_ASSERT_TRUE(tb->queue.empty());                // each one consumed
+    TEST_ASSERT_FALSE(storeExists("CONFIG.TXT"));
+}
+
+void test_empty_queue() {
+    TEST_ASSERT_FALSE(talkbackFetchConfig(*tb, URL));
+    TEST_ASSERT_EQUAL_UINT(1, tb->executes);
+    TEST_ASSERT_TRUE(tb->sent.find("AT+HTTPREAD") == std::string::npos);
+    TEST_ASSERT_FALSE(storeExists("CONFIG.TXT"));
+}
+
+void test_commands_in_order() {
+    tb->queue.push_back("v1;si=60");
+    tb->queue.push_back("v1;si=120;rl=1");
+    TEST_ASSERT_TRUE(talkbackFetchConfig(*tb, URL));
+    TEST_ASSERT_EQUAL_UINT32(60, config.sampleIntervalS);
+    TEST_ASSERT_TRUE(talkbackFetchConfig(*tb, URL));
+    TEST_ASSERT_EQUAL_UINT32(120, config.sampleIntervalS);
+    TEST_ASSERT_EQUAL_UINT16(1, config.ratePeriodS);
+}
+
+void test_oversized_body_not_read() {
+    tb->queue.push_back("v1;apn=" + std::string(CONFIG_BLOB_MAX, 'a'));
+    char out[CONFIG_BLOB_MAX];
+    TEST_ASSERT_EQUAL_INT32(CONFIG_BLOB_MAX + 7, talkbackExecute(*tb, URL, out, sizeof(out)));
+    TEST_ASSERT_TRUE(tb->sent.find("AT+HTTPREAD") == std::string::npos);
+    TEST_ASSERT_FALSE(tb->session);
+}
+
+void test_http_error() {
+    tb->queue.push_back("v1;si=60");
+    TEST_ASSERT_FALSE(talkbackFetchConfig(*tb, "http://tb.local/talkbacks/7/commands/execute?api_key=NOPE"));
+    tb->status = 500;
+    TEST_ASSERT_FALSE(talkbackFetchConfig(*tb, URL));
+    TEST_ASSERT_EQUAL_UINT32(15, config.sampleIntervalS);
+    TEST_ASSERT_FALSE(tb->session);
+}
+
+/* A body is taken by its length: CR/LF inside it are data */
+void test_body_read_by_length() {
+    tb->queue.push_back("v1;si=300\r\n;cy=2");
+    TEST_ASSERT_TRUE(talkbackFetchConfig(*tb, URL));
+    TEST_ASSERT_EQUAL_UINT32(300, config.sampleIntervalS);
+    TEST_ASSERT_EQUAL_UINT8(2, config.cycleWaits);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_blob_applied_and_persisted);
+    RUN_TEST(test_invalid_blob_rejected);
+    RUN_TEST(test_empty_queue);
+    RUN_TEST(test_commands_in_order);
+    RUN_TEST(test_oversized_body_not_read);
+    RUN_TEST(test_http_error);
+    RUN_TEST(test_body_read_by_length);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <vector>
+#include "host.h"
+
+/* ========================================================
+ *  SIM7600 SOCKET STAND-IN
+ *  AT+NETOPEN / CDNSGIP / CIPOPEN / CIPSEND / CIPCLOSE on
+ *  link 0, or the SSL set (CCHSTART / CSSLCFG / CCHOPEN /
+ *  CCHSEND / CCHCLOSE / CCHSTOP) on session 0, with an HTTP
+ *  server behind it. Each request gets the next scripted
+ *  reply (200 and a rising entry id once the script runs
+ *  out). Replies go out as +IPD or +CCHRECV chunks the next
+ *  time the firmware finds the UART empty, unless held.
+ *  A reply with close shuts the socket behind it; requests
+ *  after it on that connection are never answered.
+ * ======================================================== */
+
+class Sim7600Tcp : public ScriptedPort {
+public:
+    struct Reply {
+        unsigned    status;
+        std::string body;
+        bool        close;
+    };
+
+    std::deque<Reply>        script;
+    std::vector<std::string> requests;      // every request the server got
+    bool     hold = false;                  // keep replies back
+    bool     socket = false;
+    unsigned opens = 0;                     // connections, or TLS handshakes
+    std::vector<std::string> sslcfg;        // AT+CSSLCFG lines, in order
+
+protected:
+    void onLine(const std::string& l) override {
+        if (l == "AT+NETOPEN") {
+            say(net ? "+IP ERROR: Network is already opened\r\n\r\nERROR\r\n" : "OK\r\n\r\n+NETOPEN: 0\r\n");
+            net = true;
+        } else if (!l.compare(0, 10, "AT+CDNSGIP")) {
+            say("+CDNSGIP: 1,\"api.thingspeak.com\",\"3.224.58.169\"\r\n\r\nOK\r\n");
+        } else if (!l.compare(0, 12, "AT+CIPOPEN=0")) {
+            if (socket) { say("+CIPOPEN: 0,4\r\n\r\nERROR\r\n"); return; }
+            socket = true;
+            opens++;
+            owed.clear();
+            say("OK\r\n\r\n+CIPOPEN: 0,0\r\n");
+        } else if (!l.compare(0, 13, "AT+CIPSEND=0,")) {
+            if (!socket) { say("ERROR\r\n"); return; }
+            expectBlock(std::stoul(l.substr(13)));
+            say("\r\n>");
+        } else if (l == "AT+CIPCLOSE=0") {
+            say(socket ? "OK\r\n\r\n+CIPCLOSE: 0,0\r\n" : "+CIPCLOSE: 0,4\r\n\r\nERROR\r\n");
+            socket = false;
+            owed.clear();
+        } else if (l == "AT+CCHSET=0,0" || l == "AT+CCHSSLCFG=0,0") {
+            say("OK\r\n");
+        } else if (!l.compare(0, 10, "AT+CSSLCFG")) {
+            sslcfg.push_back(l);
+            say("OK\r\n");
+        } else if (l == "AT+CCHSTART") {
+            say(cch ? "ERROR\r\n" : "OK\r\n\r\n+CCHSTART: 0\r\n");
+            cch = true;
+        } else if (!l.compare(0, 12, "AT+CCHOPEN=0")) {
+            if (!cch || socket) { say("ERROR\r\n"); return; }
+            socket = ssl = true;
+            opens++;
+            owed.clear();
+            say("OK\r\n\r\n+CCHOPEN: 0,0\r\n");
+        } else if (!l.compare(0, 13, "AT+CCHSEND=0,")) {
+            if (!socket) { say("ERROR\r\n"); return; }
+            expectBlock(std::stoul(l.substr(13)));
+            say("\r\n>");
+        } else if (l == "AT+CCHCLOSE=0") {
+            say(socket ? "OK\r\n\r\n+CCHCLOSE: 0,0\r\n" : "ERROR\r\n");
+            socket = false;
+            owed.clear();
+        } else if (l == "AT+CCHSTOP") {
+            say(cch ? "OK\r\n\r\n+CCHSTOP: 0\r\n" : "ERROR\r\n");
+            cch = false;
+        } else {
+            say("ERROR\r\n");
+        }
+    }
+
+    void onBlock(const std::string& data) override {
+        if (ssl) say("OK\r\n");
+        else say("OK\r\n\r\n+CIPSEND: 0," + std::to_string(data.size()) + "," + std::to_string(data.size()) + "\r\n");
+        pending += data;
+        for (size_t end; (end = pending.find("\r\n\r\n")) != std::string::npos; ) {
+            size_t cl = pending.find("Content-Length: ");
+            size_t len = end + 4 + (cl < end ? std::stoul(pending.substr(cl + 16)) : 0);
+            if (pending.size() < len) break;    // body still to come
+            requests.push_back(pending.substr(0, len));
+            pending.erase(0, len);
+            Reply r{200, std::to_string(100 + requests.size()), false};
+            if (!script.empty()) {
+                r = script.front();
+                script.pop_front();
+            }
+            owed.push_back(r);
+        }
+    }
+
+    void onIdle() override {
+        while (!hold && socket && !owed.empty()) {
+            Reply r = owed.front();
+            owed.pop_front();
+            std::string http = "HTTP/1.1 " + std::to_string(r.status) + " OK\r\nContent-Length: " +
+                               std::to_string(r.body.size()) + "\r\nConnection: " +
+                               (r.close ? "close" : "keep-alive") + "\r\n\r\n" + r.body;
+            const char* pre = ssl ? "\r\n+CCHRECV: DATA,0," : "\r\n+IPD";
+            size_t half = http.size() / 2;              // arrives in two chunks
+            say(pre + std::to_string(half) + "\r\n" + http.substr(0, half));
+            say(pre + std::to_string(http.size() - half) + "\r\n" + http.substr(half));
+            if (r.close) {
+                say(ssl ? "\r\n+CCH_PEER_CLOSED: 0\r\n" : "\r\n+IPCLOSE: 0,1\r\n");
+                socket = false;
+                owed.clear();
+            }
+        }
+    }
+
+private:
+    bool                net = false;
+    bool                cch = false;        // SSL service started
+    bool                ssl = false;        // the socket is a CCH session
+    std::string         pending;            // request bytes not yet complete
+    std::deque<Reply>   owed;               // answers due on the open socket
+};
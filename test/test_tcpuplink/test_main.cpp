@@ -0,0 +1,259 @@
+#include <unity.h>
+#include <string>
+#include "host.h"
+#include "sim7600.h"
+#include "tcpuplink.h"
+#include "tlsuplink.h"
+
+/* ========================================================
+ *  TcpUplink and TlsUplink against the SIM7600 socket
+ *  stand-in: keep-alive pipelining, what happens to rows in
+ *  flight when the server closes the connection under them,
+ *  the TLS session held across drains, and how ThingSpeak's
+ *  answers, the pacer and bulk updates decide a row's fate.
+ * ======================================================== */
+
+static bool path(const char* row, TextBuf& out) {
+    out.add("/update?field1=").add(row);
+    return true;
+}
+
+static Sim7600Tcp* modem;
+static TcpUplink*  up;
+static char        wire[4][128];
+
+static bool post(uint8_t i, const char* row) {
+    size_t n = up->encode(row, wire[i], sizeof(wire[i]));
+    TEST_ASSERT_TRUE(n > 0);
+    return up->post(wire[i], n);
+}
+
+static bool bulkItem(const char* row, TextBuf& out) {
+    out.add("{\"field1\":").add(row).add("}");
+    return true;
+}
+
+static const BulkFormat BULK = {
+    "/channels/1/bulk_update.json", "{\"updates\":[", "]}", bulkItem,
+};
+
+static void useTls(const char* ca = nullptr) {
+    delete up;
+    up = new TlsUplink(*modem, "api.thingspeak.com", 443, path, ca);
+}
+
+void setUp() {
+    hostClockSet(0);
+    modem = new Sim7600Tcp;
+    up = new TcpUplink(*modem, "api.thingspeak.com", 80, path);
+}
+
+void tearDown() {
+    delete up;
+    delete modem;
+}
+
+void test_pipelined_window() {
+    TEST_ASSERT_TRUE(up->begin());
+    modem->hold = true;                         // all four out before any answer
+    for (uint8_t i = 0; i < TCP_PIPELINE; ++i) TEST_ASSERT_TRUE(post(i, std::to_string(i).c_str()));
+    modem->hold = false;
+
+    UploadResult res[TCP_PIPELINE];
+    TEST_ASSERT_EQUAL_UINT8(TCP_PIPELINE, up->collect(res, TCP_PIPELINE));
+    for (UploadResult r : res) TEST_ASSERT_EQUAL(UP_OK, r);
+    TEST_ASSERT_EQUAL_UINT(1, modem->opens);
+    TEST_ASSERT_EQUAL_size_t(TCP_PIPELINE, modem->requests.size());
+    up->end();
+}
+
+/* A and B go out pipelined; A's answer says Connection: close and the
+ * server drops B. C must not open a new connection while B is still
+ * owed an answer, or C's answer would be credited to B. */
+void test_no_reconnect_with_rows_in_flight() {
+    modem->script.push_back({200, "101", true});
+    modem->script.push_back({200, "102", false});   // B: never sent back
+
+    TEST_ASSERT_TRUE(up->begin());
+    modem->hold = true;
+    TEST_ASSERT_TRUE(post(0, "A"));
+    TEST_ASSERT_TRUE(post(1, "B"));
+    modem->hold = false;
+    up->poll();                                 // A's answer and the close arrive
+    TEST_ASSERT_FALSE(up->isConnected());
+
+    TEST_ASSERT_FALSE(post(2, "C"));
+    TEST_ASSERT_EQUAL_UINT(1, modem->opens);
+    TEST_ASSERT_EQUAL_size_t(2, modem->requests.size());
+
+    UploadResult res[2] = {UP_FAILED, UP_FAILED};
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 2));    // B has no answer: retried later
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    up->end();
+
+    /* the next drain starts on a fresh connection */
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "B"));
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    TEST_ASSERT_EQUAL_UINT(2, modem->opens);
+    TEST_ASSERT_TRUE(modem->requests.back().find("field1=B ") != std::string::npos);
+    up->end();
+}
+
+/* Every row answered before the close: the next one may reconnect */
+void test_reconnect_when_nothing_owed() {
+    modem->script.push_back({200, "101", true});
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "A"));
+    up->poll();
+    TEST_ASSERT_FALSE(up->isConnected());
+
+    TEST_ASSERT_TRUE(post(1, "C"));
+    TEST_ASSERT_EQUAL_UINT(2, modem->opens);
+    UploadResult res[2];
+    TEST_ASSERT_EQUAL_UINT8(2, up->collect(res, 2));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    TEST_ASSERT_EQUAL(UP_OK, res[1]);
+    up->end();
+}
+
+/* With keepOpen() the session outlives the drain: the next one within
+ * TCP_IDLE_MAX_MS reuses it, a later one pays for a new handshake */
+void test_tls_session_held_across_drains() {
+    useTls();
+    up->keepOpen(true);
+    UploadResult res[1];
+
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "A"));
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    up->end();
+    TEST_ASSERT_TRUE(up->isConnected());
+
+    hostClockAdvance(TCP_IDLE_MAX_MS / 2);
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "B"));
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    up->end();
+    TEST_ASSERT_EQUAL_UINT(1, modem->opens);
+    TEST_ASSERT_EQUAL_size_t(2, modem->requests.size());
+    TEST_ASSERT_TRUE(modem->sent.find("AT+CCHSEND=0,") != std::string::npos);
+    TEST_ASSERT_TRUE(modem->sent.find("AT+CIPSEND") == std::string::npos);
+    TEST_ASSERT_TRUE(modem->sslcfg[1] == "AT+CSSLCFG=\"authmode\",0,0");
+
+    hostClockAdvance(TCP_IDLE_MAX_MS);
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_EQUAL_UINT(2, modem->opens);
+    up->end();
+}
+
+/* The server closes the session: the next drain opens a new one, and
+ * a CA file turns server verification on */
+void test_tls_reopens_after_peer_close() {
+    useTls("ts.pem");
+    up->keepOpen(true);
+    modem->script.push_back({200, "101", true});
+    UploadResult res[1];
+
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "A"));
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    up->end();
+    TEST_ASSERT_FALSE(up->isConnected());
+
+    TEST_ASSERT_TRUE(up->begin());
+    TEST_ASSERT_TRUE(post(0, "B"));
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    up->end();
+    TEST_ASSERT_EQUAL_UINT(2, modem->opens);
+    TEST_ASSERT_TRUE(modem->sslcfg[1] == "AT+CSSLCFG=\"authmode\",0,1");
+    TEST_ASSERT_TRUE(modem->sslcfg[2] == "AT+CSSLCFG=\"cacert\",0,\"ts.pem\"");
+}
+
+/* Entry id 0 and 429 mean "too soon": kept for a retry. Other 4xx
+ * can never succeed. */
+void test_thingspeak_answers_judged() {
+    modem->script.push_back({200, "0", false});
+    modem->script.push_back({429, "", false});
+    modem->script.push_back({400, "", false});
+    modem->script.push_back({200, "104", false});
+
+    TEST_ASSERT_TRUE(up->begin());
+    modem->hold = true;
+    for (uint8_t i = 0; i < 4; ++i) TEST_ASSERT_TRUE(post(i, std::to_string(i).c_str()));
+    modem->hold = false;
+
+    UploadResult res[4];
+    TEST_ASSERT_EQUAL_UINT8(4, up->collect(res, 4));
+    TEST_ASSERT_EQUAL(UP_FAILED, res[0]);
+    TEST_ASSERT_EQUAL(UP_FAILED, res[1]);
+    TEST_ASSERT_EQUAL(UP_REJECTED, res[2]);
+    TEST_ASSERT_EQUAL(UP_OK, res[3]);
+    up->end();
+}
+
+/* One request per period; a too-soon answer restarts the period from
+ * when it came in, not from when the request went out */
+void test_pacer_backs_off_on_too_soon() {
+    RatePacer pacer(15000);
+    up->pace(&pacer);
+    modem->script.push_back({200, "0", false});
+    UploadResult res[1];
+
+    TEST_ASSERT_TRUE(up->begin());
+    modem->hold = true;
+    TEST_ASSERT_TRUE(post(0, "A"));
+    hostClockAdvance(10000);                    // answer comes in late
+    modem->hold = false;
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_FAILED, res[0]);
+
+    TEST_ASSERT_TRUE(post(0, "A"));
+    TEST_ASSERT_TRUE(hostClockNow() >= 25000);
+    TEST_ASSERT_EQUAL_UINT8(1, up->collect(res, 1));
+    TEST_ASSERT_EQUAL(UP_OK, res[0]);
+    up->end();
+}
+
+/* In bulk mode a window is one POST and every row shares its answer */
+void test_bulk_window_is_one_post() {
+    up->bulk(&BULK);
+    modem->script.push_back({202, "{\"success\":true}", false});
+    modem->script.push_back({202, "{\"success\":false}", false});
+    UploadResult res[3];
+
+    TEST_ASSERT_TRUE(up->begin());
+    for (uint8_t i = 0; i < 3; ++i) TEST_ASSERT_TRUE(post(i, std::to_string(i).c_str()));
+    TEST_ASSERT_EQUAL_UINT8(3, up->collect(res, 3));
+    for (UploadResult r : res) TEST_ASSERT_EQUAL(UP_OK, r);
+    TEST_ASSERT_EQUAL_size_t(1, modem->requests.size());
+    const std::string& req = modem->requests[0];
+    TEST_ASSERT_EQUAL(0, req.compare(0, 34, "POST /channels/1/bulk_update.json "));
+    std::string body = req.substr(req.find("\r\n\r\n") + 4);
+    TEST_ASSERT_EQUAL_STRING("{\"updates\":[{\"field1\":0},{\"field1\":1},{\"field1\":2}]}", body.c_str());
+
+    for (uint8_t i = 0; i < 2; ++i) TEST_ASSERT_TRUE(post(i, std::to_string(i).c_str()));
+    TEST_ASSERT_EQUAL_UINT8(2, up->collect(res, 2));
+    TEST_ASSERT_EQUAL(UP_FAILED, res[0]);
+    TEST_ASSERT_EQUAL(UP_FAILED, res[1]);
+    TEST_ASSERT_EQUAL_size_t(2, modem->requests.size());
+    up->end();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pipelined_window);
+    RUN_TEST(test_no_reconnect_with_rows_in_flight);
+    RUN_TEST(test_reconnect_when_nothing_owed);
+    RUN_TEST(test_tls_session_held_across_drains);
+    RUN_TEST(test_tls_reopens_after_peer_close);
+    RUN_TEST(test_thingspeak_answers_judged);
+    RUN_TEST(test_pacer_backs_off_on_too_soon);
+    RUN_TEST(test_bulk_window_is_one_post);
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "lora.h"
+#include "lorasched.h"
+
+/* ========================================================
+ *  TDMA schedule against N virtual nodes on a shared
+ *  channel. Nodes keep their own drifting clocks, sync to
+ *  the beacon (and sometimes miss it), and send one frame in
+ *  their slot. Any two frames that overlap on air are both
+ *  lost. The same nodes reporting on their own clocks, with
+ *  the gateway always listening, are the ad-hoc baseline.
+ *  Reports delivery, collision rate and gateway radio-on.
+ * ======================================================== */
+
+static const TdmaConfig CFG = {LORA_PERIOD_MS, LORA_BEACON_MS, LORA_SLOT_MS, LORA_GUARD_MS};
+static const uint32_t AIRTIME_MS   = 300;       // 40 B at SF9 / 125 kHz
+static const uint32_t TX_OFFSET_MS = 200;       // node sends this far into its slot
+static const uint32_t PERIODS      = 24;
+static const uint32_t BEACON_MISS  = 8;         // % of beacons a node does not hear
+
+static uint32_t rng = 1;
+static uint32_t rnd(uint32_t n) {               // xorshift32: same run every time
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng % n;
+}
+
+struct Tx {
+    uint16_t from;
+    uint32_t start, end;
+    bool     collided;
+    bool     heardStart;                        // gateway radio on when it began
+    bool     done;
+};
+
+struct Node {
+    uint16_t addr;
+    int32_t  driftPpm;
+    bool     synced;
+    double   nextBeacon;                        // true time the node expects it
+    uint32_t txAt;                              // true time of the next frame, 0 = none
+};
+
+struct Result {
+    uint32_t sent, delivered, collided;
+    uint32_t radioOnMs, totalMs;
+};
+
+/* ms of node time → true ms */
+static double trueMs(const Node& n, double local) {
+    return local / (1.0 + n.driftPpm * 1e-6);
+}
+
+static void report(const char* kind, uint8_t nodes, const Result& r) {
+    printf("  %-7s N=%2u  sent %4lu  delivered %4lu  collided %3lu (%5.1f %%)  radio on %6.2f %%\n",
+           kind, nodes, (unsigned long)r.sent, (unsigned long)r.delivered, (unsigned long)r.collided,
+           r.sent ? 100.0 * r.collided / r.sent : 0.0, 100.0 * r.radioOnMs / r.totalMs);
+}
+
+/* --- channel: a frame that overlaps another on air is lost --- */
+static void transmit(std::vector<Tx>& air, uint16_t from, uint32_t at, bool gwOn) {
+    Tx t{from, at, at + AIRTIME_MS, false, gwOn, false};
+    for (Tx& o : air)
+        if (o.start < t.end && t.start < o.end) o.collided = t.collided = true;
+    air.push_back(t);
+}
+
+static Result runTdma(uint8_t count, TdmaSchedule& s) {
+    std::vector<Node> nodes;
+    for (uint8_t i = 0; i < count; ++i) {
+        nodes.push_back(Node{(uint16_t)(10 + i), (int32_t)rnd(201) - 100, false, 0, 0});
+        s.addNode(10 + i);
+    }
+    std::vector<Tx> air;
+    Result r = {};
+    bool gwOn = false;
+    uint32_t end = PERIODS * CFG.periodMs;
+
+    s.start(0);
+    for (uint32_t t = 0; t < end; ) {
+        uint32_t until;
+        TdmaSchedule::Action a = s.step(t, until);
+        bool on = a != TdmaSchedule::TDMA_SLEEP;
+        if (on != gwOn) s.radio(on, t);
+        gwOn = on;
+
+        if (a == TdmaSchedule::TDMA_BEACON) {
+            uint8_t b[TDMA_BEACON_MAX];
+            size_t n = s.beacon(b, sizeof(b), 0, t);
+            TEST_ASSERT_EQUAL_size_t(14 + 2 * count, n);
+            uint32_t toNext = b[5] | b[6] << 8 | b[7] << 16 | (uint32_t)b[8] << 24;
+            for (Node& nd : nodes) {
+                if (rnd(100) < BEACON_MISS) {           // free-runs on the last sync
+                    if (nd.synced) {
+                        uint8_t slot = (uint8_t)(&nd - &nodes[0]);
+                        nd.txAt = (uint32_t)(nd.nextBeacon +
+                                  trueMs(nd, CFG.beaconMs + slot * CFG.slotMs + TX_OFFSET_MS));
+                        nd.nextBeacon += trueMs(nd, CFG.periodMs);
+                    }
+                    continue;
+                }
+                for (uint8_t k = 0; k < b[13]; ++k) {
+                    if ((b[14 + 2 * k] | b[15 + 2 * k] << 8) != nd.addr) continue;
+                    nd.synced = true;
+                    nd.txAt = t + (uint32_t)trueMs(nd, (b[11] | b[12] << 8) + k * (b[9] | b[10] << 8) + TX_OFFSET_MS);
+                    nd.nextBeacon = t + trueMs(nd, toNext);
+                }
+            }
+            s.beaconSent(t);
+            continue;
+        }
+
+        for (Node& nd : nodes) {
+            if (nd.txAt && nd.txAt <= t) {
+                transmit(air, nd.addr, t, gwOn);
+                r.sent++;
+                nd.txAt = 0;
+            }
+        }
+        bool seen = false;
+        for (Tx& x : air) {
+            if (x.done || x.end > t) continue;
+            x.done = true;
+            if (x.collided) r.collided++;
+            else if (x.heardStart && gwOn) {
+                s.frameSeen(x.from, t);
+                r.delivered++;
+                seen = true;
+            }
+        }
+        if (seen) continue;                             // slot done: the schedule moves on now
+
+        /* next thing that happens: a node starts or a frame ends */
+        uint32_t next = until > t ? until : t + 1;
+        for (Node& nd : nodes)
+            if (nd.txAt && nd.txAt < next) next = nd.txAt;
+        for (Tx& x : air)
+            if (!x.done && x.end < next) next = x.end;
+        t = next;
+    }
+    if (gwOn) s.radio(false, end);
+    r.radioOnMs = s.stats().radioOnMs;
+    r.totalMs = end;
+    return r;
+}
+
+/* Every node reports on its own clock at the top of the period; the
+ * clocks are a few seconds apart, so frames pile up */
+static Result runAdHoc(uint8_t count) {
+    std::vector<Tx> air;
+    Result r = {};
+    for (uint32_t p = 0; p < PERIODS; ++p) {
+        air.clear();
+        std::vector<uint32_t> starts;
+        for (uint8_t i = 0; i < count; ++i) starts.push_back(p * CFG.periodMs + rnd(3000));
+        for (uint32_t at : starts) transmit(air, 0, at, true);
+        for (Tx& x : air) {
+            r.sent++;
+            if (x.collided) r.collided++;
+            else r.delivered++;
+        }
+    }
+    r.radioOnMs = r.totalMs = PERIODS * CFG.periodMs;  // always listening
+    return r;
+}
+
+void setUp() {
+    rng = 0x1234567;
+}
+
+void tearDown() {}
+
+static void checkTdma(uint8_t count) {
+    TdmaSchedule s(CFG);
+    Result r = runTdma(count, s);
+    report("TDMA", count, r);
+    const TdmaStats& st = s.stats();
+
+    TEST_ASSERT_EQUAL_UINT32(0, r.collided);
+    TEST_ASSERT_EQUAL_UINT32(0, st.strays);
+    TEST_ASSERT_EQUAL_UINT32(r.delivered, st.frames);
+    TEST_ASSERT_EQUAL_UINT32(r.sent, r.delivered);          // drift stays inside the guard
+    TEST_ASSERT_GREATER_OR_EQUAL(PERIODS - 1, st.superframes);
+
+    /* on air: the beacon, plus the guard and up to the frame's end in each slot */
+    uint32_t perFrame = CFG.beaconMs + count * (CFG.guardMs + TX_OFFSET_MS + AIRTIME_MS + 100);
+    TEST_ASSERT_LESS_OR_EQUAL(perFrame * PERIODS, r.radioOnMs);
+}
+
+void test_tdma_4_nodes()  { checkTdma(4); }
+void test_tdma_8_nodes()  { checkTdma(8); }
+void test_tdma_16_nodes() { checkTdma(TDMA_MAX_NODES); }
+
+void test_ad_hoc_baseline_collides() {
+    TdmaSchedule s(CFG);
+    Result tdma = runTdma(TDMA_MAX_NODES, s);
+    Result adHoc = runAdHoc(TDMA_MAX_NODES);
+    report("ad-hoc", TDMA_MAX_NODES, adHoc);
+
+    TEST_ASSERT_GREATER_THAN(adHoc.sent / 4, adHoc.collided);
+    TEST_ASSERT_LESS_THAN(adHoc.radioOnMs / 20, tdma.radioOnMs);
+}
+
+/* A node that never shows up costs its slot once per superframe */
+void test_silent_node_counts_misses() {
+    TdmaSchedule s(CFG);
+    s.addNode(1);
+    s.addNode(2);
+    s.start(0);
+    uint32_t until;
+    for (uint32_t t = 0; t < 3 * CFG.periodMs; t += 10) {
+        if (s.step(t, until) == TdmaSchedule::TDMA_BEACON) s.beaconSent(t);
+        uint32_t off = t % CFG.periodMs;
+        if (off == CFG.beaconMs + TX_OFFSET_MS) s.frameSeen(1, t);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, s.stats().frames);
+    TEST_ASSERT_EQUAL_UINT32(3, s.stats().misses);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tdma_4_nodes);
+    RUN_TEST(test_tdma_8_nodes);
+    RUN_TEST(test_tdma_16_nodes);
+    RUN_TEST(test_ad_hoc_baseline_collides);
+    RUN_TEST(test_silent_node_counts_misses);
+    return UNITY_END();
+}
@@ -0,0 +1,238 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "record.h"
+#include "sdlog.h"
+#include "storage.h"
+#include "uplink.h"
+#include "upqueue.h"
+
+/* ========================================================
+ *  Upload queue on a host directory: the latest lane, its
+ *  demotion into the buffered backlog, the drain, and the
+ *  boot-time repair of torn rows and cursor slots.
+ * ======================================================== */
+
+static const char DAY[] = "D250801.CSV";
+
+/* Accepts every row and keeps what it got */
+struct SinkUplink : Uplink {
+    std::vector<std::string> got;
+    uint8_t pending = 0;
+
+    bool    begin() override { return true; }
+    uint8_t window() const override { return 4; }
+    size_t  encode(const char* row, char* out, size_t cap) override {
+        size_t n = strlen(row);
+        if (n >= cap) return 0;
+        memcpy(out, row, n + 1);
+        return n;
+    }
+    bool    post(const char* wire, size_t) override {
+        got.push_back(wire);
+        pending++;
+        return true;
+    }
+    uint8_t collect(UploadResult* res, uint8_t n) override {
+        uint8_t k = 0;
+        for (; k < n && k < pending; ++k) res[k] = UP_OK;
+        pending = 0;
+        return k;
+    }
+    void    end() override {}
+};
+
+/* QUEUE.CUR slot as upqueue.cpp lays it out */
+struct CursorSlot {
+    uint32_t seq;
+    char     name[13];
+    uint32_t offset;
+    uint32_t crc;
+};
+
+/* Flip one byte on the card, as a torn write would leave it */
+static void flip(const char* name, uint32_t at) {
+    StoreFile f = storeOpen(name, ST_RW);
+    uint8_t b = 0;
+    f.seek(at);
+    f.read(&b, 1);
+    b ^= 0xFF;
+    f.seek(at);
+    f.write(&b, 1);
+    f.close();
+}
+
+static void fillDay(int rows) {
+    char row[48];
+    for (int h = 0; h < rows; ++h) {
+        snprintf(row, sizeof(row), "25/08/01\t%02d:00:00\t%d.00", 10 + h, h);
+        TEST_ASSERT_TRUE(queueAppend(row, DAY));
+    }
+    sdlogClose();
+}
+
+static bool sentAt(const SinkUplink& up, size_t i, int hour) {
+    char hh[16];
+    snprintf(hh, sizeof(hh), "%02d:00:00", hour);
+    return i < up.got.size() && up.got[i].find(hh) != std::string::npos;
+}
+
+void setUp() {
+    sdlogClose();
+    TEST_ASSERT_NOT_NULL(hostCardReset());
+    hostClockSet(0);
+}
+
+void tearDown() {
+    sdlogClose();
+}
+
+/* Backlog rows wait in the sector buffer, but a demoted latest row is
+ * flushed with them before LATEST.TXT is overwritten: a brownout at
+ * any point leaves it on the card */
+void test_demotion_reaches_card_before_latest_is_replaced() {
+    TEST_ASSERT_TRUE(queueAppend("25/08/01\t09:00:00\t0.00", DAY));
+    TEST_ASSERT_TRUE(queuePush("25/08/01\t10:00:00\t1.00", DAY));
+    TEST_ASSERT_TRUE(hostCardRead(DAY).find("09:00:00") == std::string::npos);
+
+    TEST_ASSERT_TRUE(queuePush("25/08/01\t11:00:00\t2.00", DAY));
+    std::string day = hostCardRead(DAY);
+    TEST_ASSERT_TRUE(day.find("09:00:00") != std::string::npos);
+    TEST_ASSERT_TRUE(day.find("10:00:00") != std::string::npos);
+    TEST_ASSERT_TRUE(day.find("11:00:00") == std::string::npos);
+    TEST_ASSERT_TRUE(hostCardRead("LATEST.TXT").find("11:00:00") != std::string::npos);
+}
+
+void test_torn_latest_is_overwritten() {
+    StoreFile f = storeOpen("LATEST.TXT", ST_TRUNC);
+    f.println(DAY);
+    f.println("@1f\t25/08/01");                 // frame without a valid CRC
+    f.close();
+
+    TEST_ASSERT_TRUE(queuePush("25/08/01\t12:00:00\t3.00", DAY));
+    sdlogFlush();
+    TEST_ASSERT_EQUAL_size_t(0, hostCardRead(DAY).size());
+    TEST_ASSERT_TRUE(hostCardRead("LATEST.TXT").find("12:00:00") != std::string::npos);
+}
+
+/* Latest first, then every demoted row from the backlog, once each */
+void test_drain_sends_demoted_rows() {
+    char row[48];
+    for (int h = 0; h < 5; ++h) {
+        snprintf(row, sizeof(row), "25/08/01\t%02d:00:00\t%d.00", 10 + h, h);
+        TEST_ASSERT_TRUE(queuePush(row, DAY));
+    }
+
+    SinkUplink up;
+    TEST_ASSERT_EQUAL(UP_OK, queueSendLatest(up));
+    DrainStats s = queueDrain(up, 60000, 0);
+    TEST_ASSERT_TRUE(s.empty);
+    TEST_ASSERT_EQUAL_UINT16(4, s.sent);
+    TEST_ASSERT_EQUAL_size_t(5, up.got.size());     // nothing from the preallocated tail
+    TEST_ASSERT_TRUE(up.got[0].find("14:00:00") != std::string::npos);
+    for (int h = 0; h < 4; ++h) {
+        snprintf(row, sizeof(row), "%02d:00:00", 10 + h);
+        TEST_ASSERT_TRUE(up.got[1 + h].find(row) != std::string::npos);
+    }
+    TEST_ASSERT_FALSE(queueHasLatest());
+    TEST_ASSERT_FALSE(queueHasBacklog());
+}
+
+/* The open day file is a preallocated run; only its rows are backlog */
+void test_backlog_is_rows_only() {
+    TEST_ASSERT_TRUE(queuePush("25/08/01\t10:00:00\t1.00", DAY));
+    TEST_ASSERT_TRUE(queuePush("25/08/01\t11:00:00\t2.00", DAY));
+    sdlogFlush();
+    uint32_t n = queueBacklogBytes();
+    std::string day = hostCardRead(DAY);
+    TEST_ASSERT_EQUAL_UINT32(day.size(), n);
+    TEST_ASSERT_EQUAL_size_t(day.size() - 1, day.find('\n'));    // the one demoted row
+    TEST_ASSERT_TRUE(day.find("10:00:00") != std::string::npos);
+}
+
+/* A row whose CRC no longer matches is counted and stepped over,
+ * the rows around it still go out */
+void test_drain_skips_torn_row() {
+    fillDay(3);
+    std::string day = hostCardRead(DAY);
+    flip(DAY, day.find('\n') + 1 + RECORD_OVERHEAD + 3);   // inside row 2's payload
+
+    SinkUplink up;
+    DrainStats s = queueDrain(up, 60000, 0);
+    TEST_ASSERT_TRUE(s.empty);
+    TEST_ASSERT_EQUAL_UINT16(2, s.sent);
+    TEST_ASSERT_EQUAL_UINT16(1, s.skipped);
+    TEST_ASSERT_TRUE(sentAt(up, 0, 10));
+    TEST_ASSERT_TRUE(sentAt(up, 1, 12));
+}
+
+void test_recover_drops_torn_latest() {
+    TEST_ASSERT_TRUE(queuePush("25/08/01\t10:00:00\t1.00", DAY));
+    std::string latest = hostCardRead("LATEST.TXT");
+    flip("LATEST.TXT", latest.size() - 3);      // in the framed row
+    queueRecover();
+    TEST_ASSERT_FALSE(queueHasLatest());
+}
+
+/* The newer cursor slot is torn: recovery falls back to the older one
+ * and the drain resends the one row between them, skipping none */
+void test_torn_cursor_slot_falls_back() {
+    fillDay(4);
+    SinkUplink up;
+    TEST_ASSERT_EQUAL_UINT16(1, queueDrain(up, 60000, 1).sent);
+    TEST_ASSERT_EQUAL_UINT16(1, queueDrain(up, 60000, 1).sent);
+
+    CursorSlot slot[2];
+    StoreFile f = storeOpen("QUEUE.CUR", ST_READ);
+    TEST_ASSERT_EQUAL_size_t(sizeof(slot), f.read(slot, sizeof(slot)));
+    f.close();
+    uint8_t newer = slot[1].seq > slot[0].seq;
+    flip("QUEUE.CUR", newer * sizeof(CursorSlot) + offsetof(CursorSlot, offset));
+
+    queueRecover();
+    up.got.clear();
+    DrainStats s = queueDrain(up, 60000, 0);
+    TEST_ASSERT_TRUE(s.empty);
+    TEST_ASSERT_EQUAL_size_t(3, up.got.size());
+    TEST_ASSERT_TRUE(sentAt(up, 0, 11));
+    TEST_ASSERT_TRUE(sentAt(up, 1, 12));
+    TEST_ASSERT_TRUE(sentAt(up, 2, 13));
+}
+
+/* A cursor left inside a row is moved up to the next line start, so
+ * the drain never reads half a row as a whole one */
+void test_recover_moves_cursor_to_line_start() {
+    fillDay(3);
+    CursorSlot c;
+    memset(&c, 0, sizeof(c));
+    c.seq = 1000;
+    strcpy(c.name, DAY);
+    c.offset = 7;                               // inside row 1
+    c.crc = crc32(&c, offsetof(CursorSlot, crc));
+    StoreFile f = storeOpen("QUEUE.CUR", ST_TRUNC);
+    f.write(&c, sizeof(c));
+    f.close();
+
+    queueRecover();
+    SinkUplink up;
+    DrainStats s = queueDrain(up, 60000, 0);
+    TEST_ASSERT_TRUE(s.empty);
+    TEST_ASSERT_EQUAL_UINT16(0, s.skipped);
+    TEST_ASSERT_EQUAL_size_t(2, up.got.size());
+    TEST_ASSERT_TRUE(sentAt(up, 0, 11));
+    TEST_ASSERT_TRUE(sentAt(up, 1, 12));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_demotion_reaches_card_before_latest_is_replaced);
+    RUN_TEST(test_torn_latest_is_overwritten);
+    RUN_TEST(test_drain_sends_demoted_rows);
+    RUN_TEST(test_backlog_is_rows_only);
+    RUN_TEST(test_drain_skips_torn_row);
+    RUN_TEST(test_recover_drops_torn_latest);
+    RUN_TEST(test_torn_cursor_slot_falls_back);
+    RUN_TEST(test_recover_moves_cursor_to_line_start);
+    return UNITY_END();
+}
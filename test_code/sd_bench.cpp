@@ -0,0 +1,105 @@
+// Description: SD throughput and latency through the storage layer (storage.h)
+// Build: in place of jacob-main.cpp in src/ (same lib_deps and build flags),
+//        so SdFat runs on the DMA SPI driver exactly as in the firmware.
+// Prints write and read MB/s for sector-sized and 4 KB chunks on a
+// preallocated file, then open/close and append latency.
+
+#include <Arduino.h>
+#include "storage.h"
+
+const int PIN_SD_SELECT = 4;
+
+static const char     BENCH_FILE[] = "BENCH.DAT";
+static const uint32_t BENCH_BYTES  = 1024UL * 1024UL;   // per pass
+static const uint16_t LAT_ROUNDS   = 50;
+
+static uint8_t buf[4096];
+
+static void report(const char* what, uint32_t bytes, uint32_t us) {
+    SerialUSB.print(what);
+    SerialUSB.print(": ");
+    SerialUSB.print(bytes / 1024UL);
+    SerialUSB.print(" KB in ");
+    SerialUSB.print(us / 1000UL);
+    SerialUSB.print(" ms = ");
+    SerialUSB.print((float)bytes / us, 3);              // bytes/us == MB/s
+    SerialUSB.println(" MB/s");
+}
+
+static void writePass(uint16_t chunk) {
+    storeRemove(BENCH_FILE);
+    StoreFile f = storeOpen(BENCH_FILE, ST_TRUNC);
+    bool pre = f.preallocate(BENCH_BYTES);
+    uint32_t t0 = micros();
+    for (uint32_t done = 0; done < BENCH_BYTES; done += chunk) f.write(buf, chunk);
+    f.flush();
+    uint32_t us = micros() - t0;
+    f.close();
+    SerialUSB.print(pre ? "[prealloc] " : "[no prealloc] ");
+    report(chunk == 512 ? "write 512 B" : "write 4 KB", BENCH_BYTES, us);
+}
+
+static void readPass(uint16_t chunk) {
+    StoreFile f = storeOpen(BENCH_FILE, ST_READ);
+    uint32_t got = 0, t0 = micros();
+    int n;
+    while ((n = f.read(buf, chunk)) > 0) got += n;
+    uint32_t us = micros() - t0;
+    f.close();
+    report(chunk == 512 ? "read 512 B" : "read 4 KB", got, us);
+}
+
+static void latency() {
+    uint32_t t0 = micros();
+    for (uint16_t i = 0; i < LAT_ROUNDS; ++i) storeOpen(BENCH_FILE, ST_READ).close();
+    SerialUSB.print("open+close (read): ");
+    SerialUSB.print((micros() - t0) / LAT_ROUNDS);
+    SerialUSB.println(" us");
+
+    /* the old per-sample pattern: open, append one row, close */
+    static const char row[] = "25/07/11\t14:03:00\t1.23\t4.56\t7.89\t10.1\t11.2\t12.3";
+    storeRemove("BENCHROW.CSV");
+    t0 = micros();
+    for (uint16_t i = 0; i < LAT_ROUNDS; ++i) {
+        StoreFile f = storeOpen("BENCHROW.CSV", ST_APPEND);
+        f.println(row);
+        f.close();
+    }
+    SerialUSB.print("open+append+close: ");
+    SerialUSB.print((micros() - t0) / LAT_ROUNDS);
+    SerialUSB.println(" us");
+
+    t0 = micros();
+    for (uint16_t i = 0; i < LAT_ROUNDS; ++i) storeExists(BENCH_FILE);
+    SerialUSB.print("exists: ");
+    SerialUSB.print((micros() - t0) / LAT_ROUNDS);
+    SerialUSB.println(" us");
+}
+
+void setup() {
+    SerialUSB.begin(115200);
+    while (!SerialUSB);
+    SerialUSB.println("SD bench start");
+
+    uint32_t t0 = micros();
+    if (!storeBegin(PIN_SD_SELECT)) {
+        SerialUSB.println("mount failed");
+        while (1);
+    }
+    SerialUSB.print("mount: ");
+    SerialUSB.print((micros() - t0) / 1000UL);
+    SerialUSB.println(" ms");
+
+    for (size_t i = 0; i < sizeof(buf); ++i) buf[i] = (uint8_t)i;
+    writePass(512);
+    readPass(512);
+    writePass(4096);
+    readPass(4096);
+    latency();
+
+    storeRemove(BENCH_FILE);
+    storeRemove("BENCHROW.CSV");
+    SerialUSB.println("SD bench done");
+}
+
+void loop() {}